@@ -5,6 +5,7 @@
 */
 
 #include "../src/lib/localeHandling.h"
+#include "../src/render/renderqueue.h"
 #include "mlt++/Mlt.h"
 #include "renderjob.h"
 #include <../config-kdenlive.h>
@@ -13,8 +14,129 @@
 #include <QDebug>
 #include <QDir>
 #include <QDomDocument>
+#include <QMutex>
+#include <QProcess>
 #include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
 #include <QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+/**
+ * @brief The chunks of a preview render, shared by the threads rendering them.
+ */
+struct ChunkQueue
+{
+    QMutex mutex;
+    QList<int> frames;
+    int next = 0;
+    std::atomic<bool> failed{false};
+    /** @brief Returns false when all the chunks are taken or a chunk failed */
+    bool take(int &frame)
+    {
+        QMutexLocker lock(&mutex);
+        if (failed || next >= frames.count()) {
+            return false;
+        }
+        frame = frames.at(next++);
+        return true;
+    }
+};
+
+/**
+ * @brief Renders chunks from the queue until it is empty.
+ * Each worker needs its own producer, MLT services cannot be shared between threads.
+ */
+void renderChunks(ChunkQueue &queue, Mlt::Profile &profile, Mlt::Producer &prod, const QDir &baseFolder, int chunkSize, const QString &extension,
+                  const QStringList &consumerParams)
+{
+    int frame;
+    while (queue.take(frame)) {
+        fprintf(stderr, "START:%d \n", frame);
+        QString fileName = QStringLiteral("%1.%2").arg(frame).arg(extension);
+        if (baseFolder.exists(fileName)) {
+            // Don't overwrite an existing file
+            fprintf(stderr, "DONE:%d \n", frame);
+            continue;
+        }
+        QScopedPointer<Mlt::Producer> playlst(prod.cut(frame, frame + chunkSize));
+        QScopedPointer<Mlt::Consumer> cons(
+            new Mlt::Consumer(profile, QString("avformat:%1").arg(baseFolder.absoluteFilePath(fileName)).toUtf8().constData()));
+        for (const QString &param : consumerParams) {
+            if (param.contains(QLatin1Char('='))) {
+                cons->set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+            }
+        }
+        if (!cons->is_valid()) {
+            fprintf(stderr, " = =  = INVALID CONSUMER\n\n");
+            queue.failed = true;
+            return;
+        }
+        cons->set("terminate_on_pause", 1);
+        cons->connect(*playlst);
+        playlst.reset();
+        cons->run();
+        cons->stop();
+        cons->purge();
+        fprintf(stderr, "DONE:%d \n", frame);
+    }
+}
+
+/**
+ * @brief Renders the waiting jobs of @param queue, starting each job as soon as the limits allow it.
+ * The queue file is updated whenever a job starts or ends, so that an interrupted batch can be resumed.
+ * Returns 1 if a job failed.
+ */
+int renderQueue(QApplication &app, RenderQueue &queue, const RenderQueue::Limits &limits)
+{
+    bool failed = false;
+    std::function<void()> startJobs;
+    startJobs = [&]() {
+        const QStringList outputs = queue.admissible(limits);
+        for (const QString &output : outputs) {
+            auto job = std::find_if(queue.jobs().cbegin(), queue.jobs().cend(), [&output](const RenderQueue::Job &j) { return j.output == output; });
+            QStringList jobArgs = job->args;
+            // There is no Kdenlive instance to send the progress to
+            int pidIndex = jobArgs.indexOf(QStringLiteral("--pid"));
+            if (pidIndex >= 0) {
+                jobArgs.erase(jobArgs.begin() + pidIndex, jobArgs.begin() + qMin(pidIndex + 2, jobArgs.count()));
+            }
+            auto *process = new QProcess(&app);
+            process->setProcessChannelMode(QProcess::ForwardedChannels);
+            QObject::connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &app,
+                             [&, process, output](int exitCode, QProcess::ExitStatus status) {
+                                 const bool success = status == QProcess::NormalExit && exitCode == 0;
+                                 fprintf(stderr, "%s %s\n", success ? "Finished" : "Failed", output.toUtf8().constData());
+                                 failed |= !success;
+                                 queue.setStatus(output, success ? RenderQueue::Finished : RenderQueue::Failed);
+                                 process->deleteLater();
+                                 startJobs();
+                             });
+            queue.setStatus(output, RenderQueue::Running);
+            process->start(QCoreApplication::applicationFilePath(), jobArgs);
+            if (!process->waitForStarted(-1)) {
+                fprintf(stderr, "Cannot start the render of %s\n", output.toUtf8().constData());
+                failed = true;
+                queue.setStatus(output, RenderQueue::Failed);
+                process->deleteLater();
+                continue;
+            }
+            fprintf(stderr, "Rendering %s\n", output.toUtf8().constData());
+        }
+        queue.save();
+        if (queue.count(RenderQueue::Running) == 0) {
+            app.exit(failed ? 1 : 0);
+        }
+    };
+    QTimer::singleShot(0, &app, startJobs);
+    return app.exec();
+}
+} // namespace
 
 int main(int argc, char **argv)
 {
@@ -31,7 +153,7 @@ int main(int argc, char **argv)
     parser.addHelpOption();
     parser.addVersionOption();
 
-    parser.addPositionalArgument("mode", "Render mode. Either \"delivery\" or \"preview-chunks\".");
+    parser.addPositionalArgument("mode", "Render mode. Either \"delivery\", \"preview-chunks\" or \"queue\".");
     parser.parse(QCoreApplication::arguments());
     QStringList args = parser.positionalArguments();
     const QString mode = args.isEmpty() ? QString() : args.first();
@@ -48,6 +170,11 @@ int main(int argc, char **argv)
         parser.addPositionalArgument("file_extension", "Rendered file extension.");
         parser.addPositionalArgument("args", "Space separated libavformat arguments.", "[arg1 arg2 ...]");
 
+        QCommandLineOption workersOption("workers", "Number of chunks rendered at the same time.", "count", QString::number(1));
+        parser.addOption(workersOption);
+        QCommandLineOption playheadOption("playhead", "Render the chunks closest to this frame first.", "frame", QString::number(-1));
+        parser.addOption(playheadOption);
+
         parser.process(app);
         args = parser.positionalArguments();
         if (args.count() < 7) {
@@ -71,7 +198,8 @@ int main(int argc, char **argv)
         // chunk size in frames
         int chunkSize = args.takeFirst().toInt();
         // path to profile
-        Mlt::Profile profile(args.takeFirst().toUtf8().constData());
+        const QString profilePath = args.takeFirst();
+        Mlt::Profile profile(profilePath.toUtf8().constData());
         // rendered file extension
         QString extension = args.takeFirst();
         // avformat consumer params
@@ -86,61 +214,55 @@ int main(int argc, char **argv)
         const char *localename = prod.get_lcnumeric();
         QLocale::setDefault(QLocale(localename));
 
-        int currentFrame = 0;
-        int rangeStart = 0;
-        int rangeEnd = 0;
-        QString frame;
-        while (!chunks.isEmpty()) {
-            if (rangeEnd == 0) {
-                // We are not processing a range
-                frame = chunks.first();
-            }
-            if (rangeEnd > 0) {
-                // We are processing a range
-                currentFrame += chunkSize + 1;
-                frame = QString::number(currentFrame);
-                if (currentFrame >= rangeEnd) {
-                    // End of range
-                    rangeStart = 0;
-                    rangeEnd = 0;
-                    // Range is processed, remove from stack
-                    chunks.removeFirst();
+        // Expand the ranges ("0-500") to the list of chunks
+        ChunkQueue queue;
+        for (const QString &chunk : qAsConst(chunks)) {
+            if (chunk.contains(QLatin1Char('-'))) {
+                int rangeStart = chunk.section(QLatin1Char('-'), 0, 0).toInt();
+                int rangeEnd = chunk.section(QLatin1Char('-'), 1, 1).toInt();
+                for (int frame = rangeStart; frame <= rangeEnd; frame += chunkSize + 1) {
+                    queue.frames << frame;
                 }
-            } else if (frame.contains(QLatin1Char('-'))) {
-                rangeStart = frame.section(QLatin1Char('-'), 0, 0).toInt();
-                rangeEnd = frame.section(QLatin1Char('-'), 1, 1).toInt();
-                currentFrame = rangeStart;
-                frame = QString::number(currentFrame);
             } else {
-                // Frame will be processed, remove from stack
-                chunks.removeFirst();
-            }
-            fprintf(stderr, "START:%d \n", frame.toInt());
-            QString fileName = QStringLiteral("%1.%2").arg(frame, extension);
-            if (baseFolder.exists(fileName)) {
-                // Don't overwrite an existing file
-                fprintf(stderr, "DONE:%d \n", frame.toInt());
-                continue;
+                queue.frames << chunk.toInt();
             }
-            QScopedPointer<Mlt::Producer> playlst(prod.cut(frame.toInt(), frame.toInt() + chunkSize));
-            QScopedPointer<Mlt::Consumer> cons(
-                new Mlt::Consumer(profile, QString("avformat:%1").arg(baseFolder.absoluteFilePath(fileName)).toUtf8().constData()));
-            for (const QString &param : qAsConst(consumerParams)) {
-                if (param.contains(QLatin1Char('='))) {
-                    cons->set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+        }
+        const int playhead = parser.value(playheadOption).toInt();
+        if (playhead >= 0) {
+            // Render the chunks around the playhead first, the user is probably waiting for them
+            auto distance = [playhead, chunkSize](int frame) { return frame > playhead ? frame - playhead : qMax(0, playhead - frame - chunkSize); };
+            std::stable_sort(queue.frames.begin(), queue.frames.end(), [&distance](int a, int b) { return distance(a) < distance(b); });
+        }
+
+        // The first worker uses the producer loaded above, the others load their own copy of the playlist
+        const int workers = qBound(1, parser.value(workersOption).toInt(), qMax(1, queue.frames.count()));
+        std::vector<std::unique_ptr<QThread>> threads;
+        QMutex loadMutex;
+        for (int i = 1; i < workers; ++i) {
+            threads.emplace_back(QThread::create([&]() {
+                Mlt::Profile workerProfile(profilePath.toUtf8().constData());
+                workerProfile.set_explicit(1);
+                std::unique_ptr<Mlt::Producer> workerProd;
+                {
+                    // Avoid loading the playlist in several threads at once
+                    QMutexLocker lock(&loadMutex);
+                    workerProd.reset(new Mlt::Producer(workerProfile, nullptr, playlist.toUtf8().constData()));
                 }
-            }
-            if (!cons->is_valid()) {
-                fprintf(stderr, " = =  = INVALID CONSUMER\n\n");
-                return 1;
-            }
-            cons->set("terminate_on_pause", 1);
-            cons->connect(*playlst);
-            playlst.reset();
-            cons->run();
-            cons->stop();
-            cons->purge();
-            fprintf(stderr, "DONE:%d \n", frame.toInt());
+                if (!workerProd->is_valid()) {
+                    // The other workers render the remaining chunks
+                    fprintf(stderr, "INVALID playlist: %s \n", playlist.toUtf8().constData());
+                    return;
+                }
+                renderChunks(queue, workerProfile, *workerProd.get(), baseFolder, chunkSize, extension, consumerParams);
+            }));
+            threads.back()->start();
+        }
+        renderChunks(queue, profile, prod, baseFolder, chunkSize, extension, consumerParams);
+        for (auto &thread : threads) {
+            thread->wait();
+        }
+        if (queue.failed) {
+            return 1;
         }
         // Mlt::Factory::close();
         fprintf(stderr, "+ + + RENDERING FINISHED + + + \n");
@@ -165,6 +287,13 @@ int main(int argc, char **argv)
         QCommandLineOption subtitleOption("subtitle", "Subtitle file.", "file");
         parser.addOption(subtitleOption);
 
+        QCommandLineOption segmentsOption("segments", "Render this number of parts at the same time and join them without encoding again.", "count",
+                                          QString::number(1));
+        parser.addOption(segmentsOption);
+
+        QCommandLineOption encoderThreadsOption("threads", "Encoder threads. If set it overrides the consumers \"threads\" property.", "count");
+        parser.addOption(encoderThreadsOption);
+
         parser.process(app);
         args = parser.positionalArguments();
 
@@ -204,11 +333,17 @@ int main(int argc, char **argv)
             out = consumer.attribute(QStringLiteral("out"), QString::number(-1)).toInt();
             target = consumer.attribute(QStringLiteral("target"));
             QString output = parser.value(outputOption);
-            if (!output.isEmpty()) {
-                // A custom output target was set.
-                // To apply it we store a copy of the source file with the modified target
+            const int encoderThreads = parser.value(encoderThreadsOption).toInt();
+            if (!output.isEmpty() || encoderThreads > 0) {
+                // A custom output target or thread count was set.
+                // To apply it we store a copy of the source file with the modified consumer
                 // in a temporary file and use this file instead of the original source file.
-                consumer.setAttribute(QStringLiteral("target"), output);
+                if (!output.isEmpty()) {
+                    consumer.setAttribute(QStringLiteral("target"), output);
+                }
+                if (encoderThreads > 0) {
+                    consumer.setAttribute(QStringLiteral("threads"), encoderThreads);
+                }
                 QTemporaryFile tmp(QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-XXXXXX.mlt")));
                 tmp.setAutoRemove(false);
                 if (tmp.open()) {
@@ -218,7 +353,9 @@ int main(int argc, char **argv)
                         qDebug() << "Failed to set custom output destination, falling back to target set in source file: " << target;
                     } else {
                         playlist = tmp.fileName();
-                        target = output;
+                        if (!output.isEmpty()) {
+                            target = output;
+                        }
                         QTextStream outStream(&file);
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
                         outStream.setCodec("UTF-8");
@@ -236,15 +373,54 @@ int main(int argc, char **argv)
         QString subtitleFile = parser.value(subtitleOption);
 
         auto *rJob = new RenderJob(render, playlist, target, pid, in, out, subtitleFile, &app);
+        rJob->setSegments(parser.value(segmentsOption).toInt());
         QObject::connect(rJob, &RenderJob::renderingFinished, rJob, [&]() {
+            const int status = rJob->status();
             rJob->deleteLater();
-            app.quit();
+            app.exit(status == -1 ? 0 : 1);
         });
         // app.setQuitOnLastWindowClosed(false);
         QMetaObject::invokeMethod(rJob, "start", Qt::QueuedConnection);
         return app.exec();
     }
 
+    if (mode == "queue") {
+        parser.clearPositionalArguments();
+        parser.addPositionalArgument("queue", "Mode: Render the waiting jobs of a render queue, several at the same time.");
+        parser.addPositionalArgument("file", "Render queue file, as saved by Kdenlive.");
+
+        QCommandLineOption jobsOption("jobs", "Maximum number of jobs rendered at the same time, 0 for no limit.", "count", QString::number(0));
+        parser.addOption(jobsOption);
+        QCommandLineOption threadsOption("threads", "Processor threads shared by the jobs.", "count", QString::number(QThread::idealThreadCount()));
+        parser.addOption(threadsOption);
+        QCommandLineOption memoryOption("memory", "Memory in MB shared by the jobs, not limited if negative.", "size", QString::number(-1));
+        parser.addOption(memoryOption);
+
+        parser.process(app);
+        args = parser.positionalArguments();
+        if (args.count() != 2) {
+            qCritical() << "Error: wrong number of arguments specified\n";
+            parser.showHelp(1);
+            // the command above will quit the app with return 1;
+        }
+        RenderQueue queue(args.at(1));
+        if (!queue.load()) {
+            qCritical() << "Error: cannot read render queue" << args.at(1);
+            return 1;
+        }
+        // Jobs that were running when the previous session ended are rendered again
+        for (const RenderQueue::Job &job : queue.jobs()) {
+            if (job.status == RenderQueue::Running) {
+                queue.setStatus(job.output, RenderQueue::Waiting);
+            }
+        }
+        RenderQueue::Limits limits;
+        limits.jobs = parser.value(jobsOption).toInt();
+        limits.threads = qMax(1, parser.value(threadsOption).toInt());
+        limits.memory = parser.value(memoryOption).toInt();
+        return renderQueue(app, queue, limits);
+    }
+
     qCritical() << "Error: unknown mode" << mode << "\n";
     parser.showHelp(1);
     // the command above will quit the app with return 1;
@@ -5,6 +5,7 @@
 */
 
 #include "renderjob.h"
+#include "../src/render/rendersegments.h"
 
 #include <QStringList>
 #include <QThread>
@@ -16,8 +17,10 @@
 #endif
 #include <QDebug>
 #include <QDir>
+#include <QDomDocument>
 #include <QElapsedTimer>
 #include <QStandardPaths>
+#include <QTemporaryFile>
 #include <utility>
 // Can't believe I need to do this to sleep.
 class SleepThread : QThread
@@ -49,6 +52,8 @@ RenderJob::RenderJob(const QString &render, const QString &scenelist, const QStr
     , m_pid(pid)
     , m_dualpass(false)
     , m_subtitleFile(subtitleFile)
+    , m_segmentCount(1)
+    , m_status(0)
 {
     m_renderProcess = new QProcess(&m_looper);
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -81,6 +86,16 @@ RenderJob::~RenderJob()
     m_logfile.close();
 }
 
+void RenderJob::setSegments(int count)
+{
+    m_segmentCount = qMax(1, count);
+}
+
+int RenderJob::status() const
+{
+    return m_status;
+}
+
 void RenderJob::slotAbort(const QString &url)
 {
     if (m_dest == url) {
@@ -90,6 +105,7 @@ void RenderJob::slotAbort(const QString &url)
 
 void RenderJob::sendFinish(int status, const QString &error)
 {
+    m_status = status;
 #ifndef NODBUS
     if (m_kdenliveinterface) {
         m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), {m_dest, status, error});
@@ -118,6 +134,7 @@ void RenderJob::sendFinish(int status, const QString &error)
 
 void RenderJob::slotAbort()
 {
+    removeSegments();
     m_renderProcess->kill();
     sendFinish(-3, QString());
     if (m_erase) {
@@ -271,14 +288,235 @@ void RenderJob::start()
     }
 #endif
 
-    // Because of the logging, we connect to stderr in all cases.
-    connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
-    m_renderProcess->start(m_prog, m_args);
-    m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
-    m_logstream.flush();
+    if (prepareSegments()) {
+        startSegments();
+    } else {
+        // Because of the logging, we connect to stderr in all cases.
+        connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
+        m_renderProcess->start(m_prog, m_args);
+        m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+        m_logstream.flush();
+    }
     m_looper.exec();
 }
 
+bool RenderJob::prepareSegments()
+{
+    if (m_segmentCount < 2 || m_framein < 0 || m_frameout <= m_framein) {
+        return false;
+    }
+    if (QStandardPaths::findExecutable(QStringLiteral("ffmpeg")).isEmpty()) {
+        m_logstream << "ffmpeg not found, cannot join segments, rendering in a single process\n";
+        return false;
+    }
+    QFile f(m_scenelist.startsWith(QLatin1String("xml:")) ? m_scenelist.mid(4) : m_scenelist);
+    QDomDocument doc;
+    if (!f.open(QIODevice::ReadOnly) || !doc.setContent(&f, false)) {
+        return false;
+    }
+    f.close();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    if (consumer.isNull() || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat")) {
+        return false;
+    }
+    if (consumer.hasAttribute(QStringLiteral("pass")) || m_dest.contains(QLatin1Char('%'))) {
+        // Two pass encodings need the statistics of the whole range, image sequences are numbered by the consumer
+        m_logstream << "Render cannot be split, rendering in a single process\n";
+        return false;
+    }
+    const auto isSet = [&consumer](const QString &name) { return consumer.attribute(name) == QLatin1String("1"); };
+    if (isSet(QStringLiteral("vn")) || isSet(QStringLiteral("video_off"))) {
+        // Audio encodings are fast enough in a single process
+        return false;
+    }
+    const QList<int> starts = RenderSegments::split(m_framein, m_frameout, m_segmentCount, RenderSegments::cutPoints(doc));
+    if (starts.count() < 2) {
+        return false;
+    }
+    const QFileInfo destInfo(m_dest);
+    const auto addSegment = [&](int in, int out, const QString &name, bool audio) {
+        Segment segment;
+        segment.in = in;
+        segment.out = out;
+        segment.frame = in;
+        segment.audio = audio;
+        segment.process = nullptr;
+        segment.target = destInfo.absoluteDir().absoluteFilePath(QStringLiteral(".%1.%2.%3").arg(destInfo.completeBaseName(), name, destInfo.suffix()));
+        consumer.setAttribute(QStringLiteral("in"), segment.in);
+        consumer.setAttribute(QStringLiteral("out"), segment.out);
+        consumer.setAttribute(QStringLiteral("target"), segment.target);
+        QTemporaryFile tmp(QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-XXXXXX.mlt")));
+        tmp.setAutoRemove(false);
+        if (!tmp.open()) {
+            return false;
+        }
+        tmp.write(doc.toByteArray());
+        tmp.close();
+        segment.playlist = tmp.fileName();
+        m_segments.push_back(segment);
+        return true;
+    };
+    // Audio encoders add priming samples at the start of each encoding, joined audio parts would have gaps at the
+    // boundaries. So the audio is encoded once for the whole range and the parts only contain video.
+    if (!isSet(QStringLiteral("an")) && !isSet(QStringLiteral("audio_off"))) {
+        consumer.setAttribute(QStringLiteral("vn"), 1);
+        const bool added = addSegment(m_framein, m_frameout, QStringLiteral("audio"), true);
+        consumer.removeAttribute(QStringLiteral("vn"));
+        if (!added) {
+            removeSegments();
+            return false;
+        }
+    }
+    consumer.setAttribute(QStringLiteral("an"), 1);
+    // Every part is a separate encoding that starts with a key frame, closed GOPs keep them independent
+    QString flags = consumer.attribute(QStringLiteral("flags"));
+    if (!flags.contains(QLatin1String("cgop"))) {
+        consumer.setAttribute(QStringLiteral("flags"), flags + QStringLiteral("+cgop"));
+    }
+    for (int i = 0; i < starts.count(); ++i) {
+        const int out = i + 1 < starts.count() ? starts.at(i + 1) - 1 : m_frameout;
+        if (!addSegment(starts.at(i), out, QStringLiteral("part%1").arg(i), false)) {
+            removeSegments();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderJob::startSegments()
+{
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        auto *process = new QProcess(&m_looper);
+        process->setReadChannel(QProcess::StandardError);
+        connect(process, &QProcess::readyReadStandardError, this, [this, i]() { receivedSegmentStderr(i); });
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+                [this, i](int exitCode, QProcess::ExitStatus status) { slotSegmentFinished(i, exitCode, status); });
+        m_segments[i].process = process;
+        const QStringList args = {QStringLiteral("-progress"), m_segments[i].playlist};
+        process->start(m_prog, args);
+        m_logstream << "Started render process for frames " << m_segments[i].in << '-' << m_segments[i].out << ": " << m_prog << ' '
+                    << args.join(QLatin1Char(' ')) << "\n";
+    }
+    m_logstream.flush();
+}
+
+void RenderJob::receivedSegmentStderr(size_t index)
+{
+    Segment &segment = m_segments[index];
+    QString result = QString::fromLocal8Bit(segment.process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+        return;
+    }
+    segment.frame = qBound(segment.in, result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt(), segment.out + 1);
+    // Aggregate the progress of the video parts, the last percent is left for joining them
+    int done = 0;
+    for (const Segment &s : m_segments) {
+        if (!s.audio) {
+            done += s.frame - s.in;
+        }
+    }
+    int progress = qMin(99, int(qint64(done) * 100 / (m_frameout - m_framein + 1)));
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    qint64 elapsedTime = m_startTime.secsTo(QDateTime::currentDateTime());
+    if (elapsedTime == m_seconds) {
+        return;
+    }
+    int frame = m_framein + done;
+    int speed = (frame - m_frame) / (elapsedTime - m_seconds);
+    m_seconds = elapsedTime;
+    m_frame = frame;
+    updateProgress(speed);
+}
+
+void RenderJob::slotSegmentFinished(size_t index, int exitCode, QProcess::ExitStatus status)
+{
+    Segment &segment = m_segments[index];
+    if (status == QProcess::CrashExit || exitCode != 0 || !QFile::exists(segment.target)) {
+        QString error = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+        error += QLatin1Char('\n') + tr("Frame: %1").arg(segment.frame);
+        m_logstream << error << "\n";
+        removeSegments();
+        if (m_erase) {
+            QFile(m_scenelist).remove();
+        }
+        sendFinish(-2, m_errorMessage);
+        QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), error});
+        Q_EMIT renderingFinished();
+        m_looper.quit();
+        return;
+    }
+    segment.frame = segment.out + 1;
+    for (const Segment &s : m_segments) {
+        if (s.process->state() != QProcess::NotRunning) {
+            return;
+        }
+    }
+    concatenateSegments();
+}
+
+void RenderJob::concatenateSegments()
+{
+    QString audioFile;
+    QTemporaryFile list(QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-XXXXXX.txt")));
+    list.setAutoRemove(false);
+    if (list.open()) {
+        m_concatList = list.fileName();
+        QTextStream stream(&list);
+        for (const Segment &segment : m_segments) {
+            if (segment.audio) {
+                audioFile = segment.target;
+                continue;
+            }
+            QString path = segment.target;
+            stream << "file '" << path.replace(QLatin1Char('\''), QStringLiteral("'\\''")) << "'\n";
+        }
+        stream.flush();
+        list.close();
+    }
+    // The joining process takes the place of the render process, so that it gets the usual checks and subtitle embedding
+    QStringList args = {"-y", "-v", "error", "-f", "concat", "-safe", "0", "-i", m_concatList};
+    if (audioFile.isEmpty()) {
+        args << "-map" << "0";
+    } else {
+        // The video parts are joined and the audio encoded in a single pass is added to them
+        args << "-i" << audioFile << "-map" << "0:v" << "-map" << "1:a";
+    }
+    args << "-c" << "copy" << m_dest;
+    connect(m_renderProcess, &QProcess::readyReadStandardError, this, [this]() {
+        QString result = QString::fromLocal8Bit(m_renderProcess->readAllStandardError()).simplified();
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+    });
+    const QString ffmpegExe = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    m_renderProcess->start(ffmpegExe, args);
+    m_logstream << "Joining segments: " << ffmpegExe << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    m_logstream.flush();
+}
+
+void RenderJob::removeSegments()
+{
+    for (Segment &segment : m_segments) {
+        if (segment.process) {
+            segment.process->disconnect(this);
+            segment.process->kill();
+            segment.process->waitForFinished();
+            segment.process->deleteLater();
+        }
+        QFile::remove(segment.playlist);
+        QFile::remove(segment.target);
+    }
+    m_segments.clear();
+    if (!m_concatList.isEmpty()) {
+        QFile::remove(m_concatList);
+        m_concatList.clear();
+    }
+}
+
 #ifndef NODBUS
 void RenderJob::initKdenliveDbusInterface()
 {
@@ -327,6 +565,7 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
         Q_EMIT renderingFinished();
         // qApp->quit();
     }
+    removeSegments();
     if (m_erase) {
         QFile(m_scenelist).remove();
     }
@@ -18,6 +18,7 @@
 #include <QProcess>
 // Testing
 #include <QTextStream>
+#include <vector>
 
 class RenderJob : public QObject
 {
@@ -27,6 +28,11 @@ public:
     RenderJob(const QString &render, const QString &scenelist, const QString &target, int pid = -1, int in = -1, int out = -1,
               const QString &subtitleFile = QString(), QObject *parent = nullptr);
     ~RenderJob() override;
+    /** @brief Render the range in @param count parts at the same time, then join them without encoding again.
+        Ignored for renders that cannot be split, like two pass encodings or image sequences. */
+    void setSegments(int count);
+    /** @brief The last status sent to Kdenlive, -1 if the render succeeded */
+    int status() const;
 
 public Q_SLOTS:
     void start();
@@ -72,6 +78,34 @@ private:
     QStringList m_args;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
+    /** @brief A part of the range rendered by its own melt process */
+    struct Segment
+    {
+        QString playlist;
+        QString target;
+        int in;
+        int out;
+        int frame;
+        /** @brief True for the audio of the whole range, encoded once to avoid gaps between the parts */
+        bool audio;
+        QProcess *process;
+    };
+    /** @brief Number of segments requested with setSegments */
+    int m_segmentCount;
+    int m_status;
+    std::vector<Segment> m_segments;
+    /** @brief The list of segments passed to the ffmpeg concat demuxer */
+    QString m_concatList;
+    /** @brief Split the range at the cuts closest to equal parts and write a playlist for each part.
+        Returns false if the job must be rendered by a single process */
+    bool prepareSegments();
+    void startSegments();
+    void receivedSegmentStderr(size_t index);
+    void slotSegmentFinished(size_t index, int exitCode, QProcess::ExitStatus status);
+    /** @brief Join the rendered segments into the destination file */
+    void concatenateSegments();
+    /** @brief Stop the segment processes and delete their files */
+    void removeSegments();
 #ifdef NODBUS
     void fromServer();
 #else
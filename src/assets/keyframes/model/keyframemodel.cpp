@@ -90,6 +90,7 @@ void KeyframeModel::setup()
         Q_EMIT modelChanged();
     });
     connect(this, &KeyframeModel::modelChanged, this, &KeyframeModel::sendModification);
+    connect(this, &KeyframeModel::modelChanged, this, &KeyframeModel::invalidateAnimation);
 }
 
 bool KeyframeModel::addKeyframe(GenTime pos, KeyframeType type, QVariant value, bool notify, Fun &undo, Fun &redo)
@@ -240,12 +241,11 @@ bool KeyframeModel::removeKeyframe(GenTime pos)
 
 GenTime KeyframeModel::getPosAtIndex(int ix) const
 {
-    QList<GenTime> positions = getKeyframePos();
-    std::sort(positions.begin(), positions.end());
-    if (ix < 0 || ix >= positions.count()) {
+    if (ix < 0 || ix >= int(m_keyframeList.size())) {
         return GenTime();
     }
-    return positions.at(ix);
+    // The keyframes are sorted by position
+    return std::next(m_keyframeList.cbegin(), ix)->first;
 }
 
 bool KeyframeModel::moveKeyframe(GenTime oldPos, GenTime pos, const QVariant &newVal, Fun &undo, Fun &redo, bool updateView)
@@ -1162,41 +1162,19 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
     if (m_keyframeList.size() == 0) {
         return QVariant();
     }
-    Mlt::Properties mlt_prop;
     QString animData;
     int out = 0;
     bool useOpacity = false;
     if (auto ptr = m_model.lock()) {
-        ptr->passProperties(mlt_prop);
         out = ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
         useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
         animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
     }
 
-    if (!animData.isEmpty() && (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel)) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        return QVariant(mlt_prop.anim_get_double("key", pos.frames(pCore->getCurrentFps())));
-    }
-    if (!animData.isEmpty() && m_paramType == ParamType::AnimatedRect) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        mlt_rect rect = mlt_prop.anim_get_rect("key", pos.frames(pCore->getCurrentFps()));
-        QString res = QStringLiteral("%1 %2 %3 %4").arg(int(rect.x)).arg(int(rect.y)).arg(int(rect.w)).arg(int(rect.h));
-        if (useOpacity) {
-            res.append(QStringLiteral(" %1").arg(QString::number(rect.o, 'f')));
-        }
-        return QVariant(res);
-    }
-    if (!animData.isEmpty() && m_paramType == ParamType::Color) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        mlt_color mltColor = mlt_prop.anim_get_color("key", pos.frames(pCore->getCurrentFps()));
-        QColor color(mltColor.r, mltColor.g, mltColor.b, mltColor.a);
-        return QVariant(QColorUtils::colorToString(color, true));
+    if (!animData.isEmpty() && (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel || m_paramType == ParamType::AnimatedRect ||
+                                m_paramType == ParamType::Color)) {
+        QMutexLocker lock(&m_animationMutex);
+        return animationValue(animation(animData, out), pos.frames(pCore->getCurrentFps()), useOpacity);
     }
     if (m_paramType == ParamType::Roto_spline) {
         // interpolate
@@ -1242,6 +1220,91 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
     return QVariant();
 }
 
+QVector<QVariant> KeyframeModel::getInterpolatedValues(int start, int end) const
+{
+    QVector<QVariant> values;
+    if (end < start) {
+        return values;
+    }
+    values.reserve(end - start + 1);
+    QString animData;
+    int out = 0;
+    bool useOpacity = false;
+    if (auto ptr = m_model.lock()) {
+        out = ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
+        useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
+        animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
+    }
+    if (m_keyframeList.empty() || animData.isEmpty() ||
+        (m_paramType != ParamType::KeyframeParam && m_paramType != ParamType::ColorWheel && m_paramType != ParamType::AnimatedRect &&
+         m_paramType != ParamType::Color)) {
+        for (int frame = start; frame <= end; ++frame) {
+            values << getInterpolatedValue(frame);
+        }
+        return values;
+    }
+    // Query the model and parse the animation once for the whole range
+    const double fps = pCore->getCurrentFps();
+    QMutexLocker lock(&m_animationMutex);
+    Mlt::Properties *anim = animation(animData, out);
+    for (int frame = start; frame <= end; ++frame) {
+        // Same result as getInterpolatedValue, which returns the stored value on keyframes
+        auto keyframe = m_keyframeList.find(GenTime(frame, fps));
+        if (keyframe != m_keyframeList.end()) {
+            values << keyframe->second.second;
+        } else {
+            values << animationValue(anim, frame, useOpacity);
+        }
+    }
+    return values;
+}
+
+Mlt::Properties *KeyframeModel::animation(const QString &animData, int duration) const
+{
+    if (m_animation && duration == m_animationDuration && animData == m_animationData) {
+        return m_animation.get();
+    }
+    m_animation.reset(new Mlt::Properties());
+    if (auto ptr = m_model.lock()) {
+        ptr->passProperties(*m_animation.get());
+    }
+    m_animation->set("key", animData.toUtf8().constData());
+    // This is a fake query to force the animation to be parsed
+    (void)m_animation->anim_get_double("key", 0, duration);
+    m_animationData = animData;
+    m_animationDuration = duration;
+    return m_animation.get();
+}
+
+QVariant KeyframeModel::animationValue(Mlt::Properties *animation, int frame, bool useOpacity) const
+{
+    switch (m_paramType) {
+    case ParamType::AnimatedRect: {
+        mlt_rect rect = animation->anim_get_rect("key", frame);
+        QString res = QStringLiteral("%1 %2 %3 %4").arg(int(rect.x)).arg(int(rect.y)).arg(int(rect.w)).arg(int(rect.h));
+        if (useOpacity) {
+            res.append(QStringLiteral(" %1").arg(QString::number(rect.o, 'f')));
+        }
+        return QVariant(res);
+    }
+    case ParamType::Color: {
+        mlt_color mltColor = animation->anim_get_color("key", frame);
+        QColor color(mltColor.r, mltColor.g, mltColor.b, mltColor.a);
+        return QVariant(QColorUtils::colorToString(color, true));
+    }
+    default:
+        return QVariant(animation->anim_get_double("key", frame));
+    }
+}
+
+void KeyframeModel::invalidateAnimation()
+{
+    QMutexLocker lock(&m_animationMutex);
+    m_animation.reset();
+    m_animationData.clear();
+    m_animationDuration = -1;
+}
+
 void KeyframeModel::sendModification()
 {
     if (auto ptr = m_model.lock()) {
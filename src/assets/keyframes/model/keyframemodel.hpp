@@ -11,10 +11,12 @@
 #include "utils/gentime.h"
 
 #include <QAbstractListModel>
+#include <QMutex>
 #include <QReadWriteLock>
 #include <QtGlobal>
 
 #include <framework/mlt_version.h>
+#include <mlt++/MltProperties.h>
 
 #include <map>
 #include <memory>
@@ -168,6 +170,8 @@ public:
     /** @brief Return the interpolated value at given pos */
     QVariant getInterpolatedValue(int pos) const;
     QVariant getInterpolatedValue(const GenTime &pos) const;
+    /** @brief Return the interpolated values of all frames from @param start to @param end included, as getInterpolatedValue() would for each frame */
+    QVector<QVariant> getInterpolatedValues(int start, int end) const;
     QVariant updateInterpolated(const QVariant &interpValue, double val);
     /** @brief Return the real value from a normalized one */
     QVariant getNormalizedValue(double newVal) const;
@@ -233,6 +237,18 @@ private:
     mutable QReadWriteLock m_lock;
 
     std::map<GenTime, std::pair<KeyframeType, QVariant>> m_keyframeList;
+
+    /** @brief The parsed animation of the parameter value, reused by the interpolation queries until the keyframes change */
+    mutable QMutex m_animationMutex;
+    mutable std::unique_ptr<Mlt::Properties> m_animation;
+    mutable QString m_animationData;
+    mutable int m_animationDuration{-1};
+    /** @brief Returns the parsed animation of @param animData, m_animationMutex must be locked */
+    Mlt::Properties *animation(const QString &animData, int duration) const;
+    /** @brief Returns the value of the parsed animation at @param frame */
+    QVariant animationValue(Mlt::Properties *animation, int frame, bool useOpacity) const;
+    void invalidateAnimation();
+
     bool moveOneKeyframe(GenTime oldPos, GenTime pos, QVariant newVal, Fun &undo, Fun &redo, bool updateView = true);
 
 Q_SIGNALS:
@@ -6,11 +6,25 @@
 #include "filewatcher.hpp"
 
 #include <KDirWatch>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QtConcurrent>
+
+namespace {
+// Watch the folder instead of its files when it contains that many clips
+constexpr size_t folderThreshold = 8;
+// Maximum number of KDirWatch entries, inotify watches are a limited system resource
+constexpr size_t watchBudget = 2000;
+// Time spent registering queued files before giving control back to the event loop
+constexpr qint64 queueSlice = 50;
+constexpr int queueDelay = 300;
+constexpr int pollInterval = 5000;
+} // namespace
 
 FileWatcher::FileWatcher(QObject *parent)
     : QObject(parent)
     , m_fileWatcher(new KDirWatch)
+    , m_watchBudget(watchBudget)
 {
     // Init clip modification tracker
     m_modifiedTimer.setInterval(2000);
@@ -18,9 +32,12 @@ FileWatcher::FileWatcher(QObject *parent)
     connect(m_fileWatcher.get(), &KDirWatch::deleted, this, &FileWatcher::slotUrlMissing);
     connect(m_fileWatcher.get(), &KDirWatch::created, this, &FileWatcher::slotUrlAdded);
     connect(&m_modifiedTimer, &QTimer::timeout, this, &FileWatcher::slotProcessModifiedUrls);
-    m_queueTimer.setInterval(300);
+    m_queueTimer.setInterval(queueDelay);
     m_queueTimer.setSingleShot(true);
     connect(&m_queueTimer, &QTimer::timeout, this, &FileWatcher::slotProcessQueue);
+    m_pollTimer.setInterval(pollInterval);
+    connect(&m_pollTimer, &QTimer::timeout, this, &FileWatcher::slotPollUrls);
+    connect(&m_pollWatcher, &QFutureWatcher<std::unordered_map<QString, PollState>>::finished, this, &FileWatcher::slotPollFinished);
 }
 
 void FileWatcher::slotProcessQueue()
@@ -28,11 +45,20 @@ void FileWatcher::slotProcessQueue()
     if (m_pendingUrls.size() == 0) {
         return;
     }
-    auto iter = m_pendingUrls.begin();
-    doAddFile(iter->first, iter->second);
-    m_pendingUrls.erase(iter->first);
-    if (m_pendingUrls.size() > 0 && !m_queueTimer.isActive()) {
-        m_queueTimer.start();
+    // Register the queued files in batches, only yielding to the event loop when a batch took too long
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_pendingUrls.empty() && timer.elapsed() < queueSlice) {
+        std::vector<std::pair<QString, QString>> batch;
+        auto iter = m_pendingUrls.begin();
+        while (iter != m_pendingUrls.end() && batch.size() < 200) {
+            batch.emplace_back(iter->first, iter->second);
+            iter = m_pendingUrls.erase(iter);
+        }
+        doAddFiles(batch);
+    }
+    if (m_pendingUrls.size() > 0) {
+        m_queueTimer.start(0);
     }
 }
 
@@ -49,21 +75,101 @@ void FileWatcher::addFile(const QString &binId, const QString &url)
     }
     m_pendingUrls[binId] = url;
     if (!m_queueTimer.isActive()) {
-        m_queueTimer.start();
+        m_queueTimer.start(queueDelay);
     }
 }
 
-void FileWatcher::doAddFile(const QString &binId, const QString &url)
+void FileWatcher::doAddFiles(const std::vector<std::pair<QString, QString>> &files)
+{
+    // Register all the new urls first, so that folders containing many of them get a single watch
+    std::vector<QString> newUrls;
+    for (const auto &file : files) {
+        const QString &url = file.second;
+        if (url.isEmpty()) {
+            continue;
+        }
+        if (m_occurences.count(url) == 0) {
+            newUrls.push_back(url);
+            m_folderUrls[QFileInfo(url).absolutePath()].insert(url);
+        }
+        m_occurences[url].insert(file.first);
+        m_binClipPaths[file.first] = url;
+    }
+    for (const QString &url : newUrls) {
+        watchUrl(url);
+    }
+    // Read the initial state of the urls above the budget
+    slotPollUrls();
+}
+
+size_t FileWatcher::watchCount() const
+{
+    return m_watchedFiles.size() + m_watchedFolders.size();
+}
+
+void FileWatcher::watchUrl(const QString &url)
 {
-    if (url.isEmpty()) {
+    const QString folder = QFileInfo(url).absolutePath();
+    if (m_watchedFolders.count(folder) > 0) {
+        return;
+    }
+    const std::unordered_set<QString> &folderUrls = m_folderUrls[folder];
+    if (folderUrls.size() >= folderThreshold && watchCount() < m_watchBudget) {
+        // Replace the watches of the individual files of this folder with a single one
+        m_fileWatcher->addDir(folder, KDirWatch::WatchFiles);
+        m_watchedFolders.insert(folder);
+        for (const QString &path : folderUrls) {
+            if (m_watchedFiles.erase(path) > 0) {
+                m_fileWatcher->removeFile(path);
+            }
+            m_polledUrls.erase(path);
+        }
         return;
     }
-    if (m_occurences.count(url) == 0) {
-        // QtConcurrent::run([=] { KDirWatch::self()->addFile(url); });
+    if (watchCount() < m_watchBudget) {
         m_fileWatcher->addFile(url);
+        m_watchedFiles.insert(url);
+        return;
+    }
+    // The state of the file is read by the next poll
+    m_polledUrls[url] = PollState();
+    if (!m_pollTimer.isActive()) {
+        m_pollTimer.start();
+    }
+}
+
+void FileWatcher::unwatchUrl(const QString &url)
+{
+    if (m_watchedFiles.erase(url) > 0) {
+        m_fileWatcher->removeFile(url);
+    }
+    m_polledUrls.erase(url);
+    m_modifiedUrls.erase(url);
+    const QString folder = QFileInfo(url).absolutePath();
+    auto folderIter = m_folderUrls.find(folder);
+    if (folderIter != m_folderUrls.end()) {
+        folderIter->second.erase(url);
+        if (folderIter->second.empty()) {
+            m_folderUrls.erase(folderIter);
+            if (m_watchedFolders.erase(folder) > 0) {
+                m_fileWatcher->removeDir(folder);
+            }
+        }
+    }
+    promotePolledUrls();
+}
+
+void FileWatcher::promotePolledUrls()
+{
+    while (!m_polledUrls.empty() && watchCount() < m_watchBudget) {
+        // Watching a folder can remove several polled urls, so restart from the first one
+        const QString url = m_polledUrls.begin()->first;
+        m_polledUrls.erase(m_polledUrls.begin());
+        watchUrl(url);
+    }
+    if (m_polledUrls.empty()) {
+        m_pollTimer.stop();
     }
-    m_occurences[url].insert(binId);
-    m_binClipPaths[binId] = url;
 }
 
 void FileWatcher::removeFile(const QString &binId)
@@ -75,13 +181,17 @@ void FileWatcher::removeFile(const QString &binId)
     m_occurences[url].erase(binId);
     m_binClipPaths.erase(binId);
     if (m_occurences[url].empty()) {
-        m_fileWatcher->removeFile(url);
+        unwatchUrl(url);
         m_occurences.erase(url);
     }
 }
 
 void FileWatcher::slotUrlModified(const QString &path)
 {
+    if (m_occurences.count(path) == 0) {
+        // Another file of a watched folder
+        return;
+    }
     if (m_modifiedUrls.insert(path).second) {
         for (const QString &id : m_occurences[path]) {
             Q_EMIT binClipWaiting(id);
@@ -94,6 +204,9 @@ void FileWatcher::slotUrlModified(const QString &path)
 
 void FileWatcher::slotUrlAdded(const QString &path)
 {
+    if (m_occurences.count(path) == 0) {
+        return;
+    }
     for (const QString &id : m_occurences[path]) {
         Q_EMIT binClipModified(id);
     }
@@ -101,6 +214,9 @@ void FileWatcher::slotUrlAdded(const QString &path)
 
 void FileWatcher::slotUrlMissing(const QString &path)
 {
+    if (m_occurences.count(path) == 0) {
+        return;
+    }
     for (const QString &id : m_occurences[path]) {
         Q_EMIT binClipMissing(id);
     }
@@ -108,27 +224,25 @@ void FileWatcher::slotUrlMissing(const QString &path)
 
 void FileWatcher::slotProcessModifiedUrls()
 {
-    auto checkList = m_modifiedUrls;
-    for (const QString &path : checkList) {
-        if (m_fileWatcher->ctime(path).msecsTo(QDateTime::currentDateTime()) > 2000) {
-            for (const QString &id : m_occurences[path]) {
-                Q_EMIT binClipModified(id);
-            }
-            m_modifiedUrls.erase(path);
-        }
-    }
-    if (m_modifiedUrls.empty()) {
-        m_modifiedTimer.stop();
-    }
+    // KDirWatch has no timestamp for the files of watched folders and polled files, they are queried by the poll
+    slotPollUrls();
 }
 
 void FileWatcher::clear()
 {
     m_queueTimer.stop();
+    m_pollTimer.stop();
     m_fileWatcher->stopScan();
-    for (const auto &f : m_occurences) {
-        m_fileWatcher->removeFile(f.first);
+    for (const QString &path : m_watchedFiles) {
+        m_fileWatcher->removeFile(path);
     }
+    for (const QString &folder : m_watchedFolders) {
+        m_fileWatcher->removeDir(folder);
+    }
+    m_watchedFiles.clear();
+    m_watchedFolders.clear();
+    m_folderUrls.clear();
+    m_polledUrls.clear();
     m_pendingUrls.clear();
     m_occurences.clear();
     m_modifiedUrls.clear();
@@ -138,5 +252,98 @@ void FileWatcher::clear()
 
 bool FileWatcher::contains(const QString &path) const
 {
-    return m_fileWatcher->contains(path);
+    if (m_occurences.count(path) > 0) {
+        return true;
+    }
+    for (const auto &pending : m_pendingUrls) {
+        if (pending.second == path) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// static
+FileWatcher::PollState FileWatcher::pollState(const QString &path)
+{
+    QFileInfo info(path);
+    PollState state;
+    state.known = true;
+    state.exists = info.exists();
+    if (state.exists) {
+        state.changed = info.metadataChangeTime();
+    }
+    return state;
+}
+
+void FileWatcher::slotPollUrls()
+{
+    if (m_pollWatcher.isRunning() || (m_polledUrls.empty() && m_modifiedUrls.empty())) {
+        return;
+    }
+    QStringList paths;
+    paths.reserve(int(m_polledUrls.size() + m_modifiedUrls.size()));
+    for (const auto &polled : m_polledUrls) {
+        paths << polled.first;
+    }
+    for (const QString &path : m_modifiedUrls) {
+        if (m_polledUrls.count(path) == 0) {
+            paths << path;
+        }
+    }
+    // Querying files can block on network storage, so do it in a background thread
+    m_pollWatcher.setFuture(QtConcurrent::run([paths]() {
+        std::unordered_map<QString, PollState> states;
+        for (const QString &path : paths) {
+            states[path] = pollState(path);
+        }
+        return states;
+    }));
+}
+
+void FileWatcher::slotPollFinished()
+{
+    const std::unordered_map<QString, PollState> states = m_pollWatcher.result();
+    for (const auto &state : states) {
+        auto iter = m_polledUrls.find(state.first);
+        if (iter == m_polledUrls.end()) {
+            // File is not polled, or was removed from the project during the poll
+            continue;
+        }
+        const PollState previous = iter->second;
+        iter->second = state.second;
+        if (!previous.known) {
+            // First poll of the file
+            continue;
+        }
+        if (previous.exists && !state.second.exists) {
+            slotUrlMissing(state.first);
+        } else if (!previous.exists && state.second.exists) {
+            slotUrlAdded(state.first);
+        } else if (state.second.exists && previous.changed != state.second.changed) {
+            slotUrlModified(state.first);
+        }
+    }
+    // Files are only reloaded when they were not modified for a while, so that they are not read while being written
+    const QDateTime now = QDateTime::currentDateTime();
+    auto checkList = m_modifiedUrls;
+    for (const QString &path : checkList) {
+        auto state = states.find(path);
+        if (state == states.end()) {
+            // Modified after the poll started
+            continue;
+        }
+        if (!state->second.exists) {
+            // Deleted while waiting, KDirWatch or the poll reports it as missing
+            m_modifiedUrls.erase(path);
+        } else if (state->second.changed.msecsTo(now) > 2000) {
+            for (const QString &id : m_occurences.at(path)) {
+                Q_EMIT binClipModified(id);
+            }
+            m_modifiedUrls.erase(path);
+        }
+    }
+    if (m_modifiedUrls.empty()) {
+        m_modifiedTimer.stop();
+    }
 }
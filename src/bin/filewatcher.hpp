@@ -7,6 +7,8 @@
 
 #include "definitions.h"
 #include <KDirWatch>
+#include <QDateTime>
+#include <QFutureWatcher>
 #include <QTimer>
 #include <unordered_map>
 #include <unordered_set>
@@ -14,6 +16,10 @@
 /** @class FileWatcher
     @brief This class is responsible for watching all files used in the project
     and triggers a reload notification when a file changes.
+    Files are registered in batches. When many files share a folder, the folder is watched
+    instead of each file. The number of watches is bounded, the files above that limit are
+    polled in a background thread and watched again when watches are released.
+    Files are only queried in the background thread, never on the GUI thread.
  */
 class FileWatcher : public QObject
 {
@@ -45,6 +51,8 @@ private Q_SLOTS:
     void slotUrlAdded(const QString &path);
     void slotProcessModifiedUrls();
     void slotProcessQueue();
+    void slotPollUrls();
+    void slotPollFinished();
 
 private:
     /// This is a handle to the watcher singleton, not owned by this class.
@@ -60,8 +68,38 @@ private:
     /// When loading a project or adding many clips, adding many files to the watcher causes a freeze, so queue them
     std::unordered_map<QString, QString> m_pendingUrls;
 
+    /// Keys are folders, values are the watched urls in this folder
+    std::unordered_map<QString, std::unordered_set<QString>> m_folderUrls;
+    /// Folders watched as a whole
+    std::unordered_set<QString> m_watchedFolders;
+    /// Urls watched individually
+    std::unordered_set<QString> m_watchedFiles;
+    /// The state of a polled file, compared on each poll
+    struct PollState
+    {
+        /// False until the file was queried by a first poll
+        bool known{false};
+        bool exists{false};
+        QDateTime changed;
+    };
+    /// Maximum number of KDirWatch entries
+    size_t m_watchBudget;
+    /// Urls above the watch budget, checked by polling
+    std::unordered_map<QString, PollState> m_polledUrls;
+    QFutureWatcher<std::unordered_map<QString, PollState>> m_pollWatcher;
+
     QTimer m_modifiedTimer;
     QTimer m_queueTimer;
-    /// Add a file to the list of watched items
-    void doAddFile(const QString &binId, const QString &url);
+    QTimer m_pollTimer;
+    /// Add a batch of files to the list of watched items
+    void doAddFiles(const std::vector<std::pair<QString, QString>> &files);
+    /// Start watching a new url, individually or through its folder
+    void watchUrl(const QString &url);
+    /// Stop watching an url that is not used anymore
+    void unwatchUrl(const QString &url);
+    /// Number of KDirWatch entries in use
+    size_t watchCount() const;
+    /// Watch polled urls again while the watch budget allows it
+    void promotePolledUrls();
+    static PollState pollState(const QString &path);
 };
@@ -28,6 +28,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QRegularExpression>
+#include <algorithm>
 #include <utility>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <QStringConverter>
@@ -65,7 +66,11 @@ SubtitleModel::SubtitleModel(std::shared_ptr<TimelineItemModel> timeline, const
             .arg(fontMargin);
     eventSection = QStringLiteral("[Events]\n");
     styleName = QStringLiteral("Default");
-    connect(this, &SubtitleModel::modelChanged, [this]() { jsontoSubtitle(toJson()); });
+    // Consecutive edits (typing in the subtitle editor, dragging) only rewrite the subtitle file once
+    m_fileUpdateTimer.setSingleShot(true);
+    m_fileUpdateTimer.setInterval(250);
+    connect(&m_fileUpdateTimer, &QTimer::timeout, this, &SubtitleModel::updateSubtitleFile);
+    connect(this, &SubtitleModel::modelChanged, &m_fileUpdateTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     int id = pCore->currentDoc()->getSequenceProperty(timeline->uuid(), QStringLiteral("kdenlive:activeSubtitleIndex"), QStringLiteral("0")).toInt();
     const QString subPath = pCore->currentDoc()->subTitlePath(timeline->uuid(), id, true);
     const QString workPath = pCore->currentDoc()->subTitlePath(timeline->uuid(), id, false);
@@ -419,7 +424,7 @@ void SubtitleModel::parseSubtitle(const QString &workPath)
     }
     QString filePath = m_subtitleFilter->get("av.filename");
     importSubtitle(filePath, 0, false);
-    // jsontoSubtitle(toJson());
+    // updateSubtitleFile();
 }
 
 const QString SubtitleModel::getUrl()
@@ -509,6 +514,7 @@ bool SubtitleModel::addSubtitle(int id, GenTime start, GenTime end, const QStrin
     int row = getSubtitleIndex(id);
     beginInsertRows(QModelIndex(), row, row);
     m_subtitleList[start] = {str, end};
+    m_rangeIndexDirty = true;
     endInsertRows();
     addSnapPoint(start);
     addSnapPoint(end);
@@ -639,17 +645,20 @@ std::unordered_set<int> SubtitleModel::getItemsInRange(int startFrame, int endFr
     GenTime startTime(startFrame, pCore->getCurrentFps());
     GenTime endTime(endFrame, pCore->getCurrentFps());
     std::unordered_set<int> matching;
-    for (const auto &subtitles : m_subtitleList) {
-        if (endFrame > -1 && subtitles.first > endTime) {
+    const std::vector<SubtitleSpan> &spans = rangeIndex();
+    // Skip the subtitles that all end before the range
+    auto it = std::lower_bound(spans.cbegin(), spans.cend(), startTime, [](const SubtitleSpan &span, GenTime time) { return span.maxEnd < time; });
+    for (; it != spans.cend(); ++it) {
+        if (endFrame > -1 && it->start > endTime) {
             // Outside range
-            continue;
+            break;
         }
-        if (subtitles.first >= startTime || subtitles.second.second > startTime) {
-            int sid = getIdForStartPos(subtitles.first);
+        if (it->start >= startTime || it->end > startTime) {
+            int sid = getIdForStartPos(it->start);
             if (sid > -1) {
                 matching.emplace(sid);
             } else {
-                qDebug() << "==== FOUND INVALID SUBTILE AT: " << subtitles.first.frames(pCore->getCurrentFps());
+                qDebug() << "==== FOUND INVALID SUBTILE AT: " << it->start.frames(pCore->getCurrentFps());
             }
         }
     }
@@ -674,9 +683,11 @@ int SubtitleModel::cutSubtitle(int position, Fun &undo, Fun &redo)
     }
     GenTime pos(position, pCore->getCurrentFps());
     GenTime start = GenTime(-1);
-    for (const auto &subtitles : m_subtitleList) {
-        if (subtitles.first <= pos && subtitles.second.second > pos) {
-            start = subtitles.first;
+    const std::vector<SubtitleSpan> &spans = rangeIndex();
+    auto it = std::upper_bound(spans.cbegin(), spans.cend(), pos, [](GenTime time, const SubtitleSpan &span) { return time < span.maxEnd; });
+    for (; it != spans.cend() && it->start <= pos; ++it) {
+        if (it->end > pos) {
+            start = it->start;
             break;
         }
     }
@@ -781,6 +792,7 @@ void SubtitleModel::editEndPos(GenTime startPos, GenTime newEndPos, bool refresh
         return;
     }
     m_subtitleList[startPos].second = newEndPos;
+    m_rangeIndexDirty = true;
     // Trigger update of the qml view
     int id = getIdForStartPos(startPos);
     int row = getSubtitleIndex(id);
@@ -845,6 +857,7 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
         GenTime newEndPos = startPos + GenTime(size, pCore->getCurrentFps());
         operation = [this, id, startPos, endPos, newEndPos, logUndo]() {
             m_subtitleList[startPos].second = newEndPos;
+            m_rangeIndexDirty = true;
             removeSnapPoint(endPos);
             addSnapPoint(newEndPos);
             // Trigger update of the qml view
@@ -865,6 +878,7 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
         };
         reverse = [this, id, startPos, endPos, newEndPos, logUndo]() {
             m_subtitleList[startPos].second = endPos;
+            m_rangeIndexDirty = true;
             removeSnapPoint(newEndPos);
             addSnapPoint(endPos);
             // Trigger update of the qml view
@@ -891,9 +905,10 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
         }
         const QString text = m_subtitleList.at(startPos).first;
         operation = [this, id, startPos, newStartPos, endPos, text, logUndo]() {
-            m_allSubtitles[id] = newStartPos;
+            setSubtitleStart(id, newStartPos);
             m_subtitleList.erase(startPos);
             m_subtitleList[newStartPos] = {text, endPos};
+            m_rangeIndexDirty = true;
             // Trigger update of the qml view
             removeSnapPoint(startPos);
             addSnapPoint(newStartPos);
@@ -913,9 +928,10 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
             return true;
         };
         reverse = [this, id, startPos, newStartPos, endPos, text, logUndo]() {
-            m_allSubtitles[id] = startPos;
+            setSubtitleStart(id, startPos);
             m_subtitleList.erase(newStartPos);
             m_subtitleList[startPos] = {text, endPos};
+            m_rangeIndexDirty = true;
             removeSnapPoint(newStartPos);
             addSnapPoint(startPos);
             // Trigger update of the qml view
@@ -988,6 +1004,7 @@ bool SubtitleModel::removeSubtitle(int id, bool temporary, bool updateFilter)
         lastSub = true;
     }
     m_subtitleList.erase(start);
+    m_rangeIndexDirty = true;
     endRemoveRows();
     removeSnapPoint(start);
     removeSnapPoint(end);
@@ -1040,9 +1057,10 @@ bool SubtitleModel::moveSubtitle(int subId, GenTime newPos, bool updateModel, bo
     GenTime duration = m_subtitleList[oldPos].second - oldPos;
     GenTime endPos = newPos + duration;
     int id = getIdForStartPos(oldPos);
-    m_allSubtitles[id] = newPos;
+    setSubtitleStart(id, newPos);
     m_subtitleList.erase(oldPos);
     m_subtitleList[newPos] = {subtitleText, endPos};
+    m_rangeIndexDirty = true;
     addSnapPoint(newPos);
     addSnapPoint(endPos);
     if (updateView) {
@@ -1069,14 +1087,30 @@ bool SubtitleModel::moveSubtitle(int subId, GenTime newPos, bool updateModel, bo
 
 int SubtitleModel::getIdForStartPos(GenTime startTime) const
 {
-    auto findResult =
-        std::find_if(std::begin(m_allSubtitles), std::end(m_allSubtitles), [&](const std::pair<int, GenTime> &pair) { return pair.second == startTime; });
-    if (findResult != std::end(m_allSubtitles)) {
-        return findResult->first;
+    auto findResult = m_startPosIds.find(startTime);
+    if (findResult != m_startPosIds.end()) {
+        return findResult->second;
     }
     return -1;
 }
 
+const std::vector<SubtitleModel::SubtitleSpan> &SubtitleModel::rangeIndex() const
+{
+    if (m_rangeIndexDirty) {
+        m_rangeIndex.clear();
+        m_rangeIndex.reserve(m_subtitleList.size());
+        GenTime maxEnd;
+        for (const auto &subtitle : m_subtitleList) {
+            if (m_rangeIndex.empty() || subtitle.second.second > maxEnd) {
+                maxEnd = subtitle.second.second;
+            }
+            m_rangeIndex.push_back({subtitle.first, subtitle.second.second, maxEnd});
+        }
+        m_rangeIndexDirty = false;
+    }
+    return m_rangeIndex;
+}
+
 GenTime SubtitleModel::getStartPosForId(int id) const
 {
     if (m_allSubtitles.count(id) == 0) {
@@ -1088,13 +1122,10 @@ GenTime SubtitleModel::getStartPosForId(int id) const
 int SubtitleModel::getPreviousSub(int id) const
 {
     GenTime start = getStartPosForId(id);
-    int row = static_cast<int>(std::distance(m_subtitleList.begin(), m_subtitleList.find(start)));
-    if (row > 0) {
-        row--;
-        auto it = m_subtitleList.begin();
-        std::advance(it, row);
-        const GenTime res = it->first;
-        return getIdForStartPos(res);
+    auto it = m_subtitleList.find(start);
+    if (it != m_subtitleList.begin()) {
+        --it;
+        return getIdForStartPos(it->first);
     }
     return -1;
 }
@@ -1102,24 +1133,20 @@ int SubtitleModel::getPreviousSub(int id) const
 int SubtitleModel::getNextSub(int id) const
 {
     GenTime start = getStartPosForId(id);
-    int row = static_cast<int>(std::distance(m_subtitleList.begin(), m_subtitleList.find(start)));
-    if (row < static_cast<int>(m_subtitleList.size()) - 1) {
-        row++;
-        auto it = m_subtitleList.begin();
-        std::advance(it, row);
-        const GenTime res = it->first;
-        return getIdForStartPos(res);
+    auto it = m_subtitleList.find(start);
+    if (it != m_subtitleList.end() && ++it != m_subtitleList.end()) {
+        return getIdForStartPos(it->first);
     }
     return -1;
 }
 
 void SubtitleModel::subtitleFileFromZone(int in, int out, const QString &outFile)
 {
-    QJsonArray list;
+    std::map<GenTime, std::pair<QString, GenTime>> subtitles;
     double fps = pCore->getCurrentFps();
     GenTime zoneIn(in, fps);
     GenTime zoneOut(out, fps);
-    for (auto subtitle : m_subtitleList) {
+    for (const auto &subtitle : m_subtitleList) {
         GenTime inTime = subtitle.first;
         GenTime outTime = subtitle.second.second;
         if (outTime < zoneIn) {
@@ -1138,17 +1165,9 @@ void SubtitleModel::subtitleFileFromZone(int in, int out, const QString &outFile
         }
         inTime -= zoneIn;
         outTime -= zoneIn;
-
-        QJsonObject currentSubtitle;
-        currentSubtitle.insert(QLatin1String("startPos"), QJsonValue(inTime.seconds()));
-        currentSubtitle.insert(QLatin1String("dialogue"), QJsonValue(subtitle.second.first));
-        currentSubtitle.insert(QLatin1String("endPos"), QJsonValue(outTime.seconds()));
-        list.push_back(currentSubtitle);
-        // qDebug()<<subtitle.first.seconds();
+        subtitles[inTime] = {subtitle.second.first, outTime};
     }
-    QJsonDocument jsonDoc(list);
-    QString subData = QString(jsonDoc.toJson());
-    saveSubtitleData(subData, outFile);
+    saveSubtitleData(subtitles, outFile);
 }
 
 QString SubtitleModel::toJson()
@@ -1170,6 +1189,7 @@ QString SubtitleModel::toJson()
 
 void SubtitleModel::copySubtitle(const QString &path, int ix, bool checkOverwrite, bool updateFilter)
 {
+    flushSubtitleFile();
     QFile srcFile(pCore->currentDoc()->subTitlePath(m_timeline->uuid(), ix, false));
     if (srcFile.exists()) {
         QFile prev(path);
@@ -1198,15 +1218,26 @@ void SubtitleModel::restoreTmpFile(int ix)
     m_subtitleFilter->set("av.filename", outFile.toUtf8().constData());
 }
 
-void SubtitleModel::jsontoSubtitle(const QString &data)
+void SubtitleModel::flushSubtitleFile()
+{
+    if (m_fileUpdateTimer.isActive()) {
+        m_fileUpdateTimer.stop();
+        updateSubtitleFile();
+    }
+}
+
+void SubtitleModel::updateSubtitleFile()
 {
+    if (!m_timeline || !pCore->currentDoc()) {
+        return;
+    }
     int ix = pCore->currentDoc()->getSequenceProperty(m_timeline->uuid(), QStringLiteral("kdenlive:activeSubtitleIndex"), QStringLiteral("0")).toInt();
     QString outFile = pCore->currentDoc()->subTitlePath(m_timeline->uuid(), ix, false);
     QString masterFile = m_subtitleFilter->get("av.filename");
     if (masterFile.isEmpty()) {
         m_subtitleFilter->set("av.filename", outFile.toUtf8().constData());
     }
-    int line = saveSubtitleData(data, outFile);
+    int line = saveSubtitleData(m_subtitleList, outFile);
     qDebug() << "Saving subtitle filter: " << outFile;
     if (line > 0) {
         m_subtitleFilter->set("av.filename", outFile.toUtf8().constData());
@@ -1216,23 +1247,42 @@ void SubtitleModel::jsontoSubtitle(const QString &data)
     }
 }
 
-int SubtitleModel::saveSubtitleData(const QString &data, const QString &outFile)
+namespace {
+// Formats a time as hh:mm:ss.SS (in .ass) or hh:mm:ss,SSS (in .srt)
+QString subtitleTime(GenTime time, bool assFormat)
+{
+    int millisec = int(time.seconds() * 1000);
+    int seconds = millisec / 1000;
+    millisec %= 1000;
+    int minutes = seconds / 60;
+    seconds %= 60;
+    int hours = minutes / 60;
+    minutes %= 60;
+    if (assFormat) {
+        // limit ms to 2 digits
+        return QString("%1:%2:%3.%4")
+            .arg(hours, 2, 10, QChar('0'))
+            .arg(minutes, 2, 10, QChar('0'))
+            .arg(seconds, 2, 10, QChar('0'))
+            .arg(millisec / 10, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2:%3,%4")
+        .arg(hours, 2, 10, QChar('0'))
+        .arg(minutes, 2, 10, QChar('0'))
+        .arg(seconds, 2, 10, QChar('0'))
+        .arg(millisec, 3, 10, QChar('0'));
+}
+} // namespace
+
+int SubtitleModel::saveSubtitleData(const std::map<GenTime, std::pair<QString, GenTime>> &subtitles, const QString &outFile)
 {
     bool assFormat = outFile.endsWith(".ass");
     if (!assFormat) {
         qDebug() << "srt/vtt/sbv file import"; // if imported file isn't .ass, it is .srt format
     }
     QFile outF(outFile);
-
-    // qDebug()<< "Import from JSON";
     QWriteLocker locker(&m_lock);
-    auto json = QJsonDocument::fromJson(data.toUtf8());
-    if (!json.isArray()) {
-        qDebug() << "Error : Json file should be an array";
-        return 0;
-    }
     int line = 0;
-    auto list = json.array();
     if (outF.open(QIODevice::WriteOnly)) {
         QTextStream out(&outF);
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -1243,67 +1293,17 @@ int SubtitleModel::saveSubtitleData(const QString &data, const QString &outFile)
             out << styleSection << '\n';
             out << eventSection;
         }
-        for (const auto &entry : qAsConst(list)) {
-            if (!entry.isObject()) {
-                qDebug() << "Warning : Skipping invalid subtitle data";
-                continue;
-            }
-            auto entryObj = entry.toObject();
-            if (!entryObj.contains(QLatin1String("startPos"))) {
-                qDebug() << "Warning : Skipping invalid subtitle data (does not contain position)";
-                continue;
-            }
-            double startPos = entryObj[QLatin1String("startPos")].toDouble();
-            // convert seconds to FORMAT= hh:mm:ss.SS (in .ass) and hh:mm:ss,SSS (in .srt)
-            int millisec = int(startPos * 1000);
-            int seconds = millisec / 1000;
-            millisec %= 1000;
-            int minutes = seconds / 60;
-            seconds %= 60;
-            int hours = minutes / 60;
-            minutes %= 60;
-            int milli_2 = millisec / 10;
-            QString startTimeString = QString("%1:%2:%3.%4")
-                                          .arg(hours, 2, 10, QChar('0'))
-                                          .arg(minutes, 2, 10, QChar('0'))
-                                          .arg(seconds, 2, 10, QChar('0'))
-                                          .arg(milli_2, 2, 10, QChar('0'));
-            QString startTimeStringSRT = QString("%1:%2:%3,%4")
-                                             .arg(hours, 2, 10, QChar('0'))
-                                             .arg(minutes, 2, 10, QChar('0'))
-                                             .arg(seconds, 2, 10, QChar('0'))
-                                             .arg(millisec, 3, 10, QChar('0'));
-            QString dialogue = entryObj[QLatin1String("dialogue")].toString();
-            double endPos = entryObj[QLatin1String("endPos")].toDouble();
-            millisec = int(endPos * 1000);
-            seconds = millisec / 1000;
-            millisec %= 1000;
-            minutes = seconds / 60;
-            seconds %= 60;
-            hours = minutes / 60;
-            minutes %= 60;
-
-            milli_2 = millisec / 10; // to limit ms to 2 digits (for .ass)
-            QString endTimeString = QString("%1:%2:%3.%4")
-                                        .arg(hours, 2, 10, QChar('0'))
-                                        .arg(minutes, 2, 10, QChar('0'))
-                                        .arg(seconds, 2, 10, QChar('0'))
-                                        .arg(milli_2, 2, 10, QChar('0'));
-
-            QString endTimeStringSRT = QString("%1:%2:%3,%4")
-                                           .arg(hours, 2, 10, QChar('0'))
-                                           .arg(minutes, 2, 10, QChar('0'))
-                                           .arg(seconds, 2, 10, QChar('0'))
-                                           .arg(millisec, 3, 10, QChar('0'));
+        for (const auto &subtitle : subtitles) {
+            const QString startTimeString = subtitleTime(subtitle.first, assFormat);
+            const QString endTimeString = subtitleTime(subtitle.second.second, assFormat);
+            const QString &dialogue = subtitle.second.first;
             line++;
             if (assFormat) {
                 // Format: Layer, Start, End, Style, Actor, MarginL, MarginR, MarginV, Effect, Text
                 out << "Dialogue: 0," << startTimeString << "," << endTimeString << "," << styleName << ",,0000,0000,0000,," << dialogue << '\n';
             } else {
-                out << line << "\n" << startTimeStringSRT << " --> " << endTimeStringSRT << "\n" << dialogue << "\n" << '\n';
+                out << line << "\n" << startTimeString << " --> " << endTimeString << "\n" << dialogue << "\n" << '\n';
             }
-
-            // qDebug() << "ADDING SUBTITLE to FILE AT START POS: " << startPos <<" END POS: "<<endPos;//<< ", FPS: " << pCore->getCurrentFps();
         }
         outF.close();
     }
@@ -1797,6 +1797,8 @@ void SubtitleModel::activateSubtitle(int ix)
     if (currentIx == ix) {
         return;
     }
+    // Write pending changes to the file of the current subtitle
+    flushSubtitleFile();
     const QString workPath = pCore->currentDoc()->subTitlePath(m_timeline->uuid(), ix, false);
     const QString finalPath = pCore->currentDoc()->subTitlePath(m_timeline->uuid(), ix, true);
     if (!QFile::exists(workPath) && QFile::exists(finalPath)) {
@@ -1810,7 +1812,9 @@ void SubtitleModel::activateSubtitle(int ix)
     }
     beginRemoveRows(QModelIndex(), 0, m_allSubtitles.size());
     m_allSubtitles.clear();
+    m_startPosIds.clear();
     m_subtitleList.clear();
+    m_rangeIndexDirty = true;
     endRemoveRows();
     pCore->currentDoc()->setSequenceProperty(m_timeline->uuid(), QStringLiteral("kdenlive:activeSubtitleIndex"), ix);
     parseSubtitle(workPath);
@@ -1820,6 +1824,7 @@ void SubtitleModel::registerSubtitle(int id, GenTime startTime, bool temporary)
 {
     Q_ASSERT(m_allSubtitles.count(id) == 0);
     m_allSubtitles.emplace(id, startTime);
+    m_startPosIds[startTime] = id;
     if (!temporary) {
         m_timeline->m_groups->createGroupItem(id);
     }
@@ -1831,12 +1836,26 @@ void SubtitleModel::deregisterSubtitle(int id, bool temporary)
     if (!temporary && isSelected(id)) {
         m_timeline->requestClearSelection(true);
     }
+    auto startId = m_startPosIds.find(m_allSubtitles.at(id));
+    if (startId != m_startPosIds.end() && startId->second == id) {
+        m_startPosIds.erase(startId);
+    }
     m_allSubtitles.erase(id);
     if (!temporary) {
         m_timeline->m_groups->destructGroupItem(id);
     }
 }
 
+void SubtitleModel::setSubtitleStart(int id, GenTime startTime)
+{
+    auto startId = m_startPosIds.find(m_allSubtitles.at(id));
+    if (startId != m_startPosIds.end() && startId->second == id) {
+        m_startPosIds.erase(startId);
+    }
+    m_allSubtitles[id] = startTime;
+    m_startPosIds[startTime] = id;
+}
+
 int SubtitleModel::positionForIndex(int id) const
 {
     return int(std::distance(m_allSubtitles.begin(), m_allSubtitles.find(id)));
@@ -1878,13 +1897,7 @@ std::pair<int, GenTime> SubtitleModel::getSubtitleIdFromIndex(int index) const
 
 int SubtitleModel::getSubtitleIdByPosition(int pos)
 {
-    GenTime startTime(pos, pCore->getCurrentFps());
-    auto findResult =
-        std::find_if(std::begin(m_allSubtitles), std::end(m_allSubtitles), [&](const std::pair<int, GenTime> &pair) { return pair.second == startTime; });
-    if (findResult != std::end(m_allSubtitles)) {
-        return findResult->first;
-    }
-    return -1;
+    return getIdForStartPos(GenTime(pos, pCore->getCurrentFps()));
 }
 
 int SubtitleModel::getSubtitleIdAtPosition(int pos)
@@ -12,6 +12,7 @@
 
 #include <QAbstractListModel>
 #include <QReadWriteLock>
+#include <QTimer>
 
 #include <array>
 #include <map>
@@ -19,6 +20,7 @@
 #include <mlt++/Mlt.h>
 #include <mlt++/MltProperties.h>
 #include <unordered_set>
+#include <vector>
 
 class DocUndoStack;
 class SnapInterface;
@@ -208,8 +210,10 @@ public Q_SLOTS:
     /** @brief Function that parses through a subtitle file */
     void parseSubtitle(const QString &workPath);
 
-    /** @brief Import model to a temporary subtitle file to which the Subtitle effect is applied*/
-    void jsontoSubtitle(const QString &data);
+    /** @brief Write the subtitles to the temporary subtitle file to which the Subtitle effect is applied*/
+    void updateSubtitleFile();
+    /** @brief Write the subtitle file now if a change is pending */
+    void flushSubtitleFile();
     /** @brief Update a subtitle text*/
     bool setText(int id, const QString &text);
 
@@ -224,6 +228,20 @@ private:
     QMap<std::pair<int, QString>, QString> m_subtitlesList;
     /** @brief A list of subtitles as: item id, start time */
     std::map<int, GenTime> m_allSubtitles;
+    /** @brief The reverse of m_allSubtitles: start time, item id */
+    std::map<GenTime, int> m_startPosIds;
+    /** @brief The subtitles sorted by start time with the highest end time up to each of them,
+     *  so that the subtitles in a range are found with a binary search even if they overlap. Rebuilt on the first query after a change */
+    struct SubtitleSpan
+    {
+        GenTime start;
+        GenTime end;
+        GenTime maxEnd;
+    };
+    mutable std::vector<SubtitleSpan> m_rangeIndex;
+    mutable bool m_rangeIndexDirty{true};
+    /** @brief Delays the rewrite of the subtitle file, so that it is written once after consecutive edits */
+    QTimer m_fileUpdateTimer;
     /** @brief A list of subtitles as: item index, fake start time */
     std::map<int, int> m_subtitlesFakePos;
     QString scriptInfoSection, styleSection, eventSection;
@@ -238,7 +256,10 @@ private:
     std::unique_ptr<Mlt::Filter> m_subtitleFilter;
     QVector<int> m_selected;
     QVector<int> m_grabbedIds;
-    int saveSubtitleData(const QString &data, const QString &outFile);
+    /** @brief Writes @param subtitles to @param outFile in the format matching its extension, returns the number of written subtitles */
+    int saveSubtitleData(const std::map<GenTime, std::pair<QString, GenTime>> &subtitles, const QString &outFile);
+    /** @brief Returns the up to date range index */
+    const std::vector<SubtitleSpan> &rangeIndex() const;
 
 Q_SIGNALS:
     void modelChanged();
@@ -253,6 +274,8 @@ protected:
     void setup();
     void registerSubtitle(int id, GenTime startTime, bool temporary = false);
     void deregisterSubtitle(int id, bool temporary = false);
+    /** @brief Updates the start time of a registered subtitle */
+    void setSubtitleStart(int id, GenTime startTime);
     /** @brief Returns the index for a subtitle's id (it's position in the list
      */
     int positionForIndex(int id) const;
@@ -20,6 +20,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "jobs/cliploadtask.h"
 #include "jobs/proxytask.h"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioPeaks.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
 #include "mltcontroller/clippropertiescontroller.h"
@@ -31,6 +32,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "projectitemmodel.h"
 #include "projectsubclip.h"
 #include "timeline2/model/snapmodel.hpp"
+#include "utils/mediahashindex.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "utils/timecode.h"
 #include "xml/xml.hpp"
@@ -443,7 +445,7 @@ void ProjectClip::resetSequenceThumbnails()
 {
     QMutexLocker lk(&m_thumbMutex);
     pCore->taskManager.discardJobs(ObjectId(KdenliveObjectType::BinClip, m_binId.toInt(), QUuid()), AbstractTask::LOADJOB, true);
-    m_thumbXml.clear();
+    clearThumbProducer();
     ThumbnailCache::get()->invalidateThumbsForClip(m_binId);
     // Force refeshing thumbs producer
     lk.unlock();
@@ -464,7 +466,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
         ThumbnailCache::get()->invalidateThumbsForClip(m_binId);
         pCore->taskManager.discardJobs(oid, AbstractTask::LOADJOB, true);
         pCore->taskManager.discardJobs(oid, AbstractTask::CACHEJOB);
-        m_thumbXml.clear();
+        clearThumbProducer();
         // Reset uuid to enforce reloading thumbnails from qml cache
         m_uuid = QUuid::createUuid();
         updateTimelineClips({TimelineModel::ClipThumbRole, TimelineModel::ResourceRole});
@@ -489,7 +491,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
         }
         if (!xml.isNull()) {
             bool hashChanged = false;
-            m_thumbXml.clear();
+            clearThumbProducer();
             ClipType::ProducerType type = clipType();
             if (type != ClipType::Color && type != ClipType::Image && type != ClipType::SlideShow) {
                 xml.removeAttribute("out");
@@ -514,7 +516,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
             if (m_clipStatus != FileStatus::StatusMissing) {
                 m_clipStatus = FileStatus::StatusWaiting;
             }
-            m_thumbXml.clear();
+            clearThumbProducer();
             ClipLoadTask::start(oid, xml, false, -1, -1, this);
         }
     }
@@ -623,7 +625,7 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool gene
     pCore->taskManager.discardJobs(ObjectId(KdenliveObjectType::BinClip, m_binId.toInt(), QUuid()), AbstractTask::LOADJOB);
     // Abort thumbnail tasks if any
     m_thumbMutex.lock();
-    m_thumbXml.clear();
+    clearThumbProducer();
     m_thumbMutex.unlock();
 
     isReloading = false;
@@ -879,6 +881,23 @@ std::unique_ptr<Mlt::Producer> ProjectClip::getThumbProducer()
     return thumbProd;
 }
 
+void ProjectClip::clearThumbProducer()
+{
+    m_thumbXml.clear();
+    m_thumbGeneration = nextThumbGeneration();
+}
+
+int ProjectClip::thumbProducerGeneration() const
+{
+    return m_thumbGeneration;
+}
+
+int ProjectClip::nextThumbGeneration()
+{
+    static std::atomic<int> lastGeneration{0};
+    return ++lastGeneration;
+}
+
 void ProjectClip::createDisabledMasterProducer()
 {
     if (!m_disabledProducer) {
@@ -1704,28 +1723,7 @@ const QString ProjectClip::getFileHash()
 
 const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString &path)
 {
-    QFile file(path);
-    QByteArray fileHash;
-    qint64 fSize = 0;
-    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-        /*
-         * 1 MB = 1 second per 450 files (or faster)
-         * 10 MB = 9 seconds per 450 files (or faster)
-         */
-        QByteArray fileData;
-        fSize = file.size();
-        if (fSize > 2000000) {
-            fileData = file.read(1000000);
-            if (file.seek(file.size() - 1000000)) {
-                fileData.append(file.readAll());
-            }
-        } else {
-            fileData = file.readAll();
-        }
-        file.close();
-        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-    }
-    return {fileHash, fSize};
+    return MediaHashIndex::get()->hash(path);
 }
 
 double ProjectClip::getOriginalFps() const
@@ -2130,6 +2128,9 @@ void ProjectClip::discardAudioThumb()
     pCore->taskManager.discardJobs(ObjectId(KdenliveObjectType::BinClip, m_binId.toInt(), QUuid()), AbstractTask::AUDIOTHUMBJOB);
     QString audioThumbPath;
     QList<int> streams = m_audioInfo->streams().keys();
+    m_audioPeaksMutex.lock();
+    m_audioPeaks.clear();
+    m_audioPeaksMutex.unlock();
     // Delete audio thumbnail data
     for (int &st : streams) {
         audioThumbPath = getAudioThumbPath(st);
@@ -2183,10 +2184,26 @@ const QString ProjectClip::getAudioThumbPath(int stream)
     QString audioPath = thumbFolder.absoluteFilePath(clipHash);
     audioPath.append(QLatin1Char('_') + QString::number(stream));
     int roundedFps = int(pCore->getCurrentFps());
-    audioPath.append(QStringLiteral("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QStringLiteral("_%1_audio.peaks").arg(roundedFps));
     return audioPath;
 }
 
+std::shared_ptr<AudioPeaks> ProjectClip::audioPeaks(int stream)
+{
+    QMutexLocker lk(&m_audioPeaksMutex);
+    auto search = m_audioPeaks.find(stream);
+    if (search != m_audioPeaks.end()) {
+        return search->second;
+    }
+    return nullptr;
+}
+
+void ProjectClip::setAudioPeaks(int stream, std::shared_ptr<AudioPeaks> peaks)
+{
+    QMutexLocker lk(&m_audioPeaksMutex);
+    m_audioPeaks[stream] = std::move(peaks);
+}
+
 QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString &data, int offset)
 {
     if (data.isEmpty()) {
@@ -2460,6 +2477,9 @@ bool ProjectClip::selfSoftDelete(Fun &undo, Fun &redo)
         // Free audio thumb data and timeline producers
         pCore->taskManager.discardJobs(ObjectId(KdenliveObjectType::BinClip, m_binId.toInt(), QUuid()));
         m_audioLevels.clear();
+        m_audioPeaksMutex.lock();
+        m_audioPeaks.clear();
+        m_audioPeaksMutex.unlock();
         m_disabledProducer.reset();
         m_audioProducers.clear();
         m_videoProducers.clear();
@@ -2737,7 +2757,7 @@ void ProjectClip::getThumbFromPercent(int percent, bool storeFrame)
         return;
     }
     int duration = getFramePlaytime();
-    int steps = qCeil(qMax(pCore->getCurrentFps(), double(duration) / 30));
+    int steps = CacheTask::thumbsStep(duration);
     int framePos = duration * percent / 100;
     framePos -= framePos % steps;
     QImage thumb = ThumbnailCache::get()->getThumbnail(hashForThumbs(), m_binId, framePos);
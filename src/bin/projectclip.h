@@ -18,8 +18,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QTemporaryFile>
 #include <QTimer>
 #include <QUuid>
+#include <atomic>
 #include <memory>
 
+class AudioPeaks;
 class ClipPropertiesController;
 class ProjectFolder;
 class ProjectSubClip;
@@ -160,6 +162,9 @@ public:
 
     /** @brief Returns this clip's producer. */
     std::unique_ptr<Mlt::Producer> getThumbProducer() override;
+    /** @brief Changes each time the thumbnail producer is reset, pooled thumbnail producers with another value are outdated.
+        The value is unique in the application, it also tells apart the clips of different projects */
+    int thumbProducerGeneration() const;
 
     /** @brief Recursively disable/enable bin effects. */
     void setBinEffectsEnabled(bool enabled) override;
@@ -198,6 +203,10 @@ public:
     void discardAudioThumb();
     /** @brief Get path for this clip's audio thumbnail */
     const QString getAudioThumbPath(int stream);
+    /** @brief Returns the multi-resolution peak data for a stream, or nullptr if not available yet */
+    std::shared_ptr<AudioPeaks> audioPeaks(int stream);
+    /** @brief Set the multi-resolution peak data for a stream, called once the audio thumbnail task is done */
+    void setAudioPeaks(int stream, std::shared_ptr<AudioPeaks> peaks);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
 
@@ -365,8 +374,15 @@ private:
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
     QByteArray m_thumbXml;
+    std::atomic<int> m_thumbGeneration{nextThumbGeneration()};
+    /** @brief Returns a new value for m_thumbGeneration */
+    static int nextThumbGeneration();
+    /** @brief Forget the thumbnail producer, m_thumbMutex must be locked */
+    void clearThumbProducer();
     const QString geometryWithOffset(const QString &data, int offset);
     QMap <QString, QByteArray> m_audioLevels;
+    QMutex m_audioPeaksMutex;
+    std::unordered_map<int, std::shared_ptr<AudioPeaks>> m_audioPeaks;
     /** @brief If true, all timeline occurrences of this clip will be replaced from a fresh producer on reload. */
     bool m_resetTimelineOccurences;
 
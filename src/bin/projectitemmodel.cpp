@@ -501,6 +501,16 @@ const QVector<uint8_t> ProjectItemModel::getAudioLevelsByBinID(const QString &bi
     return QVector<uint8_t>();
 }
 
+std::shared_ptr<AudioPeaks> ProjectItemModel::getAudioPeaksByBinID(const QString &binId, int stream)
+{
+    READ_LOCK();
+    auto search = m_allClipItems.find(binId.toInt());
+    if (search != m_allClipItems.end()) {
+        return search->second->audioPeaks(stream);
+    }
+    return nullptr;
+}
+
 double ProjectItemModel::getAudioMaxLevel(const QString &binId, int stream)
 {
     READ_LOCK();
@@ -1114,6 +1124,28 @@ QStringList ProjectItemModel::getClipByUrl(const QFileInfo &url) const
     return result;
 }
 
+std::unordered_map<QString, QStringList> ProjectItemModel::getClipsByUrl() const
+{
+    READ_LOCK();
+    std::unordered_map<QString, QStringList> result;
+    for (const auto &clip : m_allItems) {
+        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
+        if (c->itemType() == AbstractProjectItem::ClipItem) {
+            const QString url = std::static_pointer_cast<ProjectClip>(c)->clipUrl();
+            if (!url.isEmpty()) {
+                result[urlKey(QFileInfo(url))] << c->clipId();
+            }
+        }
+    }
+    return result;
+}
+
+QString ProjectItemModel::urlKey(const QFileInfo &url)
+{
+    const QString canonical = url.canonicalFilePath();
+    return canonical.isEmpty() ? url.absoluteFilePath() : canonical;
+}
+
 bool ProjectItemModel::loadFolders(Mlt::Properties &folders, std::unordered_map<QString, QString> &binIdCorresp)
 {
     QWriteLocker locker(&m_lock);
@@ -21,6 +21,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QTimer>
 #include <QUuid>
 
+class AudioPeaks;
 class BinPlaylist;
 class FileWatcher;
 class MarkerListModel;
@@ -64,9 +65,15 @@ public:
     /** @brief Returns audio levels for a clip from its id */
     const QVector <uint8_t>getAudioLevelsByBinID(const QString &binId, int stream);
     double getAudioMaxLevel(const QString &binId, int stream);
+    /** @brief Returns the multi-resolution audio peaks for a clip from its id */
+    std::shared_ptr<AudioPeaks> getAudioPeaksByBinID(const QString &binId, int stream);
 
     /** @brief Returns a list of clips using the given url */
     QStringList getClipByUrl(const QFileInfo &url) const;
+    /** @brief Returns the clips of each url, keyed by urlKey. Use it instead of getClipByUrl to look up many urls */
+    std::unordered_map<QString, QStringList> getClipsByUrl() const;
+    /** @brief Returns the key of @param url in getClipsByUrl: the canonical path of existing files, the absolute path otherwise */
+    static QString urlKey(const QFileInfo &url);
 
     /** @brief Helper to check whether a clip with a given id exists */
     bool hasClip(const QString &binId);
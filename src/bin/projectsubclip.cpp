@@ -192,7 +192,7 @@ void ProjectSubClip::getThumbFromPercent(int percent)
         return;
     }
     int duration = m_outPoint - m_inPoint;
-    int steps = qCeil(qMax(pCore->getCurrentFps(), double(duration) / 30));
+    int steps = CacheTask::thumbsStep(duration);
     int framePos = duration * percent / 100;
     framePos -= framePos % steps;
     if (ThumbnailCache::get()->hasThumbnail(m_parentClipId, m_inPoint + framePos)) {
@@ -19,6 +19,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "profilesdialog.h"
 #include "project/dialogs/guidecategories.h"
 #include "project/dialogs/profilewidget.h"
+#include "scopes/colorscopes/scopekernels.h"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
 #include "wizard.h"
@@ -367,6 +368,8 @@ void KdenliveSettingsDialog::initEnviromentPage()
     connect(m_configEnv.kcfg_librarytodefaultfolder, &QAbstractButton::clicked, this, &KdenliveSettingsDialog::slotEnableLibraryFolder);
 
     m_configEnv.kcfg_proxythreads->setMaximum(qMax(1, QThread::idealThreadCount() - 1));
+    m_configEnv.kcfg_previewworkers->setMaximum(qMax(1, QThread::idealThreadCount()));
+    m_configEnv.kcfg_scopesthreads->setMaximum(qMax(1, QThread::idealThreadCount()));
 
     // Script rendering files folder
     m_configEnv.videofolderurl->setMode(KFile::Directory);
@@ -1345,6 +1348,12 @@ void KdenliveSettingsDialog::updateSettings()
         pCore->taskManager.updateConcurrency();
     }
 
+    // color scopes threads, the preview workers are read when the preview starts
+    if (m_configEnv.kcfg_scopesthreads->value() != KdenliveSettings::scopesthreads()) {
+        KdenliveSettings::setScopesthreads(m_configEnv.kcfg_scopesthreads->value());
+        ScopeKernels::setMaxThreads(KdenliveSettings::scopesthreads());
+    }
+
     KConfigDialog::settingsChangedSlot();
     // KConfigDialog::updateSettings();
     if (resetConsumer) {
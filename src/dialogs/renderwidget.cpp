@@ -18,6 +18,7 @@
 #include "profiles/profilemodel.hpp"
 #include "profiles/profilerepository.hpp"
 #include "project/projectmanager.h"
+#include "render/renderqueue.h"
 #include "render/renderrequest.h"
 #include "utils/qstringutils.h"
 #include "utils/sysinfo.hpp"
@@ -153,6 +154,7 @@ const QString RenderJobItem::metadata() const
 RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     : QDialog(parent)
     , m_blockProcessing(false)
+    , m_queue(RenderQueue::defaultFileName())
 {
     m_view.setupUi(this);
     int size = style()->pixelMetric(QStyle::PM_SmallIconSize);
@@ -253,6 +255,9 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     m_view.encoder_threads->setValue(KdenliveSettings::encodethreads());
     connect(m_view.encoder_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setEncodethreads);
     connect(m_view.encoder_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RenderWidget::refreshParams);
+    m_view.render_segments->setMaximum(qMax(1, QThread::idealThreadCount()));
+    m_view.render_segments->setValue(KdenliveSettings::rendersegments());
+    connect(m_view.render_segments, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setRendersegments);
 
     connect(m_view.video_box, &QGroupBox::toggled, this, &RenderWidget::refreshParams);
     connect(m_view.audio_box, &QGroupBox::toggled, this, &RenderWidget::refreshParams);
@@ -332,6 +337,7 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     header->setSectionResizeMode(0, QHeaderView::Fixed);
     header->resizeSection(0, size + 4);
     header->setSectionResizeMode(1, QHeaderView::Interactive);
+    restoreQueue();
 
     // ===== "Scripts" tab =====
     m_view.scripts_list->setHeaderLabels(QStringList() << QString() << i18n("Stored Playlists"));
@@ -769,10 +775,12 @@ RenderJobItem *RenderWidget::createRenderJob(const RenderRequest::RenderJob &job
     renderItem->setData(1, StartTimeRole, t);
     renderItem->setData(1, LastTimeRole, t);
     renderItem->setData(1, LastFrameRole, 0);
-    QStringList argsJob = RenderRequest::argsByJob(job);
+    const RenderQueue::Job queueJob = RenderQueue::createJob(job.outputPath, RenderRequest::argsByJob(job));
 
-    renderItem->setData(1, ParametersRole, argsJob);
-    qDebug() << "* CREATED JOB WITH ARGS: " << argsJob;
+    renderItem->setData(1, ParametersRole, queueJob.args);
+    m_queue.append(queueJob);
+    m_queue.save();
+    qDebug() << "* CREATED JOB WITH ARGS: " << queueJob.args;
     renderItem->setData(1, OpenBrowserRole, m_view.open_browser->isChecked());
     renderItem->setData(1, PlayAfterRole, m_view.play_after->isChecked());
     if (!m_view.audio_box->isChecked()) {
@@ -792,49 +800,101 @@ void RenderWidget::checkRenderStatus()
         return;
     }
 
-    // Make sure no other rendering is running
-    if (runningJobsCount() > 0) {
-        return;
-    }
-
-    auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
-
-    bool waitingJob = false;
-
-    // Find first waiting job
-    while (item != nullptr) {
-        if (item->status() == WAITINGJOB) {
-            QDateTime t = QDateTime::currentDateTime();
-            item->setData(1, StartTimeRole, t);
-            item->setData(1, LastTimeRole, t);
-            waitingJob = true;
-            startRendering(item);
-            // Check for 2 pass encoding
-            QStringList jobData = item->data(1, ParametersRole).toStringList();
-            if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
-                // Find and remove 1st pass job
-                QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
-                QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
-                while (above) {
-                    QStringList aboveData = above->data(1, ParametersRole).toStringList();
-                    qDebug() << "// GOT  JOB: " << aboveData.at(1);
-                    if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
-                        delete above;
-                        break;
-                    }
-                    above = m_view.running_jobs->itemAbove(above);
+    // Start the waiting jobs in queue order, as long as the running jobs leave enough threads and memory
+    const QStringList admitted = m_queue.admissible(queueLimits());
+    for (const QString &output : admitted) {
+        QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(output, Qt::MatchExactly, 1);
+        if (existing.isEmpty()) {
+            m_queue.remove(output);
+            continue;
+        }
+        auto *item = static_cast<RenderJobItem *>(existing.at(0));
+        QDateTime t = QDateTime::currentDateTime();
+        item->setData(1, StartTimeRole, t);
+        item->setData(1, LastTimeRole, t);
+        startRendering(item);
+        // Check for 2 pass encoding
+        QStringList jobData = item->data(1, ParametersRole).toStringList();
+        if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
+            // Find and remove 1st pass job
+            QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
+            QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
+            while (above) {
+                QStringList aboveData = above->data(1, ParametersRole).toStringList();
+                qDebug() << "// GOT  JOB: " << aboveData.at(1);
+                if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
+                    delete above;
+                    break;
                 }
+                above = m_view.running_jobs->itemAbove(above);
             }
+        }
+        if (item->status() == FAILEDJOB) {
+            m_queue.setStatus(output, RenderQueue::Failed);
+        } else {
             item->setStatus(STARTINGJOB);
-            break;
+            m_queue.setStatus(output, RenderQueue::Running);
         }
-        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
     }
-    if (!waitingJob && m_view.shutdown->isChecked()) {
+    if (!admitted.isEmpty()) {
+        m_queue.save();
+    }
+    if (runningJobsCount() == 0 && waitingJobsCount() == 0 && m_view.shutdown->isChecked()) {
         Q_EMIT shutdown();
     }
 }
 
+RenderQueue::Limits RenderWidget::queueLimits() const
+{
+    RenderQueue::Limits limits;
+    limits.jobs = KdenliveSettings::renderjobs();
+    limits.threads = QThread::idealThreadCount();
+    SysMemInfo meminfo = SysMemInfo::getMemoryInfo();
+    if (meminfo.isSuccessful()) {
+        // The memory of the running jobs is already taken from the available memory, while the queue counts their estimate
+        int runningMemory = 0;
+        for (const RenderQueue::Job &job : m_queue.jobs()) {
+            if (job.status == RenderQueue::Running) {
+                runningMemory += job.memory;
+            }
+        }
+        limits.memory = qMax(0, meminfo.availableMemory() - LOW_MEMORY_THRESHOLD) + runningMemory;
+    }
+    return limits;
+}
+
+void RenderWidget::restoreQueue()
+{
+    if (!m_queue.load()) {
+        return;
+    }
+    // Only the waiting jobs are restored, the jobs started by a previous session do not report to this one
+    const std::vector<RenderQueue::Job> jobs = m_queue.jobs();
+    for (const RenderQueue::Job &job : jobs) {
+        if (job.status != RenderQueue::Waiting || job.args.size() < 3 || !QFile::exists(job.args.at(2))) {
+            m_queue.remove(job.output);
+            continue;
+        }
+        auto *renderItem = new RenderJobItem(m_view.running_jobs, QStringList() << QString() << job.output);
+        QDateTime t = QDateTime::currentDateTime();
+        renderItem->setData(1, StartTimeRole, t);
+        renderItem->setData(1, LastTimeRole, t);
+        renderItem->setData(1, LastFrameRole, 0);
+        // Progress is reported to the current instance
+        QStringList argsJob = job.args;
+        int pidIndex = argsJob.indexOf(QStringLiteral("--pid"));
+        if (pidIndex >= 0 && pidIndex + 1 < argsJob.count()) {
+            argsJob[pidIndex + 1] = QString::number(QCoreApplication::applicationPid());
+        }
+        renderItem->setData(1, ParametersRole, argsJob);
+        m_queue.remove(job.output);
+        RenderQueue::Job restored = job;
+        restored.args = argsJob;
+        m_queue.append(restored);
+    }
+    m_queue.save();
+}
+
 void RenderWidget::startRendering(RenderJobItem *item)
 {
     auto rendererArgs = item->data(1, ParametersRole).toStringList();
@@ -1216,6 +1276,7 @@ void RenderWidget::setRenderProgress(const QString &dest, int progress, int fram
     }
     item->setData(1, ProgressRole, progress);
     item->setStatus(RUNNINGJOB);
+    m_queue.setStatus(dest, RenderQueue::Running);
     if (progress == 0) {
         item->setIcon(0, QIcon::fromTheme(QStringLiteral("media-record")));
         slotCheckJob();
@@ -1270,6 +1331,7 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
     if (status == -1) {
         // Job finished successfully
         item->setStatus(FINISHEDJOB);
+        m_queue.setStatus(dest, RenderQueue::Finished);
         QDateTime startTime = item->data(1, StartTimeRole).toDateTime();
         qint64 elapsedTime = startTime.secsTo(QDateTime::currentDateTime());
         int days = static_cast<int>(elapsedTime / 86400);
@@ -1310,6 +1372,7 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
     } else if (status == -2) {
         // Rendering crashed
         item->setStatus(FAILEDJOB);
+        m_queue.setStatus(dest, RenderQueue::Failed);
         m_view.error_log->append(i18n("<strong>Rendering of %1 crashed</strong><br />", dest));
         m_view.error_log->append(error);
         m_view.error_log->append(QStringLiteral("<hr />"));
@@ -1317,9 +1380,12 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
     } else if (status == -3) {
         // User aborted job
         item->setStatus(ABORTEDJOB);
+        m_queue.setStatus(dest, RenderQueue::Aborted);
     } else {
         delete item;
+        m_queue.remove(dest);
     }
+    m_queue.save();
     slotCheckJob();
     checkRenderStatus();
 }
@@ -1331,6 +1397,8 @@ void RenderWidget::slotAbortCurrentJob()
         if (current->status() == RUNNINGJOB) {
             Q_EMIT abortProcess(current->text(1));
         } else {
+            m_queue.remove(current->text(1));
+            m_queue.save();
             delete current;
             slotCheckJob();
             checkRenderStatus();
@@ -1343,6 +1411,8 @@ void RenderWidget::slotStartCurrentJob()
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
     if ((current != nullptr) && current->status() == WAITINGJOB) {
         startRendering(current);
+        m_queue.setStatus(current->text(1), current->status() == FAILEDJOB ? RenderQueue::Failed : RenderQueue::Running);
+        m_queue.save();
     }
     m_view.start_job->setEnabled(false);
 }
@@ -1379,12 +1449,14 @@ void RenderWidget::slotCleanUpJobs()
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(ix));
     while (current != nullptr) {
         if (current->status() == FINISHEDJOB || current->status() == ABORTEDJOB) {
+            m_queue.remove(current->text(1));
             delete current;
         } else {
             ix++;
         }
         current = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(ix));
     }
+    m_queue.save();
     slotCheckJob();
 }
 
@@ -1494,7 +1566,10 @@ void RenderWidget::slotStartScript()
         renderItem->setData(1, LastTimeRole, t);
         QStringList argsJob = {QStringLiteral("delivery"), KdenliveSettings::meltpath(), path, QStringLiteral("--pid"),
                                QString::number(QCoreApplication::applicationPid())};
-        renderItem->setData(1, ParametersRole, argsJob);
+        const RenderQueue::Job queueJob = RenderQueue::createJob(destination, argsJob);
+        renderItem->setData(1, ParametersRole, queueJob.args);
+        m_queue.append(queueJob);
+        m_queue.save();
         checkRenderStatus();
         m_view.tabWidget->setCurrentIndex(Tabs::JobsTab);
     }
@@ -1669,19 +1744,30 @@ bool RenderWidget::startWaitingRenderJobs()
 #ifndef Q_OS_WIN
     outStream << "#!/bin/sh\n\n";
 #endif
-    auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
-    while (item != nullptr) {
-        if (item->status() == WAITINGJOB) {
-            // Add render process for item
-            const QString params = item->data(1, ParametersRole).toStringList().join(QLatin1Char(' '));
-            outStream << '\"' << KdenliveSettings::kdenliverendererpath() << "\" " << params << '\n';
+    // Hand the waiting jobs over to kdenlive_render, which renders them concurrently once Kdenlive is closed
+    const QString queueFile = autoscriptFile.left(autoscriptFile.length() - ScriptFormat.size()) + QStringLiteral(".json");
+    RenderQueue waitingQueue(queueFile);
+    const std::vector<RenderQueue::Job> jobs = m_queue.jobs();
+    for (const RenderQueue::Job &job : jobs) {
+        if (job.status == RenderQueue::Waiting) {
+            waitingQueue.append(job);
+            m_queue.remove(job.output);
         }
-        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
     }
+    if (!waitingQueue.save()) {
+        KMessageBox::error(nullptr, i18n("Cannot write to file %1", queueFile));
+        file.close();
+        m_blockProcessing = false;
+        return false;
+    }
+    m_queue.save();
+    outStream << '\"' << KdenliveSettings::kdenliverendererpath() << "\" queue \"" << queueFile << "\"\n";
 // erase itself when rendering is finished
 #ifndef Q_OS_WIN
+    outStream << "rm \"" << queueFile << "\"\n";
     outStream << "rm \"" << autoscriptFile << "\"\n";
 #else
+    outStream << "del \"" << queueFile << "\"\n";
     outStream << "del \"" << autoscriptFile << "\"\n";
 #endif
     if (file.error() != QFile::NoError) {
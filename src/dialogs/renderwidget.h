@@ -15,6 +15,7 @@ class Menu;
 
 #include "bin/model/markerlistmodel.hpp"
 #include "definitions.h"
+#include "render/renderqueue.h"
 #include "render/renderrequest.h"
 #include "renderpresets/renderpresetmodel.hpp"
 #include "renderpresets/tree/renderpresettreemodel.hpp"
@@ -226,12 +227,18 @@ private:
     int m_renderDuration{0};
     int m_missingClips{0};
     int m_missingUsedClips{0};
+    /** @brief The jobs of the "Job Queue" tab, saved so that waiting jobs survive a restart */
+    RenderQueue m_queue;
 
     Purpose::Menu *m_shareMenu;
     void parseProfiles(const QString &selectedProfile = QString());
     QUrl filenameWithExtension(QUrl url, const QString &extension);
-    /** @brief Check if a job needs to be started. */
+    /** @brief Start the waiting jobs that fit in the processor and memory limits. */
     void checkRenderStatus();
+    /** @brief The processor threads and memory that render jobs may use. */
+    RenderQueue::Limits queueLimits() const;
+    /** @brief Add the waiting jobs of the saved queue to the job list. */
+    void restoreQueue();
     void startRendering(RenderJobItem *item);
     /** @brief Create a rendering profile from MLT preset. */
     QTreeWidgetItem *loadFromMltPreset(const QString &groupName, const QString &path, QString profileName, bool codecInName = false);
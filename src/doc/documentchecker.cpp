@@ -11,11 +11,11 @@
 #include "kdenlivesettings.h"
 #include "titler/titlewidget.h"
 #include "transitions/transitionsrepository.hpp"
+#include "utils/mediahashindex.hpp"
 #include "xml/xml.hpp"
 
 #include <KLocalizedString>
 
-#include <QCryptographicHash>
 #include <QStandardPaths>
 
 QDebug operator<<(QDebug qd, const DocumentChecker::DocumentResource &item)
@@ -198,6 +198,24 @@ bool DocumentChecker::hasErrorInProject()
     const int taskCount = documentProducers.count() + documentChains.count() + documentTractors.count();
     Q_EMIT pCore->loadingMessageNewStage(i18n("Checking for missing items…"), taskCount);
 
+    // Hash the bin clips that need a change check in parallel, getMissingProducers then reads them from the index
+    QStringList hashedResources;
+    for (const QDomNodeList &list : {documentProducers, documentChains}) {
+        for (int i = 0; i < list.count(); ++i) {
+            QDomElement e = list.item(i).toElement();
+            if (Xml::hasXmlProperty(e, QStringLiteral("kdenlive:file_hash"))) {
+                const QString resource = getProducerResource(e);
+                if (!resource.isEmpty()) {
+                    hashedResources << resource;
+                }
+            }
+        }
+    }
+    hashedResources.removeDuplicates();
+    if (hashedResources.count() > 1) {
+        MediaHashIndex::get()->hashFiles(hashedResources);
+    }
+
     QStringList verifiedPaths;
     int max = documentProducers.count();
     for (int i = 0; i < max; ++i) {
@@ -1005,37 +1023,19 @@ QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &m
         return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
     }
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
         qApp->processEvents();
         /*if (m_abortSearch) {
             return QString();
         }*/
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
+        const QString filePath = dir.absoluteFilePath(filesAndDirs.at(i));
+        if (QString::number(QFileInfo(filePath).size()) == matchSize) {
+            const QByteArray fileHash = MediaHashIndex::get()->hash(filePath).first;
+            if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
+                return filePath;
             }
         }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
     }
     filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
@@ -51,16 +51,26 @@ AbstractTask::AbstractTask(const ObjectId &owner, JOBTYPE type, QObject *object)
     case AbstractTask::LOADJOB:
         m_priority = 10;
         break;
+    case AbstractTask::THUMBJOB:
+        m_priority = 9;
+        break;
     case AbstractTask::TRANSCODEJOB:
     case AbstractTask::PROXYJOB:
         m_priority = 8;
         break;
+    case AbstractTask::AUDIOTHUMBJOB:
+        m_priority = 7;
+        break;
     case AbstractTask::FILTERCLIPJOB:
     case AbstractTask::STABILIZEJOB:
     case AbstractTask::ANALYSECLIPJOB:
     case AbstractTask::SPEEDJOB:
         m_priority = 5;
         break;
+    case AbstractTask::CACHEJOB:
+        // Cache thumbnails are only needed when hovering the clip
+        m_priority = 2;
+        break;
     default:
         m_priority = 5;
         break;
@@ -13,6 +13,7 @@
 #include <QObject>
 #include <QRunnable>
 #include <QUuid>
+#include <atomic>
 
 class AbstractTask : public QObject, public QRunnable
 {
@@ -44,7 +45,8 @@ public:
 protected:
     ObjectId m_owner;
     QObject* m_object;
-    int m_progress;
+    // Written by the task threads and read by the task manager
+    std::atomic<int> m_progress;
     QString m_description;
     bool m_successful;
     QAtomicInt m_isCanceled;
@@ -6,6 +6,7 @@
 */
 
 #include "audiolevelstask.h"
+#include "audio/audioPeaks.h"
 #include "audio/audioStreamInfo.h"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -15,11 +16,10 @@
 #include <KMessageWidget>
 #include <QElapsedTimer>
 #include <QFile>
-#include <QImage>
 #include <QList>
 #include <QMutex>
-#include <QRgb>
 #include <QString>
+#include <QThread>
 #include <QThreadPool>
 #include <QTime>
 #include <QVariantList>
@@ -32,12 +32,67 @@ static void deleteQVariantList(QVector<uint8_t> *list)
     delete list;
 }
 
+/** @brief Data shared by all the tasks processing a segment of an audio stream. */
+struct AudioLevelsStream
+{
+    int stream;
+    int streamIndex;
+    int channels;
+    int frequency;
+    int lengthInFrames;
+    QString service;
+    QString resource;
+    QString cachePath;
+    // Frame boundaries of the segments, segment i covers [bounds[i], bounds[i + 1])
+    QVector<int> bounds;
+    QMutex mutex;
+    // Per frame levels of the whole stream, filled as segments are processed
+    QVector<uint8_t> levels;
+    std::vector<std::unique_ptr<AudioPeaksBuilder>> peaks;
+    uint maxLevel{1};
+    int remaining;
+    bool canceled{false};
+};
+
 AudioLevelsTask::AudioLevelsTask(const ObjectId &owner, QObject *object)
     : AbstractTask(owner, AbstractTask::AUDIOTHUMBJOB, object)
+    , m_segment(-1)
+    , m_released(false)
 {
     m_description = i18n("Audio thumbs");
 }
 
+AudioLevelsTask::AudioLevelsTask(const ObjectId &owner, QObject *object, std::shared_ptr<AudioLevelsStream> stream, int segment)
+    : AbstractTask(owner, AbstractTask::AUDIOTHUMBJOB, object)
+    , m_stream(std::move(stream))
+    , m_segment(segment)
+    , m_released(false)
+{
+    if (m_stream->bounds.size() > 2) {
+        m_description = i18n("Audio thumbs (part %1/%2)", m_segment + 1, m_stream->bounds.size() - 1);
+    } else {
+        m_description = i18n("Audio thumbs");
+    }
+}
+
+AudioLevelsTask::~AudioLevelsTask()
+{
+    if (m_stream && !m_released) {
+        // The task was deleted without running, the stream cannot be completed
+        QMutexLocker lk(&m_stream->mutex);
+        m_stream->canceled = true;
+        releaseSegment();
+    }
+}
+
+void AudioLevelsTask::releaseSegment()
+{
+    if (!m_released) {
+        m_released = true;
+        m_stream->remaining--;
+    }
+}
+
 void AudioLevelsTask::start(const ObjectId &owner, QObject *object, bool force)
 {
     // See if there is already a task for this MLT service and resource.
@@ -55,10 +110,19 @@ void AudioLevelsTask::run()
 {
     AbstractTaskDone whenFinished(m_owner.itemId, this);
     if (m_isCanceled || pCore->taskManager.isBlocked()) {
+        if (m_stream) {
+            QMutexLocker lk(&m_stream->mutex);
+            m_stream->canceled = true;
+            releaseSegment();
+        }
         return;
     }
     QMutexLocker lock(&m_runMutex);
     m_running = true;
+    if (m_segment >= 0) {
+        processSegment();
+        return;
+    }
     // 2 channels interleaved of uchar values
     auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.itemId));
     if (binClip == nullptr) {
@@ -98,10 +162,14 @@ void AudioLevelsTask::run()
     int channels = binClip->audioInfo()->channels();
     channels = channels <= 0 ? 2 : channels;
 
+    // Long clips are split in segments of at least segmentDuration seconds that are processed in parallel
+    const int segmentDuration = 120;
+    int segmentCount = qBound(1, int(lengthInFrames / (segmentDuration * pCore->getCurrentFps())), qMax(1, QThread::idealThreadCount()));
+
     QMap<int, QString> streams = binClip->audioInfo()->streams();
     QMap<int, int> audioChannels = binClip->audioInfo()->streamChannels();
     QMapIterator<int, QString> st(streams);
-    bool audioCreated = false;
+    QList<AudioLevelsTask *> segmentTasks;
     int streamIndex = -1;
     while (st.hasNext() && !m_isCanceled) {
         st.next();
@@ -112,147 +180,186 @@ void AudioLevelsTask::run()
         streamIndex++;
         // Generate one thumb per stream
         QString cachePath = binClip->getAudioThumbPath(stream);
-        QVector<uint8_t> mltLevels;
         if (!m_isForce && QFile::exists(cachePath)) {
             // Audio thumb already exists
-            QImage image(cachePath);
-            if (!m_isCanceled && !image.isNull()) {
-                // convert cached image
-                int n = image.width() * image.height();
-                for (int i = 0; n > 1 && i < n; i++) {
-                    QRgb p = image.pixel(i / channels, i % channels);
-                    mltLevels << qRed(p);
-                    mltLevels << qGreen(p);
-                    mltLevels << qBlue(p);
-                    mltLevels << qAlpha(p);
-                }
+            std::shared_ptr<AudioPeaks> peaks = AudioPeaks::open(cachePath);
+            if (!m_isCanceled && peaks) {
+                const QVector<uint8_t> mltLevels = peaks->frameLevels();
                 if (mltLevels.size() > 0) {
-                    QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                    producer = binClip->originalProducer();
-                    producer->lock();
-                    QString key = QString("_kdenlive:audio%1").arg(stream);
-                    producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                    producer->unlock();
-                    producer.reset();
+                    publishLevels(binClip, stream, mltLevels, peaks->maxFrameLevel());
+                    binClip->setAudioPeaks(stream, peaks);
                     continue;
                 }
             }
         }
-
-        Mlt::Producer *aProd = new Mlt::Producer(pCore->getProjectProfile(), service.toUtf8().constData(), res.toUtf8().constData());
-        if (!aProd->is_valid()) {
-            QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection, Q_ARG(QString, i18n("Audio thumbs: cannot open file %1", res)),
-                                      Q_ARG(int, int(KMessageWidget::Warning)));
-            delete aProd;
-            return;
+        auto streamData = std::make_shared<AudioLevelsStream>();
+        streamData->stream = stream;
+        streamData->streamIndex = streamIndex;
+        streamData->channels = channels;
+        streamData->frequency = frequency;
+        streamData->lengthInFrames = lengthInFrames;
+        streamData->service = service;
+        streamData->resource = res;
+        streamData->cachePath = cachePath;
+        for (int i = 0; i < segmentCount; i++) {
+            streamData->bounds << int(qint64(lengthInFrames) * i / segmentCount);
         }
-        aProd->set("video_index", -1);
-        aProd->set("audio_index", stream);
-        aProd->set("vstream", -1);
-        aProd->set("astream", streamIndex);
-        Mlt::Filter chans(pCore->getProjectProfile(), "audiochannels");
-        Mlt::Filter converter(pCore->getProjectProfile(), "audioconvert");
-        Mlt::Filter levels(pCore->getProjectProfile(), "audiolevel");
-        aProd->attach(chans);
-        aProd->attach(converter);
-        aProd->attach(levels);
-        std::unique_ptr<Mlt::Producer> audioProducer;
-        audioProducer.reset(aProd);
-
-        double framesPerSecond = audioProducer->get_fps();
-        mlt_audio_format audioFormat = mlt_audio_s16;
-        QStringList keys;
-        keys.reserve(channels);
-        for (int i = 0; i < channels; i++) {
-            keys << "meta.media.audio_level." + QString::number(i);
+        streamData->bounds << lengthInFrames;
+        streamData->levels.fill(0, lengthInFrames * channels);
+        streamData->peaks.resize(size_t(segmentCount));
+        streamData->remaining = segmentCount;
+        for (int i = 0; i < segmentCount; i++) {
+            auto *task = new AudioLevelsTask(m_owner, m_object, streamData, i);
+            task->m_isForce = m_isForce;
+            segmentTasks << task;
         }
-        uint maxLevel = 1;
-        QElapsedTimer updateTime;
-        updateTime.start();
-        for (int z = 0; z < lengthInFrames && !m_isCanceled; ++z) {
-            int val = int(100.0 * z / lengthInFrames);
-            if (m_progress != val) {
-                m_progress = val;
-                QMetaObject::invokeMethod(m_object, "updateJobProgress");
-            }
-            QScopedPointer<Mlt::Frame> mltFrame(audioProducer->get_frame());
-            if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
-                int samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
-                mltFrame->get_audio(audioFormat, frequency, channels, samples);
-                for (int channel = 0; channel < channels; ++channel) {
-                    uint lev = 256 * qMin(mltFrame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                    mltLevels << lev;
-                    // double lev = mltFrame->get_double(keys.at(channel).toUtf8().constData());
-                    // mltLevels << lev;
-                    maxLevel = qMax(lev, maxLevel);
-                }
-            } else if (!mltLevels.isEmpty()) {
-                for (int channel = 0; channel < channels; channel++) {
-                    mltLevels << mltLevels.last();
-                }
-            }
-            // Incrementally update the audio levels every 3 seconds.
-            if (updateTime.elapsed() > 3000 && !m_isCanceled) {
-                updateTime.restart();
-                QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                producer = binClip->originalProducer();
-                producer->lock();
-                QString key = QString("_kdenlive:audio%1").arg(stream);
-                producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                producer->unlock();
-                producer.reset();
-                QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
+    }
+    if (segmentTasks.isEmpty()) {
+        if (!m_isCanceled) {
+            // Audio was cached, ensure the bin thumbnail is loaded
+            QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, true));
+        }
+    } else {
+        // Each stream segment is an independent task, so that they can run concurrently
+        for (AudioLevelsTask *task : qAsConst(segmentTasks)) {
+            if (m_isCanceled) {
+                delete task;
+                continue;
             }
+            pCore->taskManager.startTask(m_owner.itemId, task);
         }
+    }
+    m_progress = 100;
+    QMetaObject::invokeMethod(m_object, "updateJobProgress");
+}
 
-        /*// Normalize
-        for (double &v : mltLevels) {
-            m_audioLevels << uchar(255 * v / maxLevel);
-        }*/
-        if (m_isCanceled) {
-            mltLevels.clear();
-            m_progress = 100;
-            QMetaObject::invokeMethod(m_object, "updateJobProgress");
+void AudioLevelsTask::publishLevels(const std::shared_ptr<ProjectClip> &binClip, int stream, const QVector<uint8_t> &levels, int maxLevel)
+{
+    QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(levels);
+    std::shared_ptr<Mlt::Producer> producer = binClip->originalProducer();
+    producer->lock();
+    QString key = QString("_kdenlive:audio%1").arg(stream);
+    if (maxLevel > 0) {
+        QString key2 = QString("kdenlive:audio_max%1").arg(stream);
+        producer->set(key2.toUtf8().constData(), maxLevel);
+    }
+    producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
+    producer->unlock();
+}
+
+void AudioLevelsTask::processSegment()
+{
+    AudioLevelsStream &data = *m_stream.get();
+    const int firstFrame = data.bounds.at(m_segment);
+    const int lastFrame = data.bounds.at(m_segment + 1);
+    const int channels = data.channels;
+    int frequency = data.frequency;
+    auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.itemId));
+    std::unique_ptr<Mlt::Producer> audioProducer;
+    if (binClip) {
+        audioProducer.reset(new Mlt::Producer(pCore->getProjectProfile(), data.service.toUtf8().constData(), data.resource.toUtf8().constData()));
+    }
+    if (!audioProducer || !audioProducer->is_valid()) {
+        if (binClip) {
+            QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection,
+                                      Q_ARG(QString, i18n("Audio thumbs: cannot open file %1", data.resource)), Q_ARG(int, int(KMessageWidget::Warning)));
         }
-        if (mltLevels.size() > 0) {
-            QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-            producer = binClip->originalProducer();
-            producer->lock();
-            QString key = QString("_kdenlive:audio%1").arg(stream);
-            QString key2 = QString("kdenlive:audio_max%1").arg(stream);
-            producer->set(key2.toUtf8().constData(), int(maxLevel));
-            producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-            producer->unlock();
-            producer.reset();
-            // qDebug()<<"=== FINISHED PRODUCING AUDIO FOR: "<<key<<", SIZE: "<<levelsCopy->size();
-            m_progress = 100;
+        QMutexLocker lk(&data.mutex);
+        data.canceled = true;
+        releaseSegment();
+        return;
+    }
+    audioProducer->set("video_index", -1);
+    audioProducer->set("audio_index", data.stream);
+    audioProducer->set("vstream", -1);
+    audioProducer->set("astream", data.streamIndex);
+    Mlt::Filter chans(pCore->getProjectProfile(), "audiochannels");
+    Mlt::Filter converter(pCore->getProjectProfile(), "audioconvert");
+    Mlt::Filter levels(pCore->getProjectProfile(), "audiolevel");
+    audioProducer->attach(chans);
+    audioProducer->attach(converter);
+    audioProducer->attach(levels);
+    if (firstFrame > 0) {
+        audioProducer->seek(firstFrame);
+    }
+
+    double framesPerSecond = audioProducer->get_fps();
+    mlt_audio_format audioFormat = mlt_audio_s16;
+    QStringList keys;
+    keys.reserve(channels);
+    for (int i = 0; i < channels; i++) {
+        keys << "meta.media.audio_level." + QString::number(i);
+    }
+    uint maxLevel = 1;
+    QVector<uint8_t> mltLevels;
+    mltLevels.reserve((lastFrame - firstFrame) * channels);
+    // Sub-frame peaks, used when zooming in the timeline
+    auto peaksBuilder = std::make_unique<AudioPeaksBuilder>(
+        channels, frequency, mlt_audio_calculate_samples_to_position(float(framesPerSecond), frequency, firstFrame));
+    QElapsedTimer updateTime;
+    updateTime.start();
+    for (int z = firstFrame; z < lastFrame && !m_isCanceled; ++z) {
+        int val = int(100.0 * (z - firstFrame) / (lastFrame - firstFrame));
+        if (m_progress != val) {
+            m_progress = val;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
-            // Put into an image for caching.
-            int count = mltLevels.size();
-            QImage image((count + 3) / 4 / channels, channels, QImage::Format_ARGB32);
-            int n = image.width() * image.height();
-            for (int i = 0; i < n; i++) {
-                QRgb p;
-                if ((4 * i + 3) < count) {
-                    p = qRgba(mltLevels.at(4 * i), mltLevels.at(4 * i + 1), mltLevels.at(4 * i + 2), mltLevels.at(4 * i + 3));
-                } else {
-                    int last = mltLevels.last();
-                    int r = (4 * i + 0) < count ? mltLevels.at(4 * i + 0) : last;
-                    int g = (4 * i + 1) < count ? mltLevels.at(4 * i + 1) : last;
-                    int b = (4 * i + 2) < count ? mltLevels.at(4 * i + 2) : last;
-                    int a = last;
-                    p = qRgba(r, g, b, a);
-                }
-                image.setPixel(i / channels, i % channels, p);
+        }
+        QScopedPointer<Mlt::Frame> mltFrame(audioProducer->get_frame());
+        int samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
+        int frameChannels = channels;
+        if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
+            auto *pcm = static_cast<int16_t *>(mltFrame->get_audio(audioFormat, frequency, frameChannels, samples));
+            peaksBuilder->addSamples(pcm, samples, frameChannels);
+            for (int channel = 0; channel < channels; ++channel) {
+                uint lev = 256 * qMin(mltFrame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
+                mltLevels << lev;
+                maxLevel = qMax(lev, maxLevel);
             }
-            image.save(cachePath);
-            audioCreated = true;
+        } else {
+            peaksBuilder->addSilence(samples);
+            for (int channel = 0; channel < channels; channel++) {
+                mltLevels << (mltLevels.isEmpty() ? 0 : mltLevels.last());
+            }
+        }
+        // Incrementally update the audio levels every 3 seconds.
+        if (updateTime.elapsed() > 3000 && !m_isCanceled) {
+            updateTime.restart();
+            QMutexLocker lk(&data.mutex);
+            std::copy(mltLevels.constBegin(), mltLevels.constEnd(), data.levels.begin() + firstFrame * channels);
+            publishLevels(binClip, data.stream, data.levels, 0);
+            lk.unlock();
             QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
         }
     }
-    if (!audioCreated && !m_isCanceled) {
-        // Audio was cached, ensure the bin thumbnail is loaded
-        QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, true));
-    }
+    m_progress = 100;
     QMetaObject::invokeMethod(m_object, "updateJobProgress");
+
+    QMutexLocker lk(&data.mutex);
+    releaseSegment();
+    if (m_isCanceled || data.canceled) {
+        data.canceled = true;
+        return;
+    }
+    // Publish this segment
+    std::copy(mltLevels.constBegin(), mltLevels.constEnd(), data.levels.begin() + firstFrame * channels);
+    data.maxLevel = qMax(data.maxLevel, maxLevel);
+    data.peaks[size_t(m_segment)] = std::move(peaksBuilder);
+    if (data.remaining > 0) {
+        publishLevels(binClip, data.stream, data.levels, 0);
+        lk.unlock();
+        QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
+        return;
+    }
+    // All segments are done, stitch them and store levels and peaks for caching.
+    publishLevels(binClip, data.stream, data.levels, int(data.maxLevel));
+    AudioPeaksBuilder &peaks = *data.peaks.front().get();
+    for (size_t i = 1; i < data.peaks.size(); i++) {
+        peaks.append(*data.peaks[i].get());
+    }
+    if (peaks.write(data.cachePath, data.levels, int(data.maxLevel))) {
+        binClip->setAudioPeaks(data.stream, AudioPeaks::open(data.cachePath));
+    }
+    data.peaks.clear();
+    lk.unlock();
+    QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
 }
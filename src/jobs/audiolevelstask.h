@@ -12,14 +12,39 @@
 
 #include <QRunnable>
 #include <QObject>
+#include <memory>
 
+class ProjectClip;
+struct AudioLevelsStream;
+
+/** @class AudioLevelsTask
+    @brief Generates the audio thumbnails of a clip.
+    The first task checks the cache and, for each audio stream that needs to be
+    processed, starts one task per time segment of the stream, so that long clips
+    and multi stream clips use several threads. The last segment task of a stream
+    to finish joins the results and writes the cache file.
+ */
 class AudioLevelsTask : public AbstractTask
 {
 public:
     AudioLevelsTask(const ObjectId &owner, QObject* object);
+    ~AudioLevelsTask() override;
     static void start(const ObjectId &owner, QObject* object, bool force = false);
 
 protected:
     void run() override;
 
+private:
+    AudioLevelsTask(const ObjectId &owner, QObject *object, std::shared_ptr<AudioLevelsStream> stream, int segment);
+    /** @brief Stream processed by this task, nullptr for the initial task */
+    std::shared_ptr<AudioLevelsStream> m_stream;
+    /** @brief Time segment of the stream processed by this task, -1 for the initial task */
+    int m_segment;
+    /** @brief True once this segment was removed from the remaining segments of the stream */
+    bool m_released;
+    void processSegment();
+    /** @brief Remove this segment from the remaining segments of the stream, the stream mutex must be locked */
+    void releaseSegment();
+    /** @brief Make the levels of a stream available to the timeline */
+    static void publishLevels(const std::shared_ptr<ProjectClip> &binClip, int stream, const QVector<uint8_t> &levels, int maxLevel);
 };
@@ -47,6 +47,12 @@ void CacheTask::start(const ObjectId &owner, int thumbsCount, int in, int out, Q
     pCore->taskManager.startTask(owner.itemId, task);
 }
 
+// static
+int CacheTask::thumbsStep(int duration, int thumbsCount)
+{
+    return qCeil(qMax(pCore->getCurrentFps(), double(duration) / thumbsCount));
+}
+
 void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
 {
     // Fetch thumbnail
@@ -54,42 +60,57 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
         std::unique_ptr<Mlt::Producer> thumbProd(nullptr);
         int duration = m_out > 0 ? m_out - m_in : binClip->getFramePlaytime();
         std::set<int> frames;
-        int steps = qCeil(qMax(pCore->getCurrentFps(), double(duration) / m_thumbsCount));
+        int steps = thumbsStep(duration, m_thumbsCount);
         int pos = m_in;
         for (int i = 1; i <= m_thumbsCount && pos <= m_in + duration; ++i) {
             frames.insert(pos);
             pos = m_in + (steps * i);
         }
-        int size = int(frames.size());
-        int count = 0;
         const QString clipId = QString::number(m_owner.itemId);
+        // Collect the sorted positions that are not cached yet
+        std::vector<int> batch;
         for (int i : frames) {
-            m_progress = 100 * count / size;
-            QMetaObject::invokeMethod(m_object, "updateJobProgress");
-            count++;
+            if (!ThumbnailCache::get()->hasThumbnail(clipId, i)) {
+                batch.push_back(i);
+            }
+        }
+        if (batch.empty()) {
+            return;
+        }
+        thumbProd = binClip->getThumbProducer();
+        if (thumbProd == nullptr) {
+            // Thumb producer not available
+            return;
+        }
+        int size = int(batch.size());
+        int count = 0;
+        // Let MLT scale the frames to the thumbnail size while converting them instead of rescaling each image
+        const int height = m_fullWidth > 0 ? pCore->thumbProfile().height() : 0;
+        // Seek once and then read the frames in order, only the images of the wanted positions are fetched
+        // so the producer decodes forward from its current position
+        thumbProd->set_speed(1.);
+        thumbProd->seek(batch.front());
+        auto next = batch.cbegin();
+        for (int position = batch.front(); next != batch.cend(); ++position) {
             if (m_isCanceled || pCore->taskManager.isBlocked()) {
                 break;
             }
-            if (ThumbnailCache::get()->hasThumbnail(clipId, i)) {
+            QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
+            if (position != *next) {
                 continue;
             }
-            if (thumbProd == nullptr) {
-                thumbProd = binClip->getThumbProducer();
-            }
-            if (thumbProd == nullptr) {
-                // Thumb producer not available
-                break;
-            }
-            thumbProd->seek(i);
-            QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
+            ++next;
+            m_progress = 100 * count / size;
+            QMetaObject::invokeMethod(m_object, "updateJobProgress");
+            count++;
             if (frame != nullptr && frame->is_valid()) {
                 frame->set("consumer.deinterlacer", "onefield");
                 frame->set("consumer.top_field_first", -1);
                 frame->set("consumer.rescale", "nearest");
-                QImage result = KThumb::getFrame(frame.data(), 0, 0, m_fullWidth);
+                QImage result = KThumb::getFrame(frame.data(), m_fullWidth, height);
                 if (!result.isNull() && !m_isCanceled) {
-                    qDebug() << "==== CACHING FRAME: " << i;
-                    ThumbnailCache::get()->storeThumbnail(clipId, i, result, true);
+                    qDebug() << "==== CACHING FRAME: " << position;
+                    ThumbnailCache::get()->storeThumbnail(clipId, position, result, true);
                 }
             }
         }
@@ -25,6 +25,9 @@ public:
     CacheTask(const ObjectId &owner, int thumbsCount, int in, int out, QObject* object);
     ~CacheTask() override;
     static void start(const ObjectId &owner, int thumbsCount = 30, int in = 0, int out = 0, QObject* object = nullptr, bool force = false);
+    /** @brief The distance in frames between the @param thumbsCount preview thumbnails of a clip with @param duration frames.
+        The bin previews use it to look up the cached thumbnails */
+    static int thumbsStep(int duration, int thumbsCount = 30);
 
 protected:
     void run() override;
@@ -23,13 +23,47 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QPointer>
-#include <QProcess>
-#include <QTemporaryFile>
 #include <QThread>
+#include <QtConcurrent>
+
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltProducer.h>
 
 #include <KLocalizedString>
 #include <project/projectmanager.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENESPLIT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+// Frames analysed by each producer, shorter clips are not split since each segment has to open and seek its own producer
+constexpr int minSegmentSeconds = 30;
+
+/** @brief Sum of the absolute differences between the @p count bytes of @p a and @p b. */
+quint64 sumOfDifferences(const uchar *a, const uchar *b, int count)
+{
+    quint64 sum = 0;
+    int i = 0;
+#ifdef SCENESPLIT_SSE2
+    __m128i total = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        total = _mm_add_epi64(total, _mm_sad_epu8(va, vb));
+    }
+    alignas(16) quint64 parts[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(parts), total);
+    sum = parts[0] + parts[1];
+#endif
+    for (; i < count; ++i) {
+        sum += quint64(qAbs(int(a[i]) - int(b[i])));
+    }
+    return sum;
+}
+} // namespace
+
 SceneSplitTask::SceneSplitTask(const ObjectId &owner, double threshold, int markersCategory, bool addSubclips, int minDuration, QObject *object)
     : AbstractTask(owner, AbstractTask::ANALYSECLIPJOB, object)
     , m_threshold(threshold)
@@ -37,7 +71,6 @@ SceneSplitTask::SceneSplitTask(const ObjectId &owner, double threshold, int mark
     , m_markersType(markersCategory)
     , m_subClips(addSubclips)
     , m_minInterval(minDuration)
-    , m_jobProcess(nullptr)
 {
     m_description = i18n("Detecting scene change");
     qDebug() << "Threshold is" << threshold << QString::number(threshold);
@@ -109,9 +142,7 @@ void SceneSplitTask::run()
     QMutexLocker lock(&m_runMutex);
     m_running = true;
     auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.itemId));
-    const QString source = binClip->url();
     ClipType::ProducerType type = binClip->clipType();
-    bool result;
     if (type != ClipType::AV && type != ClipType::Video) {
         // This job can only process video files
         QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection, Q_ARG(QString, i18n("Cannot analyse this clip type.")),
@@ -119,84 +150,36 @@ void SceneSplitTask::run()
         qDebug() << "=== ABORT 1";
         return;
     }
-    if (KdenliveSettings::ffmpegpath().isEmpty()) {
-        // FFmpeg not detected, cannot process the Job
-        QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection,
-                                  Q_ARG(QString, i18n("FFmpeg not found, please set path in Kdenlive's settings Environment.")),
-                                  Q_ARG(int, int(KMessageWidget::Warning)));
-        qDebug() << "=== ABORT 2";
-        return;
-    }
-    m_jobDuration = int(binClip->duration().seconds());
     int producerDuration = binClip->frameDuration();
-    // QStringList parameters =
-    // {QStringLiteral("-loglevel"),QStringLiteral("info"),QStringLiteral("-i"),source,QStringLiteral("-filter:v"),QString("scdet"),QStringLiteral("-f"),QStringLiteral("null"),QStringLiteral("-")};
-    QStringList parameters = {QStringLiteral("-y"),
-                              QStringLiteral("-loglevel"),
-                              QStringLiteral("info"),
-                              QStringLiteral("-i"),
-                              source,
-                              QStringLiteral("-filter:v"),
-                              QString("select='gt(scene,%1)',showinfo").arg(m_threshold),
-                              QStringLiteral("-vsync"),
-                              QStringLiteral("vfr"),
-                              QStringLiteral("-f"),
-                              QStringLiteral("null"),
-                              QStringLiteral("-")};
-
-    m_jobProcess.reset(new QProcess);
-    // m_jobProcess->setStandardErrorFile("/tmp/test_settings.txt");
-    m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
-    qDebug() << "=== READY TO START JOB:" << parameters;
-    QObject::connect(this, &SceneSplitTask::jobCanceled, m_jobProcess.get(), &QProcess::kill, Qt::DirectConnection);
-    QObject::connect(m_jobProcess.get(), &QProcess::readyReadStandardOutput, this, &SceneSplitTask::processLogInfo);
-    QObject::connect(m_jobProcess.get(), &QProcess::readyReadStandardError, this, &SceneSplitTask::processLogErr);
-    m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters);
-    // m_jobProcess->closeReadChannel(QProcess::StandardError);
-    m_jobProcess->waitForStarted();
-    // QString data;
-    /*while(m_jobProcess->waitForReadyRead()) {
-        //data.append(m_jobProcess->readAll());
-        qDebug()<<"???? READ: \n"<<m_jobProcess->readAll();
-    }*/
-    m_jobProcess->waitForFinished(-1);
-    result = m_jobProcess->exitStatus() == QProcess::NormalExit;
+    m_jobDuration = producerDuration;
+    // Split the clip in segments analysed in parallel, each with its own producer
+    const int minSegment = qMax(1, qRound(pCore->getCurrentFps() * minSegmentSeconds));
+    const int segmentsCount = qBound(1, producerDuration / minSegment, QThread::idealThreadCount());
+    m_segments.clear();
+    for (int i = 0; i < segmentsCount; ++i) {
+        Segment segment;
+        segment.start = int(qint64(producerDuration) * i / segmentsCount);
+        segment.end = int(qint64(producerDuration) * (i + 1) / segmentsCount);
+        m_segments.push_back(segment);
+    }
+    QtConcurrent::blockingMap(m_segments, [this, &binClip](Segment &segment) {
+        analyseSegment(binClip, segment);
+        QMutexLocker resultsLock(&m_resultsMutex);
+        segment.done = true;
+        flushResults();
+    });
 
-    // remove temporary playlist if it exists
     m_progress = 100;
     QMetaObject::invokeMethod(m_object, "updateJobProgress");
-    if (result && !m_isCanceled) {
+    if (!m_failed && !m_isCanceled) {
         qDebug() << "========================\n\nGOR RESULTS: " << m_results << "\n\n=========";
-        auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.itemId));
-        if (m_markersType >= 0) {
-            // Build json data for markers
-            QJsonArray list;
-            int ix = 1;
-            int lastCut = 0;
-            for (auto &marker : m_results) {
-                int pos = GenTime(marker).frames(pCore->getCurrentFps());
-                if (m_minInterval > 0 && ix > 1 && pos - lastCut < m_minInterval) {
-                    continue;
-                }
-                lastCut = pos;
-                QJsonObject currentMarker;
-                currentMarker.insert(QLatin1String("pos"), QJsonValue(pos));
-                currentMarker.insert(QLatin1String("comment"), QJsonValue(i18n("Scene %1", ix)));
-                currentMarker.insert(QLatin1String("type"), QJsonValue(m_markersType));
-                list.push_back(currentMarker);
-                ix++;
-            }
-            QJsonDocument json(list);
-            QMetaObject::invokeMethod(m_object, "importJsonMarkers", Q_ARG(QString, QString(json.toJson())));
-        }
         if (m_subClips) {
             // Create zones
             int ix = 1;
             int lastCut = 0;
             QJsonArray list;
             QJsonDocument json;
-            for (double &marker : m_results) {
-                int pos = GenTime(marker).frames(pCore->getCurrentFps());
+            for (int pos : qAsConst(m_results)) {
                 if (pos <= lastCut + 1 || pos - lastCut < m_minInterval) {
                     continue;
                 }
@@ -222,69 +205,90 @@ void SceneSplitTask::run()
                                           Q_ARG(QString, dataMap), Q_ARG(bool, true));
             }
         }
-    } else {
-        // Proxy process crashed
+    } else if (m_failed) {
         QMetaObject::invokeMethod(pCore.get(), "displayBinLogMessage", Qt::QueuedConnection, Q_ARG(QString, i18n("Failed to analyse clip.")),
-                                  Q_ARG(int, int(KMessageWidget::Warning)), Q_ARG(QString, m_logDetails));
+                                  Q_ARG(int, int(KMessageWidget::Warning)), Q_ARG(QString, m_errorMessage));
     }
 }
 
-void SceneSplitTask::processLogErr()
+void SceneSplitTask::analyseSegment(const std::shared_ptr<ProjectClip> &binClip, Segment &segment)
 {
-    const QString buffer = QString::fromUtf8(m_jobProcess->readAllStandardError());
-    qDebug() << "ERROR: ----\n" << buffer;
+    std::unique_ptr<Mlt::Producer> producer = binClip->getThumbProducer();
+    if (producer == nullptr || !producer->is_valid()) {
+        m_failed = true;
+        QMutexLocker resultsLock(&m_resultsMutex);
+        m_errorMessage = i18n("Cannot open clip %1", binClip->url());
+        return;
+    }
+    // Like the scene detection of FFmpeg, the score of a frame is based on the mean absolute difference with the previous frame,
+    // compared to the difference of the previous frame. Start 2 frames early to have both values on the first frame of the segment.
+    std::vector<uchar> previous;
+    std::vector<uchar> current;
+    double previousDifference = 0.;
+    int analysed = 0;
+    // Seek once and decode the following frames in order, each get_frame() moves the producer to the next frame
+    producer->set_speed(1.);
+    producer->seek(qMax(0, segment.start - 2));
+    for (int pos = qMax(0, segment.start - 2); pos < segment.end; ++pos) {
+        if (m_isCanceled || m_failed) {
+            return;
+        }
+        std::unique_ptr<Mlt::Frame> frame(producer->get_frame());
+        if (frame == nullptr || !frame->is_valid()) {
+            continue;
+        }
+        frame->set("consumer.deinterlacer", "onefield");
+        frame->set("consumer.top_field_first", -1);
+        frame->set("consumer.rescale", "nearest");
+        // The luma plane comes first in planar YUV, no conversion to RGB is needed
+        mlt_image_format format = mlt_image_yuv420p;
+        int width = 0;
+        int height = 0;
+        const uchar *image = frame->get_image(format, width, height);
+        if (image == nullptr || format != mlt_image_yuv420p) {
+            continue;
+        }
+        const int count = width * height;
+        current.assign(image, image + count);
+        if (previous.size() == current.size()) {
+            const double difference = double(sumOfDifferences(previous.data(), current.data(), count)) / count;
+            const double score = qBound(0., qMin(difference, qAbs(difference - previousDifference)) / 100., 1.);
+            if (pos >= segment.start && score > m_threshold) {
+                segment.cuts << pos;
+            }
+            previousDifference = difference;
+        }
+        std::swap(previous, current);
+        if (pos >= segment.start && ++analysed % 25 == 0) {
+            const int processed = m_processedFrames.fetch_add(25) + 25;
+            m_progress = int(100. * processed / qMax(1, m_jobDuration));
+            QMetaObject::invokeMethod(m_object, "updateJobProgress");
+        }
+    }
 }
 
-void SceneSplitTask::processLogInfo()
+void SceneSplitTask::flushResults()
 {
-    const QString buffer = QString::fromUtf8(m_jobProcess->readAllStandardOutput());
-    m_logDetails.append(buffer);
-    int progress = 0;
-    // Parse FFmpeg output
-    qDebug() << "-------------\n" << buffer;
-    if (buffer.contains(QLatin1String("[Parsed_showinfo"))) {
-        QString timeMarker("pts_time:");
-        bool ok;
-        QStringList output = buffer.split("[Parsed_showinfo");
-        output.removeFirst();
-        for (const QString &o : qAsConst(output)) {
-            if (o.contains(timeMarker)) {
-                double res = o.section(timeMarker, 1).section(QLatin1Char(' '), 0, 0).toDouble(&ok);
-                if (ok) {
-                    m_results << res;
-                }
+    // Markers are numbered in order, so they are only sent once all the previous segments are analysed
+    QJsonArray list;
+    while (m_flushedSegments < m_segments.size() && m_segments.at(m_flushedSegments).done) {
+        for (int pos : qAsConst(m_segments.at(m_flushedSegments).cuts)) {
+            m_results << pos;
+            if (m_markersType < 0 || (m_minInterval > 0 && m_markerIndex > 1 && pos - m_lastMarker < m_minInterval)) {
+                continue;
             }
+            m_lastMarker = pos;
+            QJsonObject currentMarker;
+            currentMarker.insert(QLatin1String("pos"), QJsonValue(pos));
+            currentMarker.insert(QLatin1String("comment"), QJsonValue(i18n("Scene %1", m_markerIndex)));
+            currentMarker.insert(QLatin1String("type"), QJsonValue(m_markersType));
+            list.push_back(currentMarker);
+            m_markerIndex++;
         }
+        m_flushedSegments++;
     }
-    if (m_jobDuration == 0) {
-        qDebug() << "=== NO DURATION!!!";
-        if (buffer.contains(QLatin1String("Duration:"))) {
-            QString data = buffer.section(QStringLiteral("Duration:"), 1, 1).section(QLatin1Char(','), 0, 0).simplified();
-            if (!data.isEmpty()) {
-                qDebug() << "==== GOT DURATION:" << data;
-                QStringList numbers = data.split(QLatin1Char(':'));
-                if (numbers.size() < 3) {
-                    return;
-                }
-                m_jobDuration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toInt();
-            }
-        }
-    } else if (buffer.contains(QLatin1String("time="))) {
-        QString time = buffer.section(QStringLiteral("time="), 1, 1).simplified().section(QLatin1Char(' '), 0, 0);
-        qDebug() << "=== GOT PROGRESS TIME: " << time;
-        if (!time.isEmpty()) {
-            QStringList numbers = time.split(QLatin1Char(':'));
-            if (numbers.size() < 3) {
-                progress = time.toInt();
-                if (progress == 0) {
-                    return;
-                }
-            } else {
-                progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + qRound(numbers.at(2).toDouble());
-            }
-        }
-        m_progress = 100 * progress / m_jobDuration;
-        QMetaObject::invokeMethod(m_object, "updateJobProgress");
-        // Q_EMIT jobProgress(int(100.0 * progress / m_jobDuration));
+    if (!list.isEmpty() && !m_isCanceled && !m_failed) {
+        QJsonDocument json(list);
+        QMetaObject::invokeMethod(m_object, "importJsonMarkers", Q_ARG(QString, QString(json.toJson())));
     }
 }
@@ -8,7 +8,12 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "abstracttask.h"
 
-class QProcess;
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class ProjectClip;
 
 class SceneSplitTask : public AbstractTask
 {
@@ -19,18 +24,34 @@ public:
 protected:
     void run() override;
 
-private Q_SLOTS:
-    void processLogInfo();
-    void processLogErr();
-
 private:
+    /** @brief A range of frames of the clip analysed by a single producer, several segments are analysed in parallel. */
+    struct Segment
+    {
+        int start;
+        int end;
+        // The first frames of the new scenes found in [start, end)
+        QList<int> cuts;
+        bool done{false};
+    };
     double m_threshold;
     int m_jobDuration;
     int m_markersType;
     bool m_subClips;
     int m_minInterval;
-    std::unique_ptr<QProcess> m_jobProcess;
     QString m_errorMessage;
-    QString m_logDetails;
-    QList<double> m_results;
+    std::vector<Segment> m_segments;
+    // Protects the segment results, the detected cuts and the state of the markers streamed to the clip
+    QMutex m_resultsMutex;
+    QList<int> m_results;
+    size_t m_flushedSegments{0};
+    int m_markerIndex{1};
+    int m_lastMarker{0};
+    std::atomic<int> m_processedFrames{0};
+    std::atomic<bool> m_failed{false};
+
+    /** @brief Detects the scene cuts in @param segment from frames decoded at the thumbnail resolution. */
+    void analyseSegment(const std::shared_ptr<ProjectClip> &binClip, Segment &segment);
+    /** @brief Appends the cuts of the segments analysed so far, in order, to the results and sends their markers to the clip. */
+    void flushResults();
 };
@@ -23,10 +23,9 @@ TaskManager::TaskManager(QObject *parent)
     , displayedClip(-1)
     , m_tasksListLock(QReadWriteLock::Recursive)
     , m_blockUpdates(false)
+    , m_playingMonitors(0)
 {
-    int maxThreads = qMin(4, QThread::idealThreadCount() - 1);
-    m_taskPool.setMaxThreadCount(qMax(maxThreads, 1));
-    m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
+    updateConcurrency();
 }
 
 TaskManager::~TaskManager()
@@ -41,9 +40,42 @@ bool TaskManager::isBlocked() const
 
 void TaskManager::updateConcurrency()
 {
+    // Scale with the number of cores, but keep one core for the UI and playback on small machines
+    const int cores = QThread::idealThreadCount();
+    m_taskPool.setMaxThreadCount(qBound(1, cores - 1, 8));
+    m_backgroundPool.setMaxThreadCount(m_playingMonitors != 0 ? 1 : qBound(1, cores / 2, 8));
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
 }
 
+void TaskManager::setPlaybackActive(int monitorId, bool active)
+{
+    const int previous = m_playingMonitors;
+    if (active) {
+        m_playingMonitors |= monitorId;
+    } else {
+        m_playingMonitors &= ~monitorId;
+    }
+    if ((previous != 0) != (m_playingMonitors != 0)) {
+        // Running tasks continue, queued background tasks run one at a time while playing
+        updateConcurrency();
+    }
+}
+
+QThreadPool *TaskManager::poolForTask(const AbstractTask *task)
+{
+    switch (task->m_type) {
+    case AbstractTask::TRANSCODEJOB:
+    case AbstractTask::PROXYJOB:
+        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
+        return &m_transcodePool;
+    case AbstractTask::LOADJOB:
+    case AbstractTask::THUMBJOB:
+        return &m_taskPool;
+    default:
+        return &m_backgroundPool;
+    }
+}
+
 void TaskManager::discardJobs(const ObjectId &owner, AbstractTask::JOBTYPE type, bool softDelete, const QVector<AbstractTask::JOBTYPE> exceptions)
 {
     qDebug() << "========== READY FOR TASK DISCARD ON: " << owner.itemId;
@@ -187,9 +219,11 @@ void TaskManager::slotCancelJobs(bool leaveBlocked, const QVector<AbstractTask::
     }
     if (exceptions.isEmpty()) {
         m_taskPool.waitForDone();
+        m_backgroundPool.waitForDone();
         m_transcodePool.waitForDone();
         m_taskList.clear();
         m_taskPool.clear();
+        m_backgroundPool.clear();
     }
     if (!leaveBlocked) {
         m_blockUpdates = false;
@@ -217,12 +251,12 @@ void TaskManager::startTask(int ownerId, AbstractTask *task)
     } else {
         m_taskList[ownerId].emplace_back(task);
     }
-    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
-        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
-        m_transcodePool.start(task, task->m_priority);
-    } else {
-        m_taskPool.start(task, task->m_priority);
+    int priority = task->m_priority;
+    if (ownerId == displayedClip) {
+        // The user is looking at this clip in the monitor
+        priority += 20;
     }
+    poolForTask(task)->start(task, priority);
     m_tasksListLock.unlock();
     updateJobCount();
 }
@@ -29,6 +29,10 @@ Q_DECLARE_METATYPE(TaskManagerStatus)
 
 /** @class TaskManager
     @brief This class is responsible for clip jobs management.
+    Tasks run in three thread pools: clip loading and thumbnails, which the user is waiting for,
+    transcoding, limited by the proxy threads setting, and all other background tasks.
+    Within a pool, tasks are started by priority, tasks of the clip displayed in Clip Monitor first.
+    Background tasks are limited to one thread while a monitor is playing.
  */
 class TaskManager : public QObject
 {
@@ -65,6 +69,10 @@ public:
     /** @brief Update the number of concurrent jobs allowed */
     void updateConcurrency();
 
+    /** @brief Inform the manager that monitor @param monitorId (a Kdenlive::MonitorId flag) started or stopped playing.
+        Background tasks run on a single thread during playback */
+    void setPlaybackActive(int monitorId, bool active);
+
     /** @brief We are aborting all tasks and don't want them to send any updates */
     bool isBlocked() const;
 
@@ -83,8 +91,15 @@ private Q_SLOTS:
     void updateJobCount();
 
 private:
+    /** @brief Pool for clip loading and thumbnails */
     QThreadPool m_taskPool;
+    /** @brief Pool for audio thumbnails, cache and analysis tasks */
+    QThreadPool m_backgroundPool;
     QThreadPool m_transcodePool;
+    /** @brief Bit mask of the monitors currently playing */
+    int m_playingMonitors;
+    /** @brief Returns the pool in which @param task should run */
+    QThreadPool *poolForTask(const AbstractTask *task);
     std::unordered_map<int, std::vector<AbstractTask*> > m_taskList;
     mutable QReadWriteLock m_tasksListLock;
     bool m_blockUpdates;
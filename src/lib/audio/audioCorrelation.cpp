@@ -9,8 +9,75 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "kdenlive_debug.h"
 #include "klocalizedstring.h"
 #include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <algorithm>
 #include <cmath>
-#include <iostream>
+
+namespace {
+// Entries of the main envelope above which the correlation is first computed at a lower resolution
+constexpr size_t coarseMinimum = 16384;
+// Number of envelope entries summed in one entry of the low resolution envelopes
+constexpr qint64 coarseFactor = 4;
+// Low resolution matches refined at full resolution
+constexpr int coarseCandidates = 3;
+// The refined correlation values are normalized products, keep some of their fractional part
+constexpr double refinedScale = 1024.;
+
+std::vector<qint64> decimate(const std::vector<qint64> &envelope)
+{
+    std::vector<qint64> result((envelope.size() + coarseFactor - 1) / coarseFactor, 0);
+    for (size_t i = 0; i < envelope.size(); ++i) {
+        result[i / coarseFactor] += envelope[i];
+    }
+    return result;
+}
+
+qint64 maxAbs(const std::vector<qint64> &envelope)
+{
+    qint64 result = 1;
+    for (qint64 value : envelope) {
+        result = std::max(result, qAbs(value));
+    }
+    return result;
+}
+
+/**
+  Sums of the products and squares of the overlapping entries when sub[t]
+  is aligned with main[t + shift].
+  */
+struct Overlap
+{
+    double product = 0.;
+    double mainSquares = 0.;
+    double subSquares = 0.;
+};
+
+Overlap overlap(const std::vector<qint64> &main, const std::vector<qint64> &sub, qint64 shift)
+{
+    Overlap result;
+    const qint64 first = std::max(qint64(0), -shift);
+    const qint64 last = std::min(qint64(sub.size()), qint64(main.size()) - shift);
+    for (qint64 t = first; t < last; ++t) {
+        const double s = double(sub[size_t(t)]);
+        const double m = double(main[size_t(t + shift)]);
+        result.product += s * m;
+        result.mainSquares += m * m;
+        result.subSquares += s * s;
+    }
+    return result;
+}
+} // namespace
+
+AudioCorrelation::Reference::Reference(std::vector<qint64> mainEnvelope)
+    : envelope(std::move(mainEnvelope))
+    , coarseEnvelope(envelope.size() >= coarseMinimum ? decimate(envelope) : std::vector<qint64>())
+    , fft(envelope.data(), envelope.size())
+{
+    if (!coarseEnvelope.empty()) {
+        coarseFft = std::make_unique<FFTReference>(coarseEnvelope.data(), coarseEnvelope.size());
+    }
+}
 
 AudioCorrelation::AudioCorrelation(std::unique_ptr<AudioEnvelope> mainTrackEnvelope)
     : m_mainTrackEnvelope(std::move(mainTrackEnvelope))
@@ -22,11 +89,12 @@ AudioCorrelation::AudioCorrelation(std::unique_ptr<AudioEnvelope> mainTrackEnvel
 
 AudioCorrelation::~AudioCorrelation()
 {
-    for (AudioEnvelope *envelope : qAsConst(m_children)) {
+    // Running alignments only use copies of the envelopes, their watchers are deleted with this object
+    for (AudioEnvelope *envelope : qAsConst(m_pendingChildren)) {
         delete envelope;
     }
-    for (AudioCorrelationInfo *info : qAsConst(m_correlations)) {
-        delete info;
+    for (AudioEnvelope *envelope : qAsConst(m_children)) {
+        delete envelope;
     }
 
     qCDebug(KDENLIVE_LOG) << "Envelope deleted.";
@@ -34,7 +102,13 @@ AudioCorrelation::~AudioCorrelation()
 
 void AudioCorrelation::slotAnnounceEnvelope()
 {
+    m_reference = std::make_shared<const Reference>(m_mainTrackEnvelope->envelope());
     Q_EMIT displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage, 300);
+    // Children whose envelope was ready before the main one
+    for (AudioEnvelope *envelope : qAsConst(m_readyChildren)) {
+        startAlignment(envelope);
+    }
+    m_readyChildren.clear();
 }
 
 void AudioCorrelation::addChild(AudioEnvelope *envelope)
@@ -43,70 +117,50 @@ void AudioCorrelation::addChild(AudioEnvelope *envelope)
     // there is no race condition where the signal 'envelopeReady' is
     // lost.
     Q_ASSERT(!envelope->hasComputationStarted());
+    m_pendingChildren.append(envelope);
     connect(envelope, &AudioEnvelope::envelopeReady, this, &AudioCorrelation::slotProcessChild);
     envelope->startComputeEnvelope();
 }
 
 void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
 {
-    // Note that at this point the computation of the envelope of the
-    // main track might not be finished. envelope() will block until
-    // the computation is done.
-    const size_t sizeMain = m_mainTrackEnvelope->envelope().size();
-    const size_t sizeSub = envelope->envelope().size();
-
-    auto *info = new AudioCorrelationInfo(sizeMain, sizeSub);
-    qint64 *correlation = info->correlationVector();
-
-    const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
-    const std::vector<qint64> &envSub = envelope->envelope();
-    qint64 max = 0;
-
-    if (sizeSub > 200) {
-        FFTCorrelation::correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation);
-    } else {
-        correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation, &max);
-        info->setMax(max);
+    if (!m_reference) {
+        // Wait for the envelope of the main track instead of blocking the UI until it is computed
+        m_readyChildren.append(envelope);
+        return;
     }
-
-    m_children.append(envelope);
-    m_correlations.append(info);
-
-    Q_ASSERT(m_correlations.size() == m_children.size());
-    int index = m_children.indexOf(envelope);
-    int shift = getShift(index);
-    Q_EMIT gotAudioAlignData(envelope->clipId(), shift);
-}
-
-int AudioCorrelation::getShift(int childIndex) const
-{
-    Q_ASSERT(childIndex >= 0);
-    Q_ASSERT(childIndex < m_correlations.size());
-
-    size_t indexOffset = m_correlations.at(childIndex)->maxIndex();
-    indexOffset -= m_children.at(childIndex)->envelope().size();
-    indexOffset += m_children.at(childIndex)->offset();
-
-    return int(indexOffset);
+    startAlignment(envelope);
 }
 
-AudioCorrelationInfo const *AudioCorrelation::info(int childIndex) const
+void AudioCorrelation::startAlignment(AudioEnvelope *envelope)
 {
-    Q_ASSERT(childIndex >= 0);
-    Q_ASSERT(childIndex < m_correlations.size());
-
-    return m_correlations.at(childIndex);
+    // The computation only uses the shared reference and a copy of the envelope,
+    // so it does not depend on this object or the envelope if they get deleted
+    std::shared_ptr<const Reference> reference = m_reference;
+    std::vector<qint64> data = envelope->envelope();
+    auto *watcher = new QFutureWatcher<Alignment>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, envelope]() {
+        const Alignment alignment = watcher->result();
+        watcher->deleteLater();
+        m_pendingChildren.removeOne(envelope);
+        m_children.append(envelope);
+        m_correlations.append(alignment.info);
+        Q_ASSERT(m_correlations.size() == m_children.size());
+        int shift = getShift(m_children.size() - 1);
+        Q_EMIT gotAudioAlignData(envelope->clipId(), shift, alignment.confidence);
+    });
+    watcher->setFuture(QtConcurrent::run([reference, data]() { return align(*reference, data); }));
 }
 
-void AudioCorrelation::correlate(const qint64 *envMain, size_t sizeMain, const qint64 *envSub, size_t sizeSub, qint64 *correlation, qint64 *out_max)
+AudioCorrelation::Alignment AudioCorrelation::align(const Reference &reference, const std::vector<qint64> &sub)
 {
-    Q_ASSERT(correlation != nullptr);
-
-    qint64 const *left;
-    qint64 const *right;
-    size_t size;
-    qint64 sum;
-    qint64 max = 0;
+    QElapsedTimer t;
+    t.start();
+    const std::vector<qint64> &main = reference.envelope;
+    Alignment result;
+    result.info = std::make_shared<AudioCorrelationInfo>(main.size(), sub.size());
+    qint64 *correlation = result.info->correlationVector();
+    const qint64 size = qint64(result.info->size());
 
     /*
       Correlation:
@@ -120,38 +174,62 @@ void AudioCorrelation::correlate(const qint64 *envMain, size_t sizeMain, const q
             ^ correlation vector index = SHIFT + sS
 
       main is fixed, sub is shifted along main.
-
     */
-
-    QElapsedTimer t;
-    t.start();
-    for (size_t shift = -sizeSub; shift <= sizeMain; ++shift) {
-
-        if (shift == 0) {
-            left = envSub - shift;
-            right = envMain;
-            size = std::min(sizeSub + shift, sizeMain);
-        } else {
-            left = envSub;
-            right = envMain + shift;
-            size = std::min(sizeSub, sizeMain - shift);
+    if (reference.coarseFft && sub.size() >= size_t(coarseFactor) * 64) {
+        // Find the best matches of the low resolution envelopes, then compute
+        // the correlation at full resolution around them only.
+        std::fill(correlation, correlation + size, 0);
+        const std::vector<qint64> coarseSub = decimate(sub);
+        std::vector<qint64> coarse(reference.coarseEnvelope.size() + coarseSub.size() + 1);
+        reference.coarseFft->correlate(coarseSub.data(), coarseSub.size(), coarse.data());
+        const double scale = refinedScale / (double(maxAbs(main)) * double(maxAbs(sub)));
+        for (int candidate = 0; candidate < coarseCandidates; ++candidate) {
+            auto best = std::max_element(coarse.begin(), coarse.end());
+            if (*best <= 0) {
+                break;
+            }
+            const qint64 coarseShift = qint64(best - coarse.begin()) - qint64(coarseSub.size());
+            // Do not pick the neighbours of this match again
+            std::fill(best - std::min(best - coarse.begin(), std::ptrdiff_t(2)), best + std::min(coarse.end() - best, std::ptrdiff_t(3)), 0);
+            for (qint64 shift = (coarseShift - 2) * coarseFactor; shift <= (coarseShift + 2) * coarseFactor; ++shift) {
+                const qint64 index = shift + qint64(sub.size());
+                if (index < 1 || index >= size) {
+                    continue;
+                }
+                correlation[index] = qint64(overlap(main, sub, shift).product * scale);
+            }
         }
+    } else {
+        reference.fft.correlate(sub.data(), sub.size(), correlation);
+    }
 
-        sum = 0;
-        for (size_t i = 0; i < size; ++i) {
-            sum += (*left) * (*right);
-            left++;
-            right++;
-        }
-        correlation[sizeSub + shift] = qAbs(sum);
-
-        if (sum > max) {
-            max = sum;
+    const size_t bestIndex = result.info->maxIndex();
+    if (correlation[bestIndex] > 0) {
+        const Overlap best = overlap(main, sub, qint64(bestIndex) - qint64(sub.size()));
+        if (best.mainSquares > 0. && best.subSquares > 0.) {
+            result.confidence = qBound(0., best.product / std::sqrt(best.mainSquares * best.subSquares), 1.);
         }
     }
-    qCDebug(KDENLIVE_LOG) << "Correlation calculated. Time taken: " << t.elapsed() << " ms.";
+    qCDebug(KDENLIVE_LOG) << "Alignment computed in" << t.elapsed() << "ms, confidence:" << result.confidence;
+    return result;
+}
 
-    if (out_max != nullptr) {
-        *out_max = max;
-    }
+int AudioCorrelation::getShift(int childIndex) const
+{
+    Q_ASSERT(childIndex >= 0);
+    Q_ASSERT(childIndex < m_correlations.size());
+
+    size_t indexOffset = m_correlations.at(childIndex)->maxIndex();
+    indexOffset -= m_children.at(childIndex)->envelope().size();
+    indexOffset += m_children.at(childIndex)->offset();
+
+    return int(indexOffset);
+}
+
+AudioCorrelationInfo const *AudioCorrelation::info(int childIndex) const
+{
+    Q_ASSERT(childIndex >= 0);
+    Q_ASSERT(childIndex < m_correlations.size());
+
+    return m_correlations.at(childIndex).get();
 }
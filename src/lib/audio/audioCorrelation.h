@@ -10,7 +10,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "audioCorrelationInfo.h"
 #include "audioEnvelope.h"
 #include "definitions.h"
+#include "fftCorrelation.h"
 #include <QList>
+#include <memory>
+#include <vector>
 
 /**
   This class does the correlation between two tracks
@@ -18,6 +21,9 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
   It uses one main track (used in the initializer); further tracks will be
   aligned relative to this main track.
+
+  The transform of the main track is computed once and shared by all the
+  children, which are aligned in parallel in the global thread pool.
   */
 class AudioCorrelation : public QObject
 {
@@ -53,16 +59,46 @@ public:
     int getShift(int childIndex) const;
 
     /**
-      Correlates the two vectors envMain and envSub.
-      \c correlation must be a pre-allocated vector of size sizeMain+sizeSub+1.
+      The main envelope, prepared for correlating it with several children.
+      */
+    struct Reference
+    {
+        explicit Reference(std::vector<qint64> mainEnvelope);
+        std::vector<qint64> envelope;
+        /// The envelope summed over blocks of coarseFactor entries, empty for short envelopes
+        std::vector<qint64> coarseEnvelope;
+        FFTReference fft;
+        std::unique_ptr<FFTReference> coarseFft;
+    };
+
+    struct Alignment
+    {
+        std::shared_ptr<AudioCorrelationInfo> info;
+        /// Normalized cross-correlation of the envelopes at the best shift, between 0 and 1
+        double confidence{0.};
+    };
+
+    /**
+      Correlates the envelope \c sub with the reference. Long envelopes
+      are first correlated at a lower resolution, only the best matches
+      are then computed at full resolution.
+      Can be called from several threads with the same reference.
       */
-    static void correlate(const qint64 *envMain, size_t sizeMain, const qint64 *envSub, size_t sizeSub, qint64 *correlation, qint64 *out_max = nullptr);
+    static Alignment align(const Reference &reference, const std::vector<qint64> &sub);
 
 private:
     std::unique_ptr<AudioEnvelope> m_mainTrackEnvelope;
+    std::shared_ptr<const Reference> m_reference;
 
+    /// Children being computed or aligned
+    QList<AudioEnvelope *> m_pendingChildren;
+    /// Children whose envelope is computed, waiting for the main envelope
+    QList<AudioEnvelope *> m_readyChildren;
     QList<AudioEnvelope *> m_children;
-    QList<AudioCorrelationInfo *> m_correlations;
+    QList<std::shared_ptr<AudioCorrelationInfo>> m_correlations;
+
+    /// Starts aligning an envelope in the thread pool
+    void startAlignment(AudioEnvelope *envelope);
 
 private Q_SLOTS:
     /**
@@ -76,6 +112,6 @@ private Q_SLOTS:
     void slotAnnounceEnvelope();
 
 Q_SIGNALS:
-    void gotAudioAlignData(int, int);
+    void gotAudioAlignData(int clipId, int shift, double confidence);
     void displayMessage(const QString &, MessageType, int);
 };
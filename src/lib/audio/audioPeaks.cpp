@@ -0,0 +1,310 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audioPeaks.h"
+#include "kdenlive_debug.h"
+
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// Increase when the layout of the file changes, old files will be regenerated
+constexpr quint32 peaksFileVersion = 1;
+constexpr char peaksFileMagic[4] = {'K', 'D', 'P', 'K'};
+
+struct FileHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 channels;
+    quint32 frequency;
+    quint32 baseBlockSize;
+    quint32 levels;
+    quint32 maxFrameLevel;
+    quint32 frameLevelsCount;
+    quint64 samples;
+    quint64 frameLevelsOffset;
+};
+
+struct LevelEntry
+{
+    quint64 offset;
+    quint64 blocks;
+};
+
+const FileHeader *header(const uchar *data)
+{
+    return reinterpret_cast<const FileHeader *>(data);
+}
+
+const LevelEntry *levelTable(const uchar *data)
+{
+    return reinterpret_cast<const LevelEntry *>(data + sizeof(FileHeader));
+}
+} // namespace
+
+std::shared_ptr<AudioPeaks> AudioPeaks::open(const QString &path)
+{
+    std::shared_ptr<AudioPeaks> peaks(new AudioPeaks());
+    peaks->m_file.setFileName(path);
+    if (!peaks->m_file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    peaks->m_size = peaks->m_file.size();
+    if (peaks->m_size < qint64(sizeof(FileHeader))) {
+        return nullptr;
+    }
+    peaks->m_data = peaks->m_file.map(0, peaks->m_size);
+    if (peaks->m_data == nullptr) {
+        return nullptr;
+    }
+    const FileHeader *h = header(peaks->m_data);
+    if (memcmp(h->magic, peaksFileMagic, 4) != 0 || h->version != peaksFileVersion || h->baseBlockSize != quint32(BaseBlockSize) || h->channels == 0 ||
+        h->levels > quint32(MaxLevels)) {
+        qCDebug(KDENLIVE_LOG) << "Invalid audio peak file" << path;
+        return nullptr;
+    }
+    // Ensure all sections are inside the file
+    quint64 size = quint64(peaks->m_size);
+    if (sizeof(FileHeader) + h->levels * sizeof(LevelEntry) > size || h->frameLevelsOffset + h->frameLevelsCount > size) {
+        return nullptr;
+    }
+    const LevelEntry *table = levelTable(peaks->m_data);
+    for (quint32 i = 0; i < h->levels; i++) {
+        if (table[i].offset % alignof(Peak) != 0 || table[i].offset + table[i].blocks * h->channels * sizeof(Peak) > size) {
+            qCDebug(KDENLIVE_LOG) << "Corrupted audio peak file" << path;
+            return nullptr;
+        }
+    }
+    return peaks;
+}
+
+AudioPeaks::~AudioPeaks()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+int AudioPeaks::channels() const
+{
+    return int(header(m_data)->channels);
+}
+
+int AudioPeaks::frequency() const
+{
+    return int(header(m_data)->frequency);
+}
+
+qint64 AudioPeaks::samples() const
+{
+    return qint64(header(m_data)->samples);
+}
+
+int AudioPeaks::levelCount() const
+{
+    return int(header(m_data)->levels);
+}
+
+int AudioPeaks::blockSize(int level) const
+{
+    return BaseBlockSize << level;
+}
+
+qint64 AudioPeaks::blockCount(int level) const
+{
+    if (level < 0 || level >= levelCount()) {
+        return 0;
+    }
+    return qint64(levelTable(m_data)[level].blocks);
+}
+
+const AudioPeaks::Peak *AudioPeaks::level(int level) const
+{
+    if (level < 0 || level >= levelCount()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const Peak *>(m_data + levelTable(m_data)[level].offset);
+}
+
+int AudioPeaks::levelForResolution(double samplesPerPixel) const
+{
+    int level = 0;
+    while (level + 1 < levelCount() && blockSize(level + 1) <= samplesPerPixel) {
+        level++;
+    }
+    return level;
+}
+
+QVector<uint8_t> AudioPeaks::frameLevels() const
+{
+    const FileHeader *h = header(m_data);
+    QVector<uint8_t> levels(int(h->frameLevelsCount));
+    memcpy(levels.data(), m_data + h->frameLevelsOffset, h->frameLevelsCount);
+    return levels;
+}
+
+int AudioPeaks::maxFrameLevel() const
+{
+    return int(header(m_data)->maxFrameLevel);
+}
+
+AudioPeaksBuilder::AudioPeaksBuilder(int channels, int frequency, qint64 startSample)
+    : m_channels(channels)
+    , m_frequency(frequency)
+    , m_startSample(startSample)
+    , m_blockFill(int(startSample % AudioPeaks::BaseBlockSize))
+    , m_blockMin(size_t(channels), 0)
+    , m_blockMax(size_t(channels), 0)
+    , m_blockSquares(size_t(channels), 0.)
+{
+}
+
+void AudioPeaksBuilder::addSamples(const int16_t *data, int samples, int dataChannels)
+{
+    if (data == nullptr || dataChannels <= 0) {
+        addSilence(samples);
+        return;
+    }
+    for (int i = 0; i < samples; i++, data += dataChannels) {
+        for (int c = 0; c < m_channels; c++) {
+            int value = c < dataChannels ? data[c] : 0;
+            if (m_blockSamples == 0) {
+                m_blockMin[size_t(c)] = value;
+                m_blockMax[size_t(c)] = value;
+            } else {
+                m_blockMin[size_t(c)] = std::min(m_blockMin[size_t(c)], value);
+                m_blockMax[size_t(c)] = std::max(m_blockMax[size_t(c)], value);
+            }
+            m_blockSquares[size_t(c)] += double(value) * value;
+        }
+        m_blockSamples++;
+        if (++m_blockFill == AudioPeaks::BaseBlockSize) {
+            flushBlock();
+        }
+    }
+    m_samples += samples;
+}
+
+void AudioPeaksBuilder::addSilence(int samples)
+{
+    const std::vector<int16_t> silence(size_t(m_channels), 0);
+    for (int i = 0; i < samples; i++) {
+        addSamples(silence.data(), 1, m_channels);
+    }
+}
+
+void AudioPeaksBuilder::flushBlock()
+{
+    if (m_blockSamples == 0) {
+        return;
+    }
+    for (size_t c = 0; c < size_t(m_channels); c++) {
+        double rms = std::sqrt(m_blockSquares[c] / m_blockSamples);
+        m_base.push_back({qint16(m_blockMin[c]), qint16(m_blockMax[c]), quint16(std::min(rms, 65535.))});
+        m_blockSquares[c] = 0.;
+    }
+    m_blockFill = 0;
+    m_blockSamples = 0;
+}
+
+void AudioPeaksBuilder::append(AudioPeaksBuilder &other)
+{
+    flushBlock();
+    other.flushBlock();
+    if (other.m_base.empty()) {
+        return;
+    }
+    Q_ASSERT(other.m_channels == m_channels && other.m_startSample == m_startSample + m_samples);
+    const size_t channels = size_t(m_channels);
+    size_t skip = 0;
+    const int offset = int(other.m_startSample % AudioPeaks::BaseBlockSize);
+    if (offset > 0 && !m_base.empty()) {
+        // The last block of this builder and the first one of the other are two parts of the same block, merge them
+        double weight1 = double(std::min(qint64(offset), m_samples));
+        double weight2 = double(std::min(qint64(AudioPeaks::BaseBlockSize - offset), other.m_samples));
+        for (size_t c = 0; c < channels; c++) {
+            AudioPeaks::Peak &p1 = m_base[m_base.size() - channels + c];
+            const AudioPeaks::Peak &p2 = other.m_base[c];
+            double rms = std::sqrt((double(p1.rms) * p1.rms * weight1 + double(p2.rms) * p2.rms * weight2) / (weight1 + weight2));
+            p1 = {std::min(p1.min, p2.min), std::max(p1.max, p2.max), quint16(std::min(rms, 65535.))};
+        }
+        skip = channels;
+    }
+    m_base.insert(m_base.end(), other.m_base.begin() + long(skip), other.m_base.end());
+    m_samples += other.m_samples;
+    other.m_base.clear();
+}
+
+bool AudioPeaksBuilder::write(const QString &path, const QVector<uint8_t> &frameLevels, int maxLevel)
+{
+    flushBlock();
+    // Build the reduced levels, each entry merging two entries of the previous level
+    std::vector<std::vector<AudioPeaks::Peak>> levels;
+    levels.push_back(std::move(m_base));
+    m_base.clear();
+    const size_t channels = size_t(m_channels);
+    while (levels.size() < size_t(AudioPeaks::MaxLevels) && levels.back().size() > channels) {
+        const std::vector<AudioPeaks::Peak> &previous = levels.back();
+        size_t previousBlocks = previous.size() / channels;
+        std::vector<AudioPeaks::Peak> reduced;
+        reduced.reserve(((previousBlocks + 1) / 2) * channels);
+        for (size_t b = 0; b < previousBlocks; b += 2) {
+            for (size_t c = 0; c < channels; c++) {
+                const AudioPeaks::Peak &p1 = previous[b * channels + c];
+                if (b + 1 == previousBlocks) {
+                    reduced.push_back(p1);
+                    continue;
+                }
+                const AudioPeaks::Peak &p2 = previous[(b + 1) * channels + c];
+                double rms = std::sqrt((double(p1.rms) * p1.rms + double(p2.rms) * p2.rms) / 2.);
+                reduced.push_back({std::min(p1.min, p2.min), std::max(p1.max, p2.max), quint16(std::min(rms, 65535.))});
+            }
+        }
+        levels.push_back(std::move(reduced));
+    }
+
+    FileHeader h;
+    memcpy(h.magic, peaksFileMagic, 4);
+    h.version = peaksFileVersion;
+    h.channels = quint32(m_channels);
+    h.frequency = quint32(m_frequency);
+    h.baseBlockSize = AudioPeaks::BaseBlockSize;
+    h.levels = quint32(levels.size());
+    h.maxFrameLevel = quint32(maxLevel);
+    h.frameLevelsCount = quint32(frameLevels.size());
+    h.samples = quint64(m_samples);
+    h.frameLevelsOffset = sizeof(FileHeader) + levels.size() * sizeof(LevelEntry);
+
+    std::vector<LevelEntry> table;
+    quint64 offset = h.frameLevelsOffset + h.frameLevelsCount;
+    for (const auto &l : levels) {
+        // Keep peak data aligned
+        offset += (alignof(AudioPeaks::Peak) - offset % alignof(AudioPeaks::Peak)) % alignof(AudioPeaks::Peak);
+        table.push_back({offset, quint64(l.size() / channels)});
+        offset += l.size() * sizeof(AudioPeaks::Peak);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(KDENLIVE_LOG) << "Cannot write audio peak file" << path;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&h), sizeof(FileHeader));
+    file.write(reinterpret_cast<const char *>(table.data()), qint64(table.size() * sizeof(LevelEntry)));
+    file.write(reinterpret_cast<const char *>(frameLevels.constData()), frameLevels.size());
+    for (size_t i = 0; i < levels.size(); i++) {
+        qint64 padding = qint64(table[i].offset) - file.pos();
+        if (padding > 0) {
+            file.write(QByteArray(int(padding), '\0'));
+        }
+        file.write(reinterpret_cast<const char *>(levels[i].data()), qint64(levels[i].size() * sizeof(AudioPeaks::Peak)));
+    }
+    return file.commit();
+}
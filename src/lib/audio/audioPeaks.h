@@ -0,0 +1,106 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+/**
+  Multi-resolution audio peak data used to draw waveforms.
+
+  Level 0 stores one min / max / rms triplet per channel for every
+  block of AudioPeaks::BaseBlockSize samples, each following level
+  halves the resolution of the previous one. The per frame levels
+  used by the timeline at normal zoom are stored alongside.
+
+  The data is written in a flat binary file (native endianness, it
+  only lives in the project cache folder) that is memory mapped when
+  loaded, so that only the pages of the level being drawn are read
+  from disk.
+  */
+class AudioPeaks
+{
+public:
+    /** @brief Number of samples summarized by one entry of level 0 */
+    static constexpr int BaseBlockSize = 256;
+    /** @brief Maximum number of levels stored in a peak file */
+    static constexpr int MaxLevels = 20;
+
+    struct Peak
+    {
+        qint16 min;
+        qint16 max;
+        quint16 rms;
+    };
+
+    /** @brief Memory maps the peak file @param path, returns nullptr if the file is missing or invalid. */
+    static std::shared_ptr<AudioPeaks> open(const QString &path);
+    ~AudioPeaks();
+
+    int channels() const;
+    int frequency() const;
+    qint64 samples() const;
+    int levelCount() const;
+    /** @brief The number of samples summarized by one entry of @param level */
+    int blockSize(int level) const;
+    /** @brief The number of entries (per channel) of @param level */
+    qint64 blockCount(int level) const;
+    /** @brief Interleaved peak data for @param level, blockCount(level) * channels() entries. */
+    const Peak *level(int level) const;
+    /** @brief Returns the coarsest level that still has at least one entry per @param samplesPerPixel */
+    int levelForResolution(double samplesPerPixel) const;
+    /** @brief Returns the per frame levels (one uint8 per channel and frame) */
+    QVector<uint8_t> frameLevels() const;
+    /** @brief Returns the maximum of the per frame levels */
+    int maxFrameLevel() const;
+
+private:
+    AudioPeaks() = default;
+    QFile m_file;
+    uchar *m_data{nullptr};
+    qint64 m_size{0};
+};
+
+/**
+  Incrementally builds the peak pyramid from interleaved s16 samples,
+  then writes it to disk in the format read by AudioPeaks.
+  Several builders started at consecutive positions of the same stream
+  can be joined with append(), which allows processing a stream in
+  parallel segments.
+  */
+class AudioPeaksBuilder
+{
+public:
+    /** @param startSample is the position of the first sample that will be added, in samples from the start of the stream */
+    AudioPeaksBuilder(int channels, int frequency, qint64 startSample = 0);
+    /** @brief Process @param samples interleaved samples (per channel), @param dataChannels is the channel count of @param data */
+    void addSamples(const int16_t *data, int samples, int dataChannels);
+    /** @brief Process @param samples of silence, used when a frame could not be decoded */
+    void addSilence(int samples);
+    /** @brief Append the data of the builder @param other, which must start where this one ends */
+    void append(AudioPeaksBuilder &other);
+    /** @brief Write the peak file, @param frameLevels are the per frame levels with their maximum @param maxLevel */
+    bool write(const QString &path, const QVector<uint8_t> &frameLevels, int maxLevel);
+
+private:
+    int m_channels;
+    int m_frequency;
+    qint64 m_startSample;
+    qint64 m_samples{0};
+    // Position in the current block, and number of samples actually added to it
+    int m_blockFill;
+    int m_blockSamples{0};
+    std::vector<int> m_blockMin;
+    std::vector<int> m_blockMax;
+    std::vector<double> m_blockSquares;
+    std::vector<AudioPeaks::Peak> m_base;
+    void flushBlock();
+};
@@ -5,6 +5,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "fftCorrelation.h"
 #include <QElapsedTimer>
+#include <QMutexLocker>
 extern "C" {
 #include "../external/kiss_fft/tools/kiss_fftr.h"
 }
@@ -29,44 +30,18 @@ void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const
 
 void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated)
 {
-    QElapsedTimer t;
-    t.start();
-
-    auto *leftF = new float[leftSize];
-    auto *rightF = new float[rightSize];
-
-    // First the qint64 values need to be normalized to floats
-    // Dividing by the max value is maybe not the best solution, but the
-    // maximum value after correlation should not be larger than the longest
-    // vector since each value should be at most 1
-    qint64 maxLeft = 1;
-    qint64 maxRight = 1;
-    for (size_t i = 0; i < leftSize; ++i) {
-        if (qAbs(left[i]) > maxLeft) {
-            maxLeft = qAbs(left[i]);
-        }
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        if (qAbs(right[i]) > maxRight) {
-            maxRight = qAbs(right[i]);
-        }
-    }
+    FFTReference(left, leftSize).correlate(right, rightSize, out_correlated);
+}
 
-    // One side needs to be reversed, since multiplication in frequency domain (fourier space)
-    // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
-    for (size_t i = 0; i < leftSize; ++i) {
-        leftF[i] = float(left[i]) / maxLeft;
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        rightF[rightSize - 1 - i] = float(right[i]) / maxRight;
+size_t FFTCorrelation::transformSize(size_t largestSize)
+{
+    // The vectors must have the same size (same frequency resolution!) and should
+    // be a power of 2 (for FFT).
+    size_t size = 64;
+    while (size / 2 < largestSize) {
+        size = size << 1;
     }
-
-    // Now we can convolve to get the correlation
-    convolve(leftF, leftSize, rightF, rightSize, out_correlated);
-
-    qCDebug(KDENLIVE_LOG) << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
-    delete[] leftF;
-    delete[] rightF;
+    return size;
 }
 
 void FFTCorrelation::convolve(const float *left, const size_t leftSize, const float *right, const size_t rightSize, float *out_convolved)
@@ -77,14 +52,7 @@ void FFTCorrelation::convolve(const float *left, const size_t leftSize, const fl
     // To avoid issues with repetition (we are dealing with cosine waves
     // in the fourier domain) we need to pad the vectors to at least twice their size,
     // otherwise convolution would convolve with the repeated pattern as well
-    size_t largestSize = std::max(leftSize, rightSize);
-
-    // The vectors must have the same size (same frequency resolution!) and should
-    // be a power of 2 (for FFT).
-    size_t size = 64;
-    while (size / 2 < largestSize) {
-        size = size << 1;
-    }
+    size_t size = transformSize(std::max(leftSize, rightSize));
 
     const size_t fft_size = size / 2 + 1;
     kiss_fftr_cfg fftConfig = kiss_fftr_alloc(int(size), 0, nullptr, nullptr);
@@ -126,3 +94,113 @@ void FFTCorrelation::convolve(const float *left, const size_t leftSize, const fl
 
     qCDebug(KDENLIVE_LOG) << "FFT convolution computed. Time taken: " << time.elapsed() << " ms";
 }
+
+FFTReference::FFTReference(const qint64 *data, size_t size)
+    : m_data(size)
+{
+    // First the qint64 values need to be normalized to floats
+    // Dividing by the max value is maybe not the best solution, but the
+    // maximum value after correlation should not be larger than the longest
+    // vector since each value should be at most 1
+    qint64 maxValue = 1;
+    for (size_t i = 0; i < size; ++i) {
+        maxValue = std::max(maxValue, qAbs(data[i]));
+    }
+    for (size_t i = 0; i < size; ++i) {
+        m_data[i] = float(data[i]) / maxValue;
+    }
+}
+
+size_t FFTReference::size() const
+{
+    return m_data.size();
+}
+
+std::shared_ptr<const std::vector<std::complex<float>>> FFTReference::spectrum(size_t size) const
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_spectrums.find(size);
+    if (it != m_spectrums.end()) {
+        return it->second;
+    }
+    const size_t fft_size = size / 2 + 1;
+    std::vector<float> data(size, 0);
+    std::copy(m_data.begin(), m_data.end(), data.begin());
+    std::vector<kiss_fft_cpx> transformed(fft_size);
+    kiss_fftr_cfg fftConfig = kiss_fftr_alloc(int(size), 0, nullptr, nullptr);
+    kiss_fftr(fftConfig, &data[0], &transformed[0]);
+    kiss_fftr_free(fftConfig);
+
+    auto result = std::make_shared<std::vector<std::complex<float>>>(fft_size);
+    for (size_t i = 0; i < fft_size; ++i) {
+        (*result)[i] = std::complex<float>(transformed[i].r, transformed[i].i);
+    }
+    m_spectrums[size] = result;
+    return result;
+}
+
+void FFTReference::correlate(const qint64 *right, const size_t rightSize, qint64 *out_correlated) const
+{
+    std::vector<float> correlatedFloat(m_data.size() + rightSize + 1);
+    correlate(right, rightSize, correlatedFloat.data());
+
+    // The correlation vector will have entries up to N (number of entries
+    // of the vector), so converting to integers will not lose that much
+    // of precision.
+    for (size_t i = 0; i < correlatedFloat.size(); ++i) {
+        out_correlated[i] = qint64(correlatedFloat[i]);
+    }
+}
+
+void FFTReference::correlate(const qint64 *right, const size_t rightSize, float *out_correlated) const
+{
+    QElapsedTimer time;
+    time.start();
+
+    // To avoid issues with repetition (we are dealing with cosine waves
+    // in the fourier domain) we need to pad the vectors to at least twice their size,
+    // otherwise convolution would convolve with the repeated pattern as well
+    const size_t size = FFTCorrelation::transformSize(std::max(m_data.size(), rightSize));
+    const size_t fft_size = size / 2 + 1;
+    std::shared_ptr<const std::vector<std::complex<float>>> leftFFT = spectrum(size);
+
+    qint64 maxRight = 1;
+    for (size_t i = 0; i < rightSize; ++i) {
+        maxRight = std::max(maxRight, qAbs(right[i]));
+    }
+    // One side needs to be reversed, since multiplication in frequency domain (fourier space)
+    // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
+    std::vector<float> rightData(size, 0);
+    for (size_t i = 0; i < rightSize; ++i) {
+        rightData[rightSize - 1 - i] = float(right[i]) / maxRight;
+    }
+
+    // The configurations hold a work buffer, they cannot be shared between threads
+    kiss_fftr_cfg fftConfig = kiss_fftr_alloc(int(size), 0, nullptr, nullptr);
+    kiss_fftr_cfg ifftConfig = kiss_fftr_alloc(int(size), 1, nullptr, nullptr);
+    std::vector<kiss_fft_cpx> rightFFT(fft_size);
+    std::vector<kiss_fft_cpx> correlatedFFT(fft_size);
+    std::vector<float> convolved(size);
+
+    kiss_fftr(fftConfig, &rightData[0], &rightFFT[0]);
+
+    // Convolution in spacial domain is a multiplication in fourier domain. O(n).
+    for (size_t i = 0; i < fft_size; ++i) {
+        const std::complex<float> product = leftFFT->at(i) * std::complex<float>(rightFFT[i].r, rightFFT[i].i);
+        correlatedFFT[i].r = product.real();
+        correlatedFFT[i].i = product.imag();
+    }
+
+    // Insert one element at the beginning to obtain the same result
+    // that we also get with the nested for loop correlation.
+    *out_correlated = 0;
+    size_t out_size = m_data.size() + rightSize + 1;
+
+    kiss_fftri(ifftConfig, &correlatedFFT[0], &convolved[0]);
+    std::copy(convolved.begin(), convolved.begin() + int(out_size) - 1, out_correlated + 1);
+
+    kiss_fftr_free(fftConfig);
+    kiss_fftr_free(ifftConfig);
+
+    qCDebug(KDENLIVE_LOG) << "Correlation (FFT based) computed in " << time.elapsed() << " ms.";
+}
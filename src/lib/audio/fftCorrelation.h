@@ -5,7 +5,13 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #pragma once
 
+#include <QMutex>
 #include <QtGlobal>
+#include <complex>
+#include <map>
+#include <memory>
+#include <vector>
+
 /** @class FFTCorrelation
     @brief This class provides methods to calculate convolution
     and correlation of two vectors by means of FFT, which
@@ -30,4 +36,39 @@ public:
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated);
 
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, qint64 *out_correlated);
+
+    /**
+      Returns the size of the transform used to convolve vectors of at most
+      \c largestSize entries.
+      */
+    static size_t transformSize(size_t largestSize);
+};
+
+/** @class FFTReference
+    @brief The Fourier transform of a reference vector.
+    Correlating many vectors with the same reference this way only
+    transforms the reference once for each transform size.
+  */
+class FFTReference
+{
+public:
+    FFTReference(const qint64 *data, size_t size);
+
+    size_t size() const;
+
+    /**
+      Same as FFTCorrelation::correlate with the reference as \c left.
+      Can be called from several threads at once.
+      */
+    void correlate(const qint64 *right, const size_t rightSize, float *out_correlated) const;
+    void correlate(const qint64 *right, const size_t rightSize, qint64 *out_correlated) const;
+
+private:
+    /// The reference normalized to [-1, 1]
+    std::vector<float> m_data;
+    mutable QMutex m_mutex;
+    /// Transform of the reference for each transform size
+    mutable std::map<size_t, std::shared_ptr<const std::vector<std::complex<float>>>> m_spectrums;
+
+    std::shared_ptr<const std::vector<std::complex<float>>> spectrum(size_t size) const;
 };
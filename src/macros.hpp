@@ -5,6 +5,9 @@
 
 #pragma once
 
+#include "undohelper.hpp"
+#include <QReadWriteLock>
+
 /** This file contains a collection of macros that can be used in model related classes.
     The class only needs to have the following members:
     - For Push_undo : std::weak_ptr<DocUndoStack> m_undoStack;  this is a pointer to the undoStack
@@ -28,20 +31,33 @@
         return res_lambda;                                                                                                                                     \
     };
 
-/** This convenience macro locks the mutex for reading.
-Note that it might happen that a thread is executing a write operation that requires
-reading a Read-protected property. In that case, we try to write lock it first (this will be granted since the lock is recursive)
+/** @brief Scoped lock used by READ_LOCK, holding a recursive QReadWriteLock for reading without any allocation.
+It is not possible to lock for reading a lock that the current thread has locked for writing, so when the lock
+cannot be acquired for reading right away, we try to lock it for writing: this is granted if the current thread
+is the writer since the lock is recursive. Otherwise, another thread is writing and we wait for it.
+Readers that are not contended never take the write lock and don't block each other.
 */
-#define READ_LOCK()                                                                                                                                            \
-    std::unique_ptr<QReadLocker> rlocker(new QReadLocker(nullptr));                                                                                            \
-    std::unique_ptr<QWriteLocker> wlocker(new QWriteLocker(nullptr));                                                                                          \
-    if (m_lock.tryLockForWrite()) {                                                                                                                            \
-        /*we yield ownership of the lock to the WriteLocker*/                                                                                                  \
-        m_lock.unlock();                                                                                                                                       \
-        wlocker.reset(new QWriteLocker(&m_lock));                                                                                                              \
-    } else {                                                                                                                                                   \
-        rlocker.reset(new QReadLocker(&m_lock));                                                                                                               \
+class ModelReadLocker
+{
+public:
+    explicit ModelReadLocker(QReadWriteLock &lock)
+        : m_lock(lock)
+    {
+        if (!m_lock.tryLockForRead() && !m_lock.tryLockForWrite()) {
+            m_lock.lockForRead();
+        }
     }
+    ~ModelReadLocker() { m_lock.unlock(); }
+    ModelReadLocker(const ModelReadLocker &) = delete;
+    ModelReadLocker &operator=(const ModelReadLocker &) = delete;
+
+private:
+    QReadWriteLock &m_lock;
+};
+
+/** This convenience macro locks the mutex for reading, see ModelReadLocker.
+*/
+#define READ_LOCK() ModelReadLocker rlocker(m_lock);
 
 /** @brief This macro takes some lambdas that represent undo/redo for an operation and the text (name) associated with this operation
  * The lambdas are transformed to make sure they lock access to the class they operate on.
@@ -58,16 +74,11 @@ reading a Read-protected property. In that case, we try to write lock it first (
 /** @brief This macro takes as parameter one atomic operation and its reverse, and update
  * the undo and redo functional stacks/queue accordingly
  * This should be used in the rare case where we don't need a lock mutex. In general, prefer the other version
+ * The operations are added to the journals of undo and redo (see UndoJournal) instead of being wrapped in new closures
  */
 #define UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo)                                                                                                \
-    undo = [reverse, undo]() {                                                                                                                                 \
-        bool v = reverse();                                                                                                                                    \
-        return undo() && v;                                                                                                                                    \
-    };                                                                                                                                                         \
-    redo = [operation, redo]() {                                                                                                                               \
-        bool v = redo();                                                                                                                                       \
-        return operation() && v;                                                                                                                               \
-    };
+    UndoJournal::prepend(undo, reverse);                                                                                                                       \
+    UndoJournal::append(redo, operation);
 /** @brief This macro takes as parameter one atomic operation and its reverse, and update
  *  the undo and redo functional stacks/queue accordingly
  *  It will also ensure that operation and reverse are dealing with mutexes
@@ -58,6 +58,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "project/dialogs/temporarydata.h"
 #include "project/projectmanager.h"
 #include "scopes/scopemanager.h"
+#include "timeline2/view/qmltypes/thumbnailprovider.h"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinetabs.hpp"
 #include "timeline2/view/timelinewidget.h"
@@ -980,6 +981,7 @@ MainWindow::~MainWindow()
     delete m_loadingDialog;
     pCore->finishShutdown();
     qDeleteAll(m_transitions);
+    ThumbnailProducerPool::get()->clear();
     Mlt::Factory::close();
 }
 
@@ -389,6 +389,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     }
     m_playMenu->addAction(m_playAction);
     connect(m_playAction, &QAction::triggered, this, &Monitor::slotSwitchPlay);
+    connect(m_playAction, &KDualAction::activeChanged, this, [this](bool active) { pCore->taskManager.setPlaybackActive(int(m_id), active); });
 
     playButton->setMenu(m_playMenu);
     playButton->setPopupMode(QToolButton::MenuButtonPopup);
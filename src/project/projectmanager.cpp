@@ -22,6 +22,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "project/dialogs/noteswidget.h"
 #include "project/dialogs/projectsettings.h"
 #include "timeline2/model/timelinefunctions.hpp"
+#include "timeline2/view/qmltypes/thumbnailprovider.h"
 #include "utils/qstringutils.h"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
@@ -487,6 +488,8 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
             }
         }
     }
+    // Pooled thumbnail producers belong to the clips of the closed project
+    ThumbnailProducerPool::get()->clear();
     // Ensure we don't have stuck references to timelinemodel
     // qDebug() << "TIMELINEMODEL COUNTS: " << m_activeTimelineModel.use_count();
     // Q_ASSERT(m_activeTimelineModel.use_count() <= 1);
@@ -0,0 +1,214 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "renderqueue.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+// Increase when the layout of the queue file changes
+constexpr int queueVersion = 1;
+// Memory used by a melt process besides the frames, in MB
+constexpr int baseMemory = 256;
+// Frames held by the consumer buffer and the encoder lookahead
+constexpr int bufferedFrames = 65;
+// Threads used by an encoder left to choose its thread count, FFmpeg encoders rarely scale beyond this
+constexpr int maxEncoderThreads = 16;
+} // namespace
+
+RenderQueue::RenderQueue(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+// static
+QString RenderQueue::defaultFileName()
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    dir.mkpath(QStringLiteral("."));
+    return dir.absoluteFilePath(QStringLiteral("renderqueue.json"));
+}
+
+// static
+RenderQueue::Job RenderQueue::createJob(const QString &output, const QStringList &args, int cores)
+{
+    Job job;
+    job.output = output;
+    job.args = args;
+    if (cores <= 0) {
+        cores = QThread::idealThreadCount();
+    }
+    int segments = 1;
+    for (const QString &arg : args) {
+        if (arg.startsWith(QLatin1String("--segments="))) {
+            segments = qMax(1, arg.section(QLatin1Char('='), 1).toInt());
+        }
+    }
+    // args are: delivery, melt path, playlist, options…
+    QFile file(args.size() > 2 ? args.at(2) : QString());
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        // Unknown needs, let the job run alone
+        job.threads = cores;
+        return job;
+    }
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    QDomElement profile = doc.documentElement().firstChildElement(QStringLiteral("profile"));
+    const int processingThreads = qMax(1, qAbs(consumer.attribute(QStringLiteral("real_time"), QStringLiteral("1")).toInt()));
+    int encodingThreads = consumer.attribute(QStringLiteral("threads")).toInt();
+    if (encodingThreads <= 0) {
+        // FFmpeg would choose the thread count from the processor cores, pass the estimate so that the job uses what it claims
+        encodingThreads = qMin(cores, maxEncoderThreads);
+        job.args << QStringLiteral("--threads=%1").arg(encodingThreads);
+    }
+    job.threads = qBound(1, qMax(processingThreads, encodingThreads) * segments, cores);
+    const qint64 frameBytes = qint64(profile.attribute(QStringLiteral("width")).toInt()) * profile.attribute(QStringLiteral("height")).toInt() * 4;
+    job.memory = int((baseMemory + frameBytes * (bufferedFrames + processingThreads) / 1048576) * segments);
+    return job;
+}
+
+bool RenderQueue::append(const Job &job)
+{
+    for (const Job &existing : m_jobs) {
+        if (existing.output == job.output && (existing.status == Waiting || existing.status == Running)) {
+            return false;
+        }
+    }
+    remove(job.output);
+    m_jobs.push_back(job);
+    return true;
+}
+
+void RenderQueue::remove(const QString &output)
+{
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [&output](const Job &job) { return job.output == output; }), m_jobs.end());
+}
+
+void RenderQueue::setStatus(const QString &output, Status status)
+{
+    for (Job &job : m_jobs) {
+        if (job.output == output) {
+            job.status = status;
+            return;
+        }
+    }
+}
+
+void RenderQueue::removeCompleted()
+{
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [](const Job &job) { return job.status != Waiting && job.status != Running; }),
+                 m_jobs.end());
+}
+
+const std::vector<RenderQueue::Job> &RenderQueue::jobs() const
+{
+    return m_jobs;
+}
+
+int RenderQueue::count(Status status) const
+{
+    return int(std::count_if(m_jobs.cbegin(), m_jobs.cend(), [status](const Job &job) { return job.status == status; }));
+}
+
+QStringList RenderQueue::admissible(const Limits &limits) const
+{
+    QStringList result;
+    QStringList busyOutputs;
+    int running = 0;
+    int threads = 0;
+    int memory = 0;
+    for (const Job &job : m_jobs) {
+        if (job.status == Running) {
+            running++;
+            threads += job.threads;
+            memory += job.memory;
+            busyOutputs << job.output;
+        }
+    }
+    for (const Job &job : m_jobs) {
+        if (job.status != Waiting || busyOutputs.contains(job.output)) {
+            continue;
+        }
+        if (limits.jobs > 0 && running >= limits.jobs) {
+            break;
+        }
+        if (running > 0 && (threads + job.threads > limits.threads || (limits.memory >= 0 && memory + job.memory > limits.memory))) {
+            // Keep the queue order, a large job is not overtaken by the smaller ones behind it
+            break;
+        }
+        result << job.output;
+        busyOutputs << job.output;
+        running++;
+        threads += job.threads;
+        memory += job.memory;
+    }
+    return result;
+}
+
+bool RenderQueue::load()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value(QStringLiteral("version")).toInt() != queueVersion) {
+        qDebug() << "// Ignoring render queue with unknown version" << m_fileName;
+        return false;
+    }
+    m_jobs.clear();
+    const QJsonArray jobs = root.value(QStringLiteral("jobs")).toArray();
+    for (const QJsonValue &value : jobs) {
+        const QJsonObject object = value.toObject();
+        Job job;
+        job.output = object.value(QStringLiteral("output")).toString();
+        for (const QJsonValue &arg : object.value(QStringLiteral("args")).toArray()) {
+            job.args << arg.toString();
+        }
+        job.status = Status(qBound(int(Waiting), object.value(QStringLiteral("status")).toInt(), int(Aborted)));
+        job.threads = qMax(1, object.value(QStringLiteral("threads")).toInt());
+        job.memory = qMax(0, object.value(QStringLiteral("memory")).toInt());
+        if (!job.output.isEmpty() && !job.args.isEmpty()) {
+            m_jobs.push_back(job);
+        }
+    }
+    return true;
+}
+
+bool RenderQueue::save() const
+{
+    QJsonArray jobs;
+    for (const Job &job : m_jobs) {
+        QJsonObject object;
+        object.insert(QStringLiteral("output"), job.output);
+        object.insert(QStringLiteral("args"), QJsonArray::fromStringList(job.args));
+        object.insert(QStringLiteral("status"), int(job.status));
+        object.insert(QStringLiteral("threads"), job.threads);
+        object.insert(QStringLiteral("memory"), job.memory);
+        jobs.append(object);
+    }
+    QJsonObject root;
+    root.insert(QStringLiteral("version"), queueVersion);
+    root.insert(QStringLiteral("jobs"), jobs);
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "// Cannot write render queue" << m_fileName;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+/** @class RenderQueue
+    @brief The render jobs waiting or running, and the policy deciding which jobs can run at the same time.
+    A job is admitted when the processor threads and the memory it needs, added to those of the running
+    jobs, fit in the limits. The first waiting job always starts when nothing is running, so a job larger
+    than the limits still renders, and a job waits as long as another job writing the same file runs.
+    The queue is saved as JSON so that it survives a restart and can be rendered by kdenlive_render without the GUI.
+    This class only depends on QtCore and QtXml, it is shared by Kdenlive and kdenlive_render.
+ */
+class RenderQueue
+{
+public:
+    enum Status { Waiting = 0, Running, Finished, Failed, Aborted };
+    struct Job
+    {
+        /** @brief The rendered file, identifies the job */
+        QString output;
+        /** @brief The arguments of kdenlive_render */
+        QStringList args;
+        Status status{Waiting};
+        /** @brief Processor threads used by the job */
+        int threads{1};
+        /** @brief Estimated memory used by the job, in MB */
+        int memory{0};
+    };
+    struct Limits
+    {
+        /** @brief Maximum number of running jobs, 0 for no limit */
+        int jobs{0};
+        /** @brief Processor threads shared by the running jobs */
+        int threads{1};
+        /** @brief Memory available to the jobs in MB, negative if unknown */
+        int memory{-1};
+    };
+
+    explicit RenderQueue(const QString &fileName = QString());
+    /** @brief The file where Kdenlive saves its queue */
+    static QString defaultFileName();
+    /** @brief Creates a job for kdenlive_render @param args, with the resources estimated from the playlist it renders.
+        If the playlist leaves the encoder thread count to FFmpeg, the estimated count is added to the arguments.
+        @param cores the processor cores of the machine, 0 to detect them */
+    static Job createJob(const QString &output, const QStringList &args, int cores = 0);
+
+    /** @brief Adds a waiting job, returns false if a job already writes the same file */
+    bool append(const Job &job);
+    void remove(const QString &output);
+    void setStatus(const QString &output, Status status);
+    /** @brief Removes the jobs that are not waiting or running */
+    void removeCompleted();
+    const std::vector<Job> &jobs() const;
+    int count(Status status) const;
+    /** @brief Returns the outputs of the waiting jobs that can start now within @param limits, in queue order */
+    QStringList admissible(const Limits &limits) const;
+
+    /** @brief Reads the queue from its file, returns false if the file cannot be read */
+    bool load();
+    /** @brief Writes the queue to its file */
+    bool save() const;
+
+private:
+    QString m_fileName;
+    std::vector<Job> m_jobs;
+};
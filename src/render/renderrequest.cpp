@@ -32,6 +32,9 @@ QStringList RenderRequest::argsByJob(const RenderJob &job)
     if (!job.subtitlePath.isEmpty()) {
         args << QStringLiteral("--subtitle") << job.subtitlePath;
     }
+    if (KdenliveSettings::rendersegments() > 1) {
+        args << QStringLiteral("--segments=%1").arg(KdenliveSettings::rendersegments());
+    }
     return args;
 }
 
@@ -0,0 +1,129 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "rendersegments.h"
+
+#include <QDomDocument>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <cmath>
+#include <iterator>
+
+constexpr int RenderSegments::minFrames;
+
+// static
+int RenderSegments::timeToFrames(const QString &time, double fps)
+{
+    if (!time.contains(QLatin1Char(':'))) {
+        return time.toInt();
+    }
+    const QStringList parts = time.split(QRegularExpression(QStringLiteral("[:;]")));
+    if (parts.count() == 4) {
+        // SMPTE timecode, hh:mm:ss:ff
+        return ((parts.at(0).toInt() * 60 + parts.at(1).toInt()) * 60 + parts.at(2).toInt()) * qRound(fps) + parts.at(3).toInt();
+    }
+    double seconds = 0.;
+    for (const QString &part : parts) {
+        seconds = seconds * 60. + part.toDouble();
+    }
+    return int(std::lround(seconds * fps));
+}
+
+// static
+double RenderSegments::frameRate(const QDomDocument &doc)
+{
+    const QDomElement profile = doc.documentElement().firstChildElement(QStringLiteral("profile"));
+    if (!profile.isNull() && profile.attribute(QStringLiteral("frame_rate_den")).toInt() > 0) {
+        return profile.attribute(QStringLiteral("frame_rate_num")).toDouble() / profile.attribute(QStringLiteral("frame_rate_den")).toDouble();
+    }
+    return 25.;
+}
+
+// static
+std::set<int> RenderSegments::cutPoints(const QDomDocument &doc)
+{
+    std::set<int> cuts;
+    const QDomElement mlt = doc.documentElement();
+    const double fps = frameRate(doc);
+    // MLT renders the last service of the document
+    QHash<QString, QDomElement> services;
+    QString root;
+    const QStringList serviceTags = {QStringLiteral("producer"), QStringLiteral("chain"), QStringLiteral("playlist"), QStringLiteral("tractor")};
+    for (QDomElement child = mlt.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        if (serviceTags.contains(child.tagName())) {
+            root = child.attribute(QStringLiteral("id"));
+            services.insert(root, child);
+        }
+    }
+    // Follow the tracks of the rendered tractor, nested tractors being the tracks of a sequence
+    QStringList pending = {root};
+    QSet<QString> visited;
+    while (!pending.isEmpty()) {
+        const QString id = pending.takeLast();
+        if (visited.contains(id)) {
+            continue;
+        }
+        visited.insert(id);
+        const QDomElement service = services.value(id);
+        if (service.tagName() == QLatin1String("tractor")) {
+            QDomElement tracks = service.firstChildElement(QStringLiteral("multitrack"));
+            if (tracks.isNull()) {
+                tracks = service;
+            }
+            for (QDomElement track = tracks.firstChildElement(QStringLiteral("track")); !track.isNull();
+                 track = track.nextSiblingElement(QStringLiteral("track"))) {
+                pending << track.attribute(QStringLiteral("producer"));
+            }
+            continue;
+        }
+        if (service.tagName() != QLatin1String("playlist")) {
+            continue;
+        }
+        int position = 0;
+        for (QDomElement child = service.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+            if (child.tagName() == QLatin1String("entry")) {
+                position += timeToFrames(child.attribute(QStringLiteral("out")), fps) - timeToFrames(child.attribute(QStringLiteral("in")), fps) + 1;
+            } else if (child.tagName() == QLatin1String("blank")) {
+                position += timeToFrames(child.attribute(QStringLiteral("length")), fps);
+            } else {
+                continue;
+            }
+            cuts.insert(position);
+        }
+    }
+    return cuts;
+}
+
+// static
+QList<int> RenderSegments::split(int in, int out, int count, const std::set<int> &cuts)
+{
+    QList<int> starts = {in};
+    const int length = out - in + 1;
+    count = qMin(count, length / minFrames);
+    if (count < 2) {
+        return starts;
+    }
+    const int tolerance = length / count / 4;
+    for (int i = 1; i < count; ++i) {
+        int boundary = in + int(qint64(length) * i / count);
+        auto next = cuts.lower_bound(boundary);
+        int best = -1;
+        if (next != cuts.end() && *next - boundary <= tolerance) {
+            best = *next;
+        }
+        if (next != cuts.begin() && boundary - *std::prev(next) <= tolerance && (best < 0 || boundary - *std::prev(next) < best - boundary)) {
+            best = *std::prev(next);
+        }
+        if (best > starts.last()) {
+            boundary = best;
+        }
+        starts << boundary;
+    }
+    return starts;
+}
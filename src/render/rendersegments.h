@@ -0,0 +1,39 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <set>
+
+class QDomDocument;
+
+/** @class RenderSegments
+    @brief Splits the range of a render into parts encoded by separate processes and joined afterwards.
+    The parts start at clip or blank boundaries of the rendered timeline when one is close enough,
+    since a new group of pictures costs the least bitrate there.
+    This class only depends on QtCore and QtXml, it is shared by Kdenlive and kdenlive_render.
+ */
+class RenderSegments
+{
+public:
+    /** @brief Parts shorter than this are not worth a separate process */
+    static constexpr int minFrames = 250;
+
+    /** @brief Converts an MLT time property (frames, clock or timecode) to frames */
+    static int timeToFrames(const QString &time, double fps);
+    /** @brief Returns the frame rate of the profile of the MLT document @param doc */
+    static double frameRate(const QDomDocument &doc);
+    /** @brief Returns the positions of the clip and blank boundaries on the tracks of the tractor rendered by @param doc.
+        Playlists that are not tracks of this tractor, like the bin or other sequences, are ignored */
+    static std::set<int> cutPoints(const QDomDocument &doc);
+    /** @brief Returns the first frame of each part when [@param in, @param out] is split in @param count parts.
+        Each boundary is moved to the closest of @param cuts if this keeps the parts balanced. Less parts are returned
+        if the range is too short, a single part means that the range should not be split */
+    static QList<int> split(int in, int out, int count, const std::set<int> &cuts);
+};
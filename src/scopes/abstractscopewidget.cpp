@@ -177,6 +177,7 @@ void AbstractScopeWidget::prodScopeThread()
             m_newScopeUpdates.fetchAndStoreRelaxed(0);
 
             Q_ASSERT(m_accelFactorScope > 0);
+            prepareScope();
 
             // See https://doc.qt.io/qt-5/qtconcurrentrun.html about
             // running member functions in a thread
@@ -534,6 +535,11 @@ bool AbstractScopeWidget::autoRefreshEnabled() const
     return m_aAutoRefresh->isChecked();
 }
 
+bool AbstractScopeWidget::isScopeIdle() const
+{
+    return m_semaphoreScope.available() > 0;
+}
+
 void AbstractScopeWidget::slotAutoRefreshToggled(bool autoRefresh)
 {
 #ifdef DEBUG_ASW
@@ -552,6 +558,7 @@ void AbstractScopeWidget::slotAutoRefreshToggled(bool autoRefresh)
 }
 
 void AbstractScopeWidget::handleMouseDrag(const QPoint &, const RescaleDirection, const Qt::KeyboardModifiers) {}
+void AbstractScopeWidget::prepareScope() {}
 
 #ifdef DEBUG_ASW
 #undef DEBUG_ASW
@@ -76,6 +76,9 @@ public:
     /** Tell whether this scope has auto-refresh enabled. Required for determining whether
         new data (e.g. an image frame) has to be delivered to this widget. */
     bool autoRefreshEnabled() const;
+    /** Tell whether the scope layer is not being calculated, in which case
+        the calculation will start with the next data delivered to this widget. */
+    bool isScopeIdle() const;
 
     bool needsSingleFrame();
 
@@ -193,6 +196,9 @@ protected:
         As soon as the direction is determined it will execute this method. Can be used e.g. for re-scaling content.
         This is just a dummy function, re-implement to add functionality. */
     virtual void handleMouseDrag(const QPoint &movement, const RescaleDirection rescaleDirection, const Qt::KeyboardModifiers rescaleModifiers);
+    /** Called on the GUI thread right before renderScope() is started in another thread.
+        Re-implement to copy the widget settings the scope layer depends on. */
+    virtual void prepareScope();
 
     ///// Reimplemented /////
 
@@ -7,7 +7,9 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "abstractgfxscopewidget.h"
 #include "monitor/monitormanager.h"
+#include "scopeframe.h"
 
+#include <QElapsedTimer>
 #include <QMouseEvent>
 
 // Uncomment for debugging.
@@ -25,8 +27,29 @@ AbstractGfxScopeWidget::~AbstractGfxScopeWidget() = default;
 
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
-    QMutexLocker lock(&m_mutex);
-    return renderGfxScope(accelerationFactor, m_scopeImage);
+    QElapsedTimer timer;
+    timer.start();
+    m_mutex.lock();
+    std::shared_ptr<ScopeFrame> frame = m_frame;
+    const ScopeKernels::ScopeOptions options = m_options;
+    m_mutex.unlock();
+    QImage scope;
+    if (frame) {
+        std::shared_ptr<ScopeKernels::Accumulator> bins = frame->analyse(this, options, accelerationFactor);
+        if (bins) {
+            scope = renderGfxScope(*bins, options);
+        }
+    }
+    Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelerationFactor);
+    return scope;
+}
+
+void AbstractGfxScopeWidget::prepareScope()
+{
+    const ScopeKernels::ScopeOptions options = scopeOptions();
+    m_mutex.lock();
+    m_options = options;
+    m_mutex.unlock();
 }
 
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -37,10 +60,11 @@ void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 
 ///// Slots /////
 
-void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const std::shared_ptr<ScopeFrame> &frame)
 {
-    QMutexLocker lock(&m_mutex);
-    m_scopeImage = frame;
+    m_mutex.lock();
+    m_frame = frame;
+    m_mutex.unlock();
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
@@ -9,8 +9,12 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <QString>
 #include <QWidget>
+#include <memory>
 
 #include "../abstractscopewidget.h"
+#include "scopekernels.h"
+
+class ScopeFrame;
 
 /**
 * @brief Abstract class for scopes analyzing image frames.
@@ -26,24 +30,33 @@ public:
 protected:
     ///// Variables /////
 
-    /** @brief Scope renderer. Must emit signalScopeRenderingFinished()
-     *  when calculation has finished, to allow multi-threading.
-     *  accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible. */
-    virtual QImage renderGfxScope(uint accelerationFactor, const QImage &) = 0;
+    /** @brief Returns the current settings of the scope. Called on the GUI thread, when a frame is queued for the scope. */
+    virtual ScopeKernels::ScopeOptions scopeOptions() = 0;
+    /** @brief Creates the bins of the scope for @p options, they are filled by the frame in a pass shared with the other scopes.
+     *  accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible.
+     *  Can be called from any thread, so it must only depend on its arguments. Returns nullptr if the scope cannot be rendered. */
+    virtual std::shared_ptr<ScopeKernels::Accumulator> createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const = 0;
+    /** @brief Scope renderer, draws the scope with @p options from the @p bins created by createAccumulator() and filled with the current frame.
+     *  Called from the rendering thread, so it must not read the widgets. */
+    virtual QImage renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options) = 0;
 
     QImage renderScope(uint accelerationFactor) override;
+    void prepareScope() override;
 
     void mouseReleaseEvent(QMouseEvent *) override;
 
 private:
-    QImage m_scopeImage;
+    friend class ScopeFrame;
+    std::shared_ptr<ScopeFrame> m_frame;
+    /** @brief The settings used by the running scope calculation */
+    ScopeKernels::ScopeOptions m_options;
     QMutex m_mutex;
 
 public Q_SLOTS:
     /** @brief Must be called when the active monitor has shown a new frame.
      * This slot must be connected in the implementing class, it is *not*
      * done in this abstract class. */
-    void slotRenderZoneUpdated(const QImage &);
+    void slotRenderZoneUpdated(const std::shared_ptr<ScopeFrame> &frame);
 
 protected Q_SLOTS:
     virtual void slotAutoRefreshToggled(bool autoRefresh);
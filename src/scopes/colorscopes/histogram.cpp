@@ -128,22 +128,33 @@ QImage Histogram::renderHUD(uint)
     Q_EMIT signalHUDRenderingFinished(0, 1);
     return QImage();
 }
-QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+int Histogram::componentFlags() const
 {
-    QElapsedTimer timer;
-    timer.start();
-    const int componentFlags =
-        (m_ui->cbY->isChecked() ? 1 : 0) * HistogramGenerator::ComponentY | (m_ui->cbS->isChecked() ? 1 : 0) * HistogramGenerator::ComponentSum |
-        (m_ui->cbR->isChecked() ? 1 : 0) * HistogramGenerator::ComponentR | (m_ui->cbG->isChecked() ? 1 : 0) * HistogramGenerator::ComponentG |
-        (m_ui->cbB->isChecked() ? 1 : 0) * HistogramGenerator::ComponentB;
+    return (m_ui->cbY->isChecked() ? 1 : 0) * HistogramGenerator::ComponentY | (m_ui->cbS->isChecked() ? 1 : 0) * HistogramGenerator::ComponentSum |
+           (m_ui->cbR->isChecked() ? 1 : 0) * HistogramGenerator::ComponentR | (m_ui->cbG->isChecked() ? 1 : 0) * HistogramGenerator::ComponentG |
+           (m_ui->cbB->isChecked() ? 1 : 0) * HistogramGenerator::ComponentB;
+}
 
-    ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
+ScopeKernels::ScopeOptions Histogram::scopeOptions()
+{
+    ScopeKernels::ScopeOptions options;
+    options.rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
+    options.size = m_scopeRect.size();
+    options.components = componentFlags();
+    options.unscaled = m_aUnscaled->isChecked();
+    options.logarithmic = m_ui->rbLogarithmic->isChecked();
+    return options;
+}
 
-    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), qimage, componentFlags, rec, m_aUnscaled->isChecked(),
-                                                                m_ui->rbLogarithmic->isChecked(), accelFactor);
+std::shared_ptr<ScopeKernels::Accumulator> Histogram::createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelFactor) const
+{
+    return std::make_shared<HistogramGenerator::Bins>(options.components, options.rec, accelFactor);
+}
 
-    Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelFactor);
-    return histogram;
+QImage Histogram::renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options)
+{
+    return m_histogramGenerator->drawHistogram(static_cast<const HistogramGenerator::Bins &>(bins), options.size, options.components, options.unscaled,
+                                               options.logarithmic);
 }
 QImage Histogram::renderBackground(uint)
 {
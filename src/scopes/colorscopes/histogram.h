@@ -40,7 +40,11 @@ private:
     bool isScopeDependingOnInput() const override;
     bool isBackgroundDependingOnInput() const override;
     QImage renderHUD(uint accelerationFactor) override;
-    QImage renderGfxScope(uint accelerationFactor, const QImage &) override;
+    ScopeKernels::ScopeOptions scopeOptions() override;
+    std::shared_ptr<ScopeKernels::Accumulator> createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const override;
+    QImage renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options) override;
     QImage renderBackground(uint accelerationFactor) override;
     Ui::Histogram_UI *m_ui;
+    /** @brief The HistogramGenerator::Components selected in the UI. */
+    int componentFlags() const;
 };
@@ -13,60 +13,107 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QPainter>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 HistogramGenerator::HistogramGenerator() = default;
 
+namespace {
+// Bins for each band: r, g, b, y (256 values each), then sum (766 values)
+const size_t binCount = 4 * 256 + 766;
+} // namespace
+
+HistogramGenerator::Bins::Bins(int components, ITURec rec, uint accelFactor)
+    : ScopeKernels::Accumulator(accelFactor)
+    , m_drawY((components & HistogramGenerator::ComponentY) != 0)
+    , m_drawSum((components & HistogramGenerator::ComponentSum) != 0)
+    , m_rec(rec)
+{
+}
+
+bool HistogramGenerator::Bins::sameBins(const ScopeKernels::Accumulator &other) const
+{
+    const auto *bins = dynamic_cast<const Bins *>(&other);
+    return bins != nullptr && bins->m_drawY == m_drawY && bins->m_drawSum == m_drawSum && (!m_drawY || bins->m_rec == m_rec) &&
+           bins->m_accelFactor == m_accelFactor;
+}
+
+void HistogramGenerator::Bins::start(const QImage &image, const QImage &, int bands)
+{
+    m_byteCount = image.sizeInBytes();
+    m_values.assign(size_t(bands), {});
+    for (auto &values : m_values) {
+        values.assign(binCount, 0);
+    }
+}
+
+void HistogramGenerator::Bins::addRow(int band, ScopeKernels::Row &row)
+{
+    int *r = m_values[size_t(band)].data();
+    int *g = r + 256;
+    int *b = g + 256;
+    int *y = b + 256;
+    int *s = y + 256;
+    const QRgb *line = row.pixels();
+    const float *luma = m_drawY && m_accelFactor == 1 ? row.luma(m_rec) : nullptr;
+    // Read the stats from the input image
+    for (int X = 0; X < row.width(); X += int(m_accelFactor)) {
+        const QRgb col = line[X];
+        r[qRed(col)]++;
+        g[qGreen(col)]++;
+        b[qBlue(col)]++;
+
+        if (m_drawY) {
+            // Use if branch to avoid expensive multiplication if Y disabled
+            y[int(luma ? luma[X] : ScopeKernels::pixelLuma(col, m_rec))]++;
+        }
+
+        if (m_drawSum) {
+            // Use an if branch here because the sum takes more operations than rgb
+            s[qRed(col)]++;
+            s[qGreen(col)]++;
+            s[qBlue(col)]++;
+        }
+    }
+}
+
+void HistogramGenerator::Bins::finish()
+{
+    ScopeKernels::sumBands(m_values);
+    m_values.resize(1);
+}
+
 QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, ITURec rec, bool unscaled, bool logScale,
                                               uint accelFactor) const
 {
     if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || image.width() <= 0 || image.height() <= 0) {
         return QImage();
     }
+    Bins bins(components, rec, accelFactor);
+    ScopeKernels::analyse(image, bins);
+    return drawHistogram(bins, paradeSize, components, unscaled, logScale);
+}
 
-    bool drawY = (components & HistogramGenerator::ComponentY) != 0;
+QImage HistogramGenerator::drawHistogram(const Bins &bins, const QSize &paradeSize, const int &components, bool unscaled, bool logScale) const
+{
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || bins.m_values.empty()) {
+        return QImage();
+    }
+
+    bool drawY = (components & HistogramGenerator::ComponentY) != 0 && bins.m_drawY;
     bool drawR = (components & HistogramGenerator::ComponentR) != 0;
     bool drawG = (components & HistogramGenerator::ComponentG) != 0;
     bool drawB = (components & HistogramGenerator::ComponentB) != 0;
-    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
+    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0 && bins.m_drawSum;
 
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r + 256, 0);
-    std::fill(g, g + 256, 0);
-    std::fill(b, b + 256, 0);
-    std::fill(y, y + 256, 0);
-    std::fill(s, s + 766, 0);
+    const int *r = bins.m_values.front().data();
+    const int *g = r + 256;
+    const int *b = g + 256;
+    const int *y = b + 256;
+    const int *s = y + 256;
 
     const int ww = paradeSize.width();
     const int wh = paradeSize.height();
 
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == ITURec::Rec_601) {
-                    y[int(REC_601_R * qRed(col) + REC_601_G * qGreen(col) + REC_601_B * qBlue(col))]++;
-                } else {
-                    y[int(REC_709_R * qRed(col) + REC_709_G * qGreen(col) + REC_709_B * qBlue(col))]++;
-                }
-            }
-
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
-            }
-        }
-    }
-
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
         // Nothing to draw
@@ -80,7 +127,7 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     const int partH = (wh - nParts * d) / nParts;
 
     // Total number of bytes of the image
-    const int byteCount = int(image.sizeInBytes());
+    const int byteCount = int(bins.m_byteCount);
 
     // Factor for scaling the measured value to the histogram.
     // This factor is used for linear scaling and does not depend
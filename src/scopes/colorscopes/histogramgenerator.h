@@ -9,6 +9,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <QObject>
 #include "colorconstants.h"
+#include "scopekernels.h"
 
 class QColor;
 class QImage;
@@ -37,6 +38,32 @@ public:
                               bool logScale,
                               uint accelFactor = 1) const;
 
+    /** @brief Bins of the R, G, B, luma (if ComponentY is set) and sum (if ComponentSum is set) values of a frame. */
+    class Bins : public ScopeKernels::Accumulator
+    {
+    public:
+        Bins(int components, ITURec rec, uint accelFactor);
+        bool sameBins(const ScopeKernels::Accumulator &other) const override;
+        void start(const QImage &image, const QImage &frame, int bands) override;
+        void addRow(int band, ScopeKernels::Row &row) override;
+        void finish() override;
+
+    private:
+        friend class HistogramGenerator;
+        bool m_drawY;
+        bool m_drawSum;
+        ITURec m_rec;
+        qint64 m_byteCount{0};
+        // For each band: r, g, b, y (256 values each), then sum (766 values)
+        std::vector<std::vector<int>> m_values;
+    };
+
+    /**
+     * Draws a histogram from the bins of a frame.
+     * @param bins must include the luma and sum components if they are drawn
+     */
+    QImage drawHistogram(const Bins &bins, const QSize &paradeSize, const int &components, bool unscaled, bool logScale) const;
+
     /**
      * Draws the histogram of a single component.
      *
@@ -132,18 +132,26 @@ QImage RGBParade::renderHUD(uint)
     return hud;
 }
 
-QImage RGBParade::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+ScopeKernels::ScopeOptions RGBParade::scopeOptions()
 {
-    QElapsedTimer timer;
-    timer.start();
-
-    int paintmode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
-    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), qimage, RGBParadeGenerator::PaintMode(paintmode), m_aAxis->isChecked(),
-                                                             m_aGradRef->isChecked(), accelerationFactor);
-    Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelerationFactor);
-    return parade;
+    ScopeKernels::ScopeOptions options;
+    options.size = m_scopeRect.size();
+    options.paintMode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
+    options.axis = m_aAxis->isChecked();
+    options.gradientReference = m_aGradRef->isChecked();
+    return options;
 }
 
+std::shared_ptr<ScopeKernels::Accumulator> RGBParade::createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const
+{
+    return std::make_shared<RGBParadeGenerator::Bins>(options.size, accelerationFactor);
+}
+
+QImage RGBParade::renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options)
+{
+    return m_rgbParadeGenerator->drawRGBParade(static_cast<const RGBParadeGenerator::Bins &>(bins), RGBParadeGenerator::PaintMode(options.paintMode),
+                                               options.axis, options.gradientReference);
+}
 QImage RGBParade::renderBackground(uint)
 {
     return QImage();
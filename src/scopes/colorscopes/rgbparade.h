@@ -42,6 +42,8 @@ private:
     bool isBackgroundDependingOnInput() const override;
 
     QImage renderHUD(uint accelerationFactor) override;
-    QImage renderGfxScope(uint accelerationFactor, const QImage &) override;
+    ScopeKernels::ScopeOptions scopeOptions() override;
+    std::shared_ptr<ScopeKernels::Accumulator> createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const override;
+    QImage renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options) override;
     QImage renderBackground(uint accelerationFactor) override;
 };
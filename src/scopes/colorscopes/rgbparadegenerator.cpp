@@ -10,6 +10,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QColor>
 #include <QDebug>
 #include <QPainter>
+#include <array>
 
 #define CHOP255(a) ((255) < (a) ? (255) : int(a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -21,14 +22,78 @@ const QColor RGBParadeGenerator::colSoft(150, 150, 150, 255);
 const uchar RGBParadeGenerator::distRight(40);
 const uchar RGBParadeGenerator::distBottom(40);
 
-struct StructRGB
+RGBParadeGenerator::RGBParadeGenerator() = default;
+
+namespace {
+const uchar offset = 10;
+}
+
+RGBParadeGenerator::Bins::Bins(const QSize &paradeSize, uint accelFactor)
+    : ScopeKernels::Accumulator(accelFactor)
+    , m_size(paradeSize)
+    , m_partW((uint(paradeSize.width()) - 2 * offset - distRight) / 3)
 {
-    uint r;
-    uint g;
-    uint b;
-};
+}
 
-RGBParadeGenerator::RGBParadeGenerator() = default;
+bool RGBParadeGenerator::Bins::sameBins(const ScopeKernels::Accumulator &other) const
+{
+    const auto *bins = dynamic_cast<const Bins *>(&other);
+    return bins != nullptr && bins->m_size == m_size && bins->m_accelFactor == m_accelFactor;
+}
+
+void RGBParadeGenerator::Bins::start(const QImage &, const QImage &frame, int bands)
+{
+    m_totalPixels = qint64(frame.width()) * frame.height();
+    m_wPrediv = float(m_partW - 1) / (uint(frame.width()) - 1);
+    m_values.assign(size_t(bands), {});
+    for (auto &values : m_values) {
+        values.assign(size_t(m_partW) * 256 * 3, 0);
+    }
+    m_stats.assign(size_t(bands), {255, 255, 255, 0, 0, 0});
+}
+
+void RGBParadeGenerator::Bins::addRow(int band, ScopeKernels::Row &row)
+{
+    std::vector<uint> &values = m_values[size_t(band)];
+    uint *rBins = values.data();
+    uint *gBins = rBins + size_t(m_partW) * 256;
+    uint *bBins = gBins + size_t(m_partW) * 256;
+    std::array<uchar, 6> &st = m_stats[size_t(band)];
+    const QRgb *line = row.pixels();
+    const int iw = row.width();
+    for (int x = ScopeKernels::firstColumn(row.y(), iw, m_accelFactor); x < iw; x += int(m_accelFactor)) {
+        const QRgb pixel = line[x];
+        auto r = uchar(qRed(pixel));
+        auto g = uchar(qGreen(pixel));
+        auto b = uchar(qBlue(pixel));
+
+        auto dx = size_t(x * double(m_wPrediv));
+        rBins[r * m_partW + dx]++;
+        gBins[g * m_partW + dx]++;
+        bBins[b * m_partW + dx]++;
+
+        st[0] = qMin(st[0], r);
+        st[1] = qMin(st[1], g);
+        st[2] = qMin(st[2], b);
+        st[3] = qMax(st[3], r);
+        st[4] = qMax(st[4], g);
+        st[5] = qMax(st[5], b);
+    }
+}
+
+void RGBParadeGenerator::Bins::finish()
+{
+    ScopeKernels::sumBands(m_values);
+    m_values.resize(1);
+    std::array<uchar, 6> &total = m_stats.front();
+    for (const auto &st : m_stats) {
+        for (size_t i = 0; i < 3; ++i) {
+            total[i] = qMin(total[i], st[i]);
+            total[i + 3] = qMax(total[i + 3], st[i + 3]);
+        }
+    }
+    m_stats.resize(1);
+}
 
 QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
                                               bool drawGradientRef, uint accelFactor)
@@ -38,6 +103,17 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
     if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
         return QImage();
     }
+    Bins bins(paradeSize, accelFactor);
+    ScopeKernels::analyse(image, bins);
+    return drawRGBParade(bins, paintMode, drawAxis, drawGradientRef);
+}
+
+QImage RGBParadeGenerator::drawRGBParade(const Bins &bins, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef)
+{
+    const QSize &paradeSize = bins.m_size;
+    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || bins.m_values.empty()) {
+        return QImage();
+    }
     QImage parade(paradeSize, QImage::Format_ARGB32);
     parade.fill(Qt::transparent);
 
@@ -50,84 +126,36 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const uint ww = uint(paradeSize.width());
     const uint wh = uint(paradeSize.height());
-    const uint iw = uint(image.width());
-    const uint ih = uint(image.height());
-
-    const uchar offset = 10;
-    const uint partW = (ww - 2 * offset - distRight) / 3;
+    const uint partW = bins.m_partW;
     const uint partH = wh - distBottom;
 
-    // Statistics
-    uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0;
-
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = float((iw * ih) / accelFactor) / (partW * 255);
+    const float pixelDepth = float(quint64(bins.m_totalPixels) / bins.accelFactor()) / (partW * 255);
     const float gain = 255 / (8 * pixelDepth);
     //        qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
     QImage unscaled(int(ww) - distRight, 256, QImage::Format_ARGB32);
     unscaled.fill(qRgba(0, 0, 0, 0));
 
-    const float wPrediv = float(partW - 1) / (iw - 1);
-
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const auto x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-        auto r = uchar(qRed(pixel));
-        auto g = uchar(qGreen(pixel));
-        auto b = uchar(qBlue(pixel));
-
-        double dx = x * double(wPrediv);
-
-        paradeVals[size_t(dx)][r].r++;
-        paradeVals[size_t(dx)][g].g++;
-        paradeVals[size_t(dx)][b].b++;
-
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
-        }
-        if (g > maxG) {
-            maxG = g;
-        }
-        if (b > maxB) {
-            maxB = b;
-        }
-    }
+    const std::array<uchar, 6> &stats = bins.m_stats.front();
+    const uchar minR = stats[0], minG = stats[1], minB = stats[2], maxR = stats[3], maxG = stats[4], maxB = stats[5];
+    const uint *rBins = bins.m_values.front().data();
+    const uint *gBins = rBins + size_t(partW) * 256;
+    const uint *bBins = gBins + size_t(partW) * 256;
 
     const int offset1 = int(partW + offset);
     const int offset2 = int(2 * partW + 2 * offset);
-    switch (paintMode) {
-    case PaintMode_RGB:
-        for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
-        }
-        break;
-    default:
+    const bool rgbMode = paintMode == PaintMode_RGB;
+    const int low = rgbMode ? 10 : 255;
+    for (int j = 0; j < 256; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(unscaled.scanLine(j));
+        const size_t row = size_t(j) * partW;
         for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
+            line[i] = qRgba(255, low, low, CHOP255(gain * float(rBins[row + size_t(i)])));
+            line[i + offset1] = qRgba(low, 255, low, CHOP255(gain * float(gBins[row + size_t(i)])));
+            line[i + offset2] = qRgba(low, low, 255, CHOP255(gain * float(bBins[row + size_t(i)])));
         }
-        break;
     }
 
     // Scale the image to the target height. Scaling is not accomplished before because
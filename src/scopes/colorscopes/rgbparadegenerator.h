@@ -8,10 +8,12 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include <QObject>
+#include <QSize>
+#include <array>
+#include "scopekernels.h"
 
 class QColor;
 class QImage;
-class QSize;
 class RGBParadeGenerator : public QObject
 {
     Q_OBJECT
@@ -19,8 +21,32 @@ public:
     enum PaintMode { PaintMode_RGB, PaintMode_White };
 
     RGBParadeGenerator();
+    /** @brief Bins of the R, G and B values of a frame for each column of the parade, with the minimum and maximum values. */
+    class Bins : public ScopeKernels::Accumulator
+    {
+    public:
+        Bins(const QSize &paradeSize, uint accelFactor);
+        bool sameBins(const ScopeKernels::Accumulator &other) const override;
+        void start(const QImage &image, const QImage &frame, int bands) override;
+        void addRow(int band, ScopeKernels::Row &row) override;
+        void finish() override;
+
+    private:
+        friend class RGBParadeGenerator;
+        QSize m_size;
+        uint m_partW{0};
+        qint64 m_totalPixels{0};
+        float m_wPrediv{0};
+        // For each band: m_values[band][(component * 256 + value) * partW + column]
+        std::vector<std::vector<uint>> m_values;
+        // Minimum R, G, B then maximum R, G, B for each band
+        std::vector<std::array<uchar, 6>> m_stats;
+    };
+
     QImage calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef,
                               uint accelFactor = 1);
+    /** @brief Draws the parade from the bins of a frame. */
+    QImage drawRGBParade(const Bins &bins, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef);
 
     static const QColor colHighlight;
     static const QColor colLight;
@@ -0,0 +1,74 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopeframe.h"
+#include "abstractgfxscopewidget.h"
+
+ScopeFrame::ScopeFrame(const QImage &image)
+    : m_image(image)
+{
+}
+
+const QImage &ScopeFrame::image() const
+{
+    return m_image;
+}
+
+ScopeFrame::ScopeBins *ScopeFrame::find(AbstractGfxScopeWidget *scope)
+{
+    for (auto &entry : m_scopes) {
+        if (entry.scope == scope) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void ScopeFrame::addScope(AbstractGfxScopeWidget *scope)
+{
+    const ScopeKernels::ScopeOptions options = scope->scopeOptions();
+    QMutexLocker lock(&m_mutex);
+    if (find(scope) == nullptr) {
+        m_scopes.push_back({scope, options, uint(scope->m_accelFactorScope), nullptr});
+    }
+}
+
+std::shared_ptr<ScopeKernels::Accumulator> ScopeFrame::analyse(AbstractGfxScopeWidget *scope, const ScopeKernels::ScopeOptions &options, uint accelerationFactor)
+{
+    std::shared_ptr<ScopeKernels::Accumulator> bins = scope->createAccumulator(options, accelerationFactor);
+    if (!bins) {
+        return nullptr;
+    }
+    QMutexLocker lock(&m_mutex);
+    ScopeBins *entry = find(scope);
+    if (entry != nullptr && entry->bins && entry->bins->sameBins(*bins)) {
+        // Already filled in the pass of another scope, or in a previous rendering with the same settings
+        return entry->bins;
+    }
+    if (entry == nullptr) {
+        m_scopes.push_back({scope, options, accelerationFactor, nullptr});
+        entry = &m_scopes.back();
+    }
+    entry->bins = bins;
+
+    // Fill the bins of the other scopes showing this frame in the same pass
+    std::vector<ScopeKernels::Accumulator *> accumulators{bins.get()};
+    for (auto &other : m_scopes) {
+        if (other.bins || other.scope.isNull()) {
+            continue;
+        }
+        other.bins = other.scope->createAccumulator(other.options, other.accelerationFactor);
+        if (other.bins) {
+            accumulators.push_back(other.bins.get());
+        }
+    }
+    if (m_frame.isNull()) {
+        m_frame = ScopeKernels::toRgb32(m_image);
+    }
+    ScopeKernels::analyse(m_image, m_frame, accumulators);
+    return bins;
+}
@@ -0,0 +1,53 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "scopekernels.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <memory>
+#include <vector>
+
+class AbstractGfxScopeWidget;
+
+/**
+ * @brief A monitor frame shared by all the color scopes showing it.
+ *
+ * The frame is converted for analysis once, and the first scope rendering it
+ * fills the bins of all the scopes it was distributed to in a single pass,
+ * the other scopes then only have to draw their bins.
+ */
+class ScopeFrame
+{
+public:
+    explicit ScopeFrame(const QImage &image);
+
+    const QImage &image() const;
+    /** @brief Registers a scope that will render this frame, so that its bins are filled together with the bins of the other scopes.
+     *  Must be called on the GUI thread, the settings of the scope are copied here. */
+    void addScope(AbstractGfxScopeWidget *scope);
+    /** @brief Returns the bins of @p scope for this frame, filled with @p options and @p accelerationFactor.
+     *  Returns nullptr if the scope cannot analyse frames with these settings. */
+    std::shared_ptr<ScopeKernels::Accumulator> analyse(AbstractGfxScopeWidget *scope, const ScopeKernels::ScopeOptions &options, uint accelerationFactor);
+
+private:
+    struct ScopeBins
+    {
+        QPointer<AbstractGfxScopeWidget> scope;
+        ScopeKernels::ScopeOptions options;
+        uint accelerationFactor;
+        std::shared_ptr<ScopeKernels::Accumulator> bins;
+    };
+    const QImage m_image;
+    QImage m_frame;
+    QMutex m_mutex;
+    std::vector<ScopeBins> m_scopes;
+    ScopeBins *find(AbstractGfxScopeWidget *scope);
+};
@@ -0,0 +1,217 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopekernels.h"
+
+#include <QAtomicInt>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCOPES_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(SCOPES_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SCOPES_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+// Below this number of analysed pixels, the cost of starting threads is not worth it
+constexpr qint64 minSamplesPerBand = 256 * 1024;
+QAtomicInt maxThreads(0);
+
+void lumaCoefficients(ITURec rec, float &kr, float &kg, float &kb)
+{
+    if (rec == ITURec::Rec_601) {
+        kr = REC_601_R;
+        kg = REC_601_G;
+        kb = REC_601_B;
+    } else {
+        kr = REC_709_R;
+        kg = REC_709_G;
+        kb = REC_709_B;
+    }
+}
+
+// The products are summed in the same order in all implementations so that the results are identical
+void lumaScalar(const QRgb *pixels, int start, int count, float kr, float kg, float kb, float *out)
+{
+    for (int i = start; i < count; ++i) {
+        const QRgb p = pixels[i];
+        out[i] = kr * qRed(p) + kg * qGreen(p) + kb * qBlue(p);
+    }
+}
+
+#ifdef SCOPES_SSE2
+int lumaSse2(const QRgb *pixels, int count, float kr, float kg, float kb, float *out)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128 vr = _mm_set1_ps(kr);
+    const __m128 vg = _mm_set1_ps(kg);
+    const __m128 vb = _mm_set1_ps(kb);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128 r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 16), mask));
+        const __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 8), mask));
+        const __m128 b = _mm_cvtepi32_ps(_mm_and_si128(p, mask));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, r), _mm_mul_ps(vg, g)), _mm_mul_ps(vb, b)));
+    }
+    return i;
+}
+#endif
+
+#ifdef SCOPES_AVX2
+__attribute__((target("avx2"))) int lumaAvx2(const QRgb *pixels, int count, float kr, float kg, float kb, float *out)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256 vr = _mm256_set1_ps(kr);
+    const __m256 vg = _mm256_set1_ps(kg);
+    const __m256 vb = _mm256_set1_ps(kb);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        const __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, 16), mask));
+        const __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, 8), mask));
+        const __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(p, mask));
+        // Separate mul and add (no FMA) to get the same rounding as the other implementations
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr, r), _mm256_mul_ps(vg, g)), _mm256_mul_ps(vb, b)));
+    }
+    return i;
+}
+
+bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+} // namespace
+
+QImage ScopeKernels::toRgb32(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    // Monitor frames are opaque, so premultiplied data can be read as is
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+    default:
+        return image.convertToFormat(QImage::Format_RGB32);
+    }
+}
+
+void ScopeKernels::luma(const QRgb *pixels, int count, ITURec rec, float *out)
+{
+    float kr, kg, kb;
+    lumaCoefficients(rec, kr, kg, kb);
+    int done = 0;
+#ifdef SCOPES_AVX2
+    if (hasAvx2()) {
+        done = lumaAvx2(pixels, count, kr, kg, kb, out);
+    }
+#endif
+#ifdef SCOPES_SSE2
+    done += lumaSse2(pixels + done, count - done, kr, kg, kb, out + done);
+#endif
+    lumaScalar(pixels, done, count, kr, kg, kb, out);
+}
+
+void ScopeKernels::setMaxThreads(int threads)
+{
+    maxThreads.storeRelaxed(qMax(0, threads));
+}
+
+int ScopeKernels::bandCount(int height, qint64 samples)
+{
+    int threads = maxThreads.loadRelaxed();
+    if (threads <= 0) {
+        threads = QThread::idealThreadCount();
+    }
+    const int bands = int(qMin(qint64(threads), samples / minSamplesPerBand));
+    return qBound(1, bands, qMax(1, height));
+}
+
+void ScopeKernels::forEachBand(int height, int bands, const std::function<void(int, int, int)> &process)
+{
+    if (bands <= 1) {
+        process(0, 0, height);
+        return;
+    }
+    QVector<int> indexes(bands);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [&](int band) { process(band, int(qint64(height) * band / bands), int(qint64(height) * (band + 1) / bands)); });
+}
+
+ScopeKernels::Row::Row(int width)
+    : m_width(width)
+{
+}
+
+void ScopeKernels::Row::setLine(int y, const QRgb *pixels)
+{
+    m_y = y;
+    m_pixels = pixels;
+    m_lumaReady[0] = false;
+    m_lumaReady[1] = false;
+}
+
+const float *ScopeKernels::Row::luma(ITURec rec)
+{
+    const int index = rec == ITURec::Rec_601 ? 0 : 1;
+    std::vector<float> &values = m_luma[index];
+    if (!m_lumaReady[index]) {
+        values.resize(size_t(m_width));
+        ScopeKernels::luma(m_pixels, m_width, rec, values.data());
+        m_lumaReady[index] = true;
+    }
+    return values.data();
+}
+
+ScopeKernels::Accumulator::Accumulator(uint accelFactor)
+    : m_accelFactor(qMax(1u, accelFactor))
+{
+}
+
+ScopeKernels::Accumulator::~Accumulator() = default;
+
+void ScopeKernels::analyse(const QImage &image, const QImage &frame, const std::vector<Accumulator *> &accumulators)
+{
+    if (accumulators.empty() || frame.width() <= 0 || frame.height() <= 0) {
+        return;
+    }
+    uint accelFactor = accumulators.front()->accelFactor();
+    for (const Accumulator *accumulator : accumulators) {
+        accelFactor = qMin(accelFactor, accumulator->accelFactor());
+    }
+    const int width = frame.width();
+    const int height = frame.height();
+    const int bands = bandCount(height, qint64(width) * height * qint64(accumulators.size()) / accelFactor);
+    for (Accumulator *accumulator : accumulators) {
+        accumulator->start(image, frame, bands);
+    }
+    forEachBand(height, bands, [&](int band, int firstRow, int lastRow) {
+        Row row(width);
+        for (int y = firstRow; y < lastRow; ++y) {
+            row.setLine(y, reinterpret_cast<const QRgb *>(frame.constScanLine(y)));
+            for (Accumulator *accumulator : accumulators) {
+                accumulator->addRow(band, row);
+            }
+        }
+    });
+    for (Accumulator *accumulator : accumulators) {
+        accumulator->finish();
+    }
+}
+
+void ScopeKernels::analyse(const QImage &image, Accumulator &accumulator)
+{
+    analyse(image, toRgb32(image), {&accumulator});
+}
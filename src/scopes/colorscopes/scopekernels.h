@@ -0,0 +1,149 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+
+#include <QImage>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Low level helpers shared by the color scope generators.
+ *
+ * The generators read the frame scanlines directly instead of calling
+ * QImage::pixel() for each sample, compute the luma of whole scanlines
+ * with SIMD instructions when available (SSE2 / AVX2 on x86, scalar code
+ * elsewhere) and can split the frame in bands of rows analysed in parallel,
+ * each band accumulating into its own bins that are summed afterwards.
+ *
+ * A frame is read once for all the scopes showing it: each scope provides
+ * an Accumulator, and analyse() passes every row of the frame to all of them.
+ */
+namespace ScopeKernels {
+
+/** @brief Returns @p image in a format whose scanlines can be read as QRgb words.
+ *  32 bit RGB images are returned as is, other formats are converted. */
+QImage toRgb32(const QImage &image);
+
+/** @brief The luma (on [0, 255]) of a single pixel, used when pixels are skipped. */
+inline float pixelLuma(QRgb pixel, ITURec rec)
+{
+    if (rec == ITURec::Rec_601) {
+        return REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel);
+    }
+    return REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
+}
+
+/** @brief Computes the luma (on [0, 255]) of @p count pixels into @p out using the coefficients of @p rec. */
+void luma(const QRgb *pixels, int count, ITURec rec, float *out);
+
+/** @brief The first column of row @p y analysed with @p accelFactor.
+ *  This keeps the pixel pattern of skipping accelFactor pixels in row-major order. */
+inline int firstColumn(int y, int width, uint accelFactor)
+{
+    const qint64 index = qint64(y) * width;
+    return int((accelFactor - index % accelFactor) % accelFactor);
+}
+
+/** @brief Set the maximum number of threads used to analyse a frame, 0 to use all cores. */
+void setMaxThreads(int threads);
+
+/** @brief The number of bands a frame with @p height rows and @p samples analysed pixels should be split into. */
+int bandCount(int height, qint64 samples);
+
+/** @brief Calls @p process(band, firstRow, lastRow) for each of the @p bands bands of rows in [0, @p height), in parallel.
+ *  The rows of a band are [firstRow, lastRow). */
+void forEachBand(int height, int bands, const std::function<void(int, int, int)> &process);
+
+/**
+ * @brief A row of the analysed frame, passed to all the accumulators of a pass.
+ * The luma of the row is only computed when an accumulator asks for it,
+ * and at most once per row and recommendation.
+ */
+class Row
+{
+public:
+    explicit Row(int width);
+    void setLine(int y, const QRgb *pixels);
+    int y() const { return m_y; }
+    int width() const { return m_width; }
+    const QRgb *pixels() const { return m_pixels; }
+    /** @brief The luma (on [0, 255]) of all the pixels of the row. */
+    const float *luma(ITURec rec);
+
+private:
+    int m_y{0};
+    int m_width;
+    const QRgb *m_pixels{nullptr};
+    std::vector<float> m_luma[2];
+    bool m_lumaReady[2]{false, false};
+};
+
+/**
+ * @brief The settings of a scope, copied from its widgets on the GUI thread.
+ * The bins of a scope are created, filled and drawn in other threads from these options only.
+ * Each scope uses the fields it depends on.
+ */
+struct ScopeOptions
+{
+    /** @brief Size of the scope drawing, empty if it is not known yet */
+    QSize size;
+    ITURec rec{ITURec::Rec_709};
+    int components{0};
+    int paintMode{0};
+    int colorSpace{0};
+    float gain{1.f};
+    bool unscaled{false};
+    bool logarithmic{false};
+    bool axis{false};
+    bool gradientReference{false};
+};
+
+/**
+ * @brief Bins of a scope, filled during a pass over a frame.
+ * Several accumulators can be filled with a single pass over the frame, see analyse().
+ */
+class Accumulator
+{
+public:
+    explicit Accumulator(uint accelFactor);
+    virtual ~Accumulator();
+    uint accelFactor() const { return m_accelFactor; }
+    /** @brief Returns true if @p other would compute the same bins, so that the bins of this accumulator can be used instead. */
+    virtual bool sameBins(const Accumulator &other) const = 0;
+    /** @brief Prepares the bins of @p bands bands.
+     *  @param image is the analysed image as received, @param frame its RGB32 version read by the rows. */
+    virtual void start(const QImage &image, const QImage &frame, int bands) = 0;
+    /** @brief Adds the pixels of @p row to the bins of @p band. Bands are filled in parallel, rows of a band in order. */
+    virtual void addRow(int band, Row &row) = 0;
+    /** @brief Merges the bins of all bands. */
+    virtual void finish() = 0;
+
+protected:
+    uint m_accelFactor;
+};
+
+/** @brief Fills all @p accumulators with a single pass over @p frame, the RGB32 version of @p image. */
+void analyse(const QImage &image, const QImage &frame, const std::vector<Accumulator *> &accumulators);
+/** @brief Fills @p accumulator from @p image. */
+void analyse(const QImage &image, Accumulator &accumulator);
+
+/** @brief Adds the bins of all bands to the bins of the first band. */
+template <typename T> void sumBands(std::vector<std::vector<T>> &bands)
+{
+    std::vector<T> &total = bands.front();
+    for (size_t b = 1; b < bands.size(); ++b) {
+        const std::vector<T> &values = bands.at(b);
+        for (size_t i = 0; i < total.size(); ++i) {
+            total[i] += values[i];
+        }
+    }
+}
+
+} // namespace ScopeKernels
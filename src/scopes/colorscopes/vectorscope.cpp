@@ -264,26 +264,37 @@ QImage Vectorscope::renderHUD(uint)
     return hud;
 }
 
-QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+VectorscopeGenerator::PaintMode Vectorscope::paintMode() const
 {
-    QElapsedTimer timer;
-    timer.start();
-    QImage scope;
+    return VectorscopeGenerator::PaintMode(m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt());
+}
 
-    if (m_cw <= 0) {
-        qCDebug(KDENLIVE_LOG) << "Scope size not known yet. Aborting.";
-    } else {
+ScopeKernels::ScopeOptions Vectorscope::scopeOptions()
+{
+    ScopeKernels::ScopeOptions options;
+    if (m_cw > 0) {
+        options.size = m_scopeRect.size();
+    }
+    options.gain = m_gain;
+    options.paintMode = paintMode();
+    options.colorSpace = m_aColorSpace_YPbPr->isChecked() ? VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
+    return options;
+}
 
-        VectorscopeGenerator::ColorSpace colorSpace =
-            m_aColorSpace_YPbPr->isChecked() ? VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
-        VectorscopeGenerator::PaintMode paintMode = VectorscopeGenerator::PaintMode(m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt());
-        scope = m_vectorscopeGenerator->calculateVectorscope(m_scopeRect.size(), qimage, m_gain, paintMode, colorSpace, m_aAxisEnabled->isChecked(),
-                                                             accelerationFactor);
+std::shared_ptr<ScopeKernels::Accumulator> Vectorscope::createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const
+{
+    if (options.size.isEmpty()) {
+        qCDebug(KDENLIVE_LOG) << "Scope size not known yet. Aborting.";
+        return nullptr;
     }
-    Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelerationFactor);
-    return scope;
+    return std::make_shared<VectorscopeGenerator::Bins>(options.size, options.gain, VectorscopeGenerator::PaintMode(options.paintMode),
+                                                        VectorscopeGenerator::ColorSpace(options.colorSpace), accelerationFactor);
 }
 
+QImage Vectorscope::renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options)
+{
+    return m_vectorscopeGenerator->drawVectorscope(static_cast<const VectorscopeGenerator::Bins &>(bins), VectorscopeGenerator::PaintMode(options.paintMode));
+}
 QImage Vectorscope::renderBackground(uint)
 {
     QElapsedTimer timer;
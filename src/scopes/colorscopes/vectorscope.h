@@ -9,11 +9,11 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "abstractgfxscopewidget.h"
 #include "ui_vectorscope_ui.h"
+#include "vectorscopegenerator.h"
 
 class ColorTools;
 
 class Vectorscope_UI;
-class VectorscopeGenerator;
 
 enum BACKGROUND_MODE { BG_NONE = 0, BG_YUV = 1, BG_CHROMA = 2, BG_YPbPr = 3 };
 
@@ -36,7 +36,9 @@ protected:
     ///// Implemented methods /////
     QRect scopeRect() override;
     QImage renderHUD(uint accelerationFactor) override;
-    QImage renderGfxScope(uint accelerationFactor, const QImage &) override;
+    ScopeKernels::ScopeOptions scopeOptions() override;
+    std::shared_ptr<ScopeKernels::Accumulator> createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const override;
+    QImage renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options) override;
     QImage renderBackground(uint accelerationFactor) override;
     bool isHUDDependingOnInput() const override;
     bool isScopeDependingOnInput() const override;
@@ -48,6 +50,7 @@ protected:
 
 private:
     Ui::Vectorscope_UI *m_ui;
+    VectorscopeGenerator::PaintMode paintMode() const;
 
     ColorTools *m_colorTools;
 
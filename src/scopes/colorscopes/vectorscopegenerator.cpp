@@ -61,7 +61,10 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
@@ -99,47 +102,66 @@ const double VectorscopeGenerator::scaling = 1 / .7;
   x does not need to be inverted.
 
  */
-QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF &point) const
+QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF &point)
 {
     return {int((targetSize.width() - 1) * (point.x() + 1) / 2), int((targetSize.height() - 1) * (1 - (point.y() + 1) / 2))};
 }
 
-QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
-                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
-                                                  uint accelFactor) const
+namespace {
+bool countsHits(VectorscopeGenerator::PaintMode paintMode)
 {
-    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
-        // Invalid size
-        return QImage();
-    }
-    if (accelFactor < 1) { accelFactor = 1; }
-
-    // Prepare the vectorscope data
-    const int cw = (vectorscopeSize.width() < vectorscopeSize.height()) ? vectorscopeSize.width() : vectorscopeSize.height();
-    QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
-    scope.fill(qRgba(0, 0, 0, 0));
+    return paintMode != VectorscopeGenerator::PaintMode_YUV && paintMode != VectorscopeGenerator::PaintMode_Chroma &&
+           paintMode != VectorscopeGenerator::PaintMode_Original;
+}
+} // namespace
+
+VectorscopeGenerator::Bins::Bins(const QSize &vectorscopeSize, float gain, VectorscopeGenerator::PaintMode paintMode,
+                                 VectorscopeGenerator::ColorSpace colorSpace, uint accelFactor)
+    : ScopeKernels::Accumulator(accelFactor)
+    , m_size(vectorscopeSize)
+    , m_cw((vectorscopeSize.width() < vectorscopeSize.height()) ? vectorscopeSize.width() : vectorscopeSize.height())
+    , m_gain(gain)
+    // The green and black modes only depend on the number of image pixels hitting a scope pixel,
+    // the other modes on the last image pixel hitting it.
+    , m_countHits(countsHits(paintMode))
+    , m_colorSpace(colorSpace)
+{
+}
 
-    double dy, dr, dg, db, dmax;
-    double /*y,*/ u, v;
-    QPoint pt;
-    QRgb px;
+bool VectorscopeGenerator::Bins::sameBins(const ScopeKernels::Accumulator &other) const
+{
+    const auto *bins = dynamic_cast<const Bins *>(&other);
+    return bins != nullptr && bins->m_size == m_size && qFuzzyCompare(bins->m_gain, m_gain) && bins->m_countHits == m_countHits &&
+           bins->m_colorSpace == m_colorSpace && bins->m_accelFactor == m_accelFactor;
+}
 
+void VectorscopeGenerator::Bins::start(const QImage &image, const QImage &frame, int bands)
+{
     // Just an average for the number of image pixels per scope pixel.
     // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
     // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
-    double avgPxPerPx = double(image.depth()) / 8 * (image.bytesPerLine() * image.height()) / scope.size().width() / scope.size().height() / accelFactor;
-
-    // benchmarking code
-    // const auto start = std::chrono::high_resolution_clock::now();
+    m_avgPxPerPx = double(image.depth()) / 8 * (image.bytesPerLine() * image.height()) / m_cw / m_cw / m_accelFactor;
+    m_frame = frame;
+    m_values.assign(size_t(bands), {});
+    for (auto &values : m_values) {
+        values.assign(size_t(m_cw) * size_t(m_cw), 0);
+    }
+}
 
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const QRgb pixel = image.pixel(i % image.width(), i / image.width());
+void VectorscopeGenerator::Bins::addRow(int band, ScopeKernels::Row &row)
+{
+    std::vector<quint32> &values = m_values[size_t(band)];
+    const QRgb *line = row.pixels();
+    const int iw = row.width();
+    const int Y = row.y();
+    double u, v;
+    for (int X = ScopeKernels::firstColumn(Y, iw, m_accelFactor); X < iw; X += int(m_accelFactor)) {
+        const QRgb pixel = line[X];
         const int r = qRed(pixel);
         const int g = qGreen(pixel);
         const int b = qBlue(pixel);
 
-        switch (colorSpace) {
+        switch (m_colorSpace) {
         case VectorscopeGenerator::ColorSpace_YUV:
             //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
             u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
@@ -153,74 +175,156 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
             break;
         }
 
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * double(gain) * u, SCALING * double(gain) * v));
-
-        if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
+        const QPoint pt = mapToCircle(m_size, QPointF(SCALING * double(m_gain) * u, SCALING * double(m_gain) * v));
+        if (pt.x() >= m_cw || pt.x() < 0 || pt.y() >= m_cw || pt.y() < 0) {
             // Point lies outside (because of scaling), don't plot it
-
+            continue;
+        }
+        quint32 &value = values[size_t(pt.y()) * size_t(m_cw) + size_t(pt.x())];
+        if (m_countHits) {
+            value++;
         } else {
+            value = quint32(qint64(Y) * iw + X + 1);
+        }
+    }
+}
 
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
-                    break;
-                }
+void VectorscopeGenerator::Bins::finish()
+{
+    // Merge the bands, later bands overwrite the last pixel of earlier ones
+    if (m_countHits) {
+        ScopeKernels::sumBands(m_values);
+    } else {
+        std::vector<quint32> &last = m_values.front();
+        for (size_t band = 1; band < m_values.size(); ++band) {
+            const std::vector<quint32> &values = m_values.at(band);
+            for (size_t i = 0; i < last.size(); ++i) {
+                last[i] = std::max(last[i], values[i]);
+            }
+        }
+    }
+    m_values.resize(1);
+}
 
-                if (dr < 0) {
-                    dr = 0;
-                }
-                if (dg < 0) {
-                    dg = 0;
-                }
-                if (db < 0) {
-                    db = 0;
-                }
-                if (dr > 255) {
-                    dr = 255;
-                }
-                if (dg > 255) {
-                    dg = 255;
-                }
-                if (db > 255) {
-                    db = 255;
-                }
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
+                                                  uint accelFactor) const
+{
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+        // Invalid size
+        return QImage();
+    }
+    Bins bins(vectorscopeSize, gain, paintMode, colorSpace, accelFactor);
+    ScopeKernels::analyse(image, bins);
+    return drawVectorscope(bins, paintMode);
+}
 
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
+QImage VectorscopeGenerator::drawVectorscope(const Bins &bins, const VectorscopeGenerator::PaintMode &paintMode) const
+{
+    const int cw = bins.m_cw;
+    if (cw <= 0 || bins.m_values.empty() || countsHits(paintMode) != bins.m_countHits) {
+        return QImage();
+    }
+    QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
+    scope.fill(qRgba(0, 0, 0, 0));
+
+    // benchmarking code
+    // const auto start = std::chrono::high_resolution_clock::now();
+
+    const bool countHits = bins.m_countHits;
+    const double avgPxPerPx = bins.m_avgPxPerPx;
+    const VectorscopeGenerator::ColorSpace colorSpace = bins.m_colorSpace;
+    const QImage &frame = bins.m_frame;
+    const int iw = frame.width();
+    const std::vector<quint32> &hits = bins.m_values.front();
+
+    // The color of a scope pixel hit n times in the green and black modes, starting from a transparent pixel
+    std::vector<QRgb> hitColors;
+    if (countHits) {
+        const quint32 maxHits = hits.empty() ? 0 : *std::max_element(hits.cbegin(), hits.cend());
+        QRgb px = qRgba(0, 0, 0, 0);
+        hitColors.push_back(px);
+        while (hitColors.size() <= maxHits) {
+            switch (paintMode) {
+            case PaintMode_Green:
+                px = qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
+                           qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx)));
+                break;
+            case PaintMode_Green2:
+                px = qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255, qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))),
+                           qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx))));
+                break;
+            case PaintMode_Black:
+            default:
+                px = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
                 break;
+            }
+            if (px == hitColors.back()) {
+                // The color does not change anymore
+                break;
+            }
+            hitColors.push_back(px);
+        }
+    }
 
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
-                    break;
-                }
+    double dy, dr, dg, db, dmax;
+    double u, v;
+    for (int y = 0; y < cw; ++y) {
+        auto *scopeLine = reinterpret_cast<QRgb *>(scope.scanLine(y));
+        for (int x = 0; x < cw; ++x) {
+            const quint32 value = hits[size_t(y) * size_t(cw) + size_t(x)];
+            if (value == 0) {
+                continue;
+            }
+            if (countHits) {
+                scopeLine[x] = hitColors.at(std::min(size_t(value), hitColors.size() - 1));
+                continue;
+            }
+            const quint32 index = value - 1;
+            const QRgb pixel = reinterpret_cast<const QRgb *>(frame.constScanLine(int(index / quint32(iw))))[index % quint32(iw)];
+            if (paintMode == PaintMode_Original) {
+                scopeLine[x] = pixel;
+                continue;
+            }
+            const int r = qRed(pixel);
+            const int g = qGreen(pixel);
+            const int b = qBlue(pixel);
+            switch (colorSpace) {
+            case VectorscopeGenerator::ColorSpace_YUV:
+                u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
+                v = 0.002411 * r - 0.002019 * g - 0.0003921 * b;
+                break;
+            case VectorscopeGenerator::ColorSpace_YPbPr:
+            default:
+                u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
+                v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
+                break;
+            }
+
+            // Draw the pixel using the chosen draw mode.
+            // see yuvColorWheel
+            dy = paintMode == PaintMode_YUV ? 128 : 200; // Default Y value. Lower = darker.
+
+            // Calculate the RGB values from YUV/YPbPr
+            switch (colorSpace) {
+            case VectorscopeGenerator::ColorSpace_YUV:
+                dr = dy + 290.8 * v;
+                dg = dy - 100.6 * u - 148 * v;
+                db = dy + 517.2 * u;
+                break;
+            case VectorscopeGenerator::ColorSpace_YPbPr:
+            default:
+                dr = dy + 357.5 * v;
+                dg = dy - 87.75 * u - 182 * v;
+                db = dy + 451.9 * u;
+                break;
+            }
 
+            if (paintMode == PaintMode_YUV) {
+                dr = qBound(0., dr, 255.);
+                dg = qBound(0., dg, 255.);
+                db = qBound(0., db, 255.);
+            } else {
                 // Scale the RGB values back to max 255
                 dmax = dr;
                 if (dg > dmax) {
@@ -234,28 +338,8 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
                 dr *= dmax;
                 dg *= dmax;
                 db *= dmax;
-
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, pixel);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
-                                         qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx))));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255,
-                                         qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))), qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx)))));
-                break;
-            case PaintMode_Black:
-            default:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
-                break;
             }
+            scopeLine[x] = qRgba(int(dr), int(dg), int(db), 255);
         }
     }
     // const auto elapsed = std::chrono::high_resolution_clock::now() - start;
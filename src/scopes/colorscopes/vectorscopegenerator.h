@@ -9,6 +9,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <QImage>
 #include <QObject>
+#include <QSize>
+#include "scopekernels.h"
 
 class QImage;
 class QPoint;
@@ -23,10 +25,37 @@ public:
     enum ColorSpace { ColorSpace_YUV, ColorSpace_YPbPr };
     enum PaintMode { PaintMode_Green, PaintMode_Green2, PaintMode_Original, PaintMode_Chroma, PaintMode_YUV, PaintMode_Black };
 
+    /** @brief For each scope pixel, the number of frame pixels hitting it (green and black modes)
+     *  or the last frame pixel hitting it (other modes). */
+    class Bins : public ScopeKernels::Accumulator
+    {
+    public:
+        Bins(const QSize &vectorscopeSize, float gain, VectorscopeGenerator::PaintMode paintMode, VectorscopeGenerator::ColorSpace colorSpace,
+             uint accelFactor);
+        bool sameBins(const ScopeKernels::Accumulator &other) const override;
+        void start(const QImage &image, const QImage &frame, int bands) override;
+        void addRow(int band, ScopeKernels::Row &row) override;
+        void finish() override;
+
+    private:
+        friend class VectorscopeGenerator;
+        QSize m_size;
+        int m_cw;
+        float m_gain;
+        bool m_countHits;
+        VectorscopeGenerator::ColorSpace m_colorSpace;
+        double m_avgPxPerPx{0};
+        QImage m_frame;
+        // For each band and scope pixel, the number of hits or the (1 based) index of the last frame pixel
+        std::vector<std::vector<quint32>> m_values;
+    };
+
     QImage calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain, const VectorscopeGenerator::PaintMode &paintMode,
                                 const VectorscopeGenerator::ColorSpace &colorSpace, bool, uint accelFactor = 1) const;
+    /** @brief Draws the vectorscope from the bins of a frame, @p paintMode must use the same kind of bins as the one they were created with. */
+    QImage drawVectorscope(const Bins &bins, const VectorscopeGenerator::PaintMode &paintMode) const;
 
-    QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
+    static QPoint mapToCircle(const QSize &targetSize, const QPointF &point);
     static const double scaling;
 
 Q_SIGNALS:
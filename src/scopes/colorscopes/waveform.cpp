@@ -178,20 +178,24 @@ QImage Waveform::renderHUD(uint)
     return hud;
 }
 
-QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+ScopeKernels::ScopeOptions Waveform::scopeOptions()
 {
-    QElapsedTimer timer;
-    timer.start();
-
-    const int paintmode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
-    ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
-    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0, m_paddingBottom), qimage,
-                                                         WaveformGenerator::PaintMode(paintmode), true, rec, accelFactor);
+    ScopeKernels::ScopeOptions options;
+    options.size = scopeRect().size() - m_textWidth - QSize(0, m_paddingBottom);
+    options.rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
+    options.paintMode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
+    return options;
+}
 
-    Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), 1);
-    return wave;
+std::shared_ptr<ScopeKernels::Accumulator> Waveform::createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelFactor) const
+{
+    return std::make_shared<WaveformGenerator::Bins>(options.size, options.rec, accelFactor);
 }
 
+QImage Waveform::renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options)
+{
+    return m_waveformGenerator->drawWaveform(static_cast<const WaveformGenerator::Bins &>(bins), WaveformGenerator::PaintMode(options.paintMode), true);
+}
 QImage Waveform::renderBackground(uint)
 {
     Q_EMIT signalBackgroundRenderingFinished(0, 1);
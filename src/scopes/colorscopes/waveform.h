@@ -49,7 +49,9 @@ private:
     /// Implemented methods ///
     QRect scopeRect() override;
     QImage renderHUD(uint) override;
-    QImage renderGfxScope(uint, const QImage &) override;
+    ScopeKernels::ScopeOptions scopeOptions() override;
+    std::shared_ptr<ScopeKernels::Accumulator> createAccumulator(const ScopeKernels::ScopeOptions &options, uint accelerationFactor) const override;
+    QImage renderGfxScope(const ScopeKernels::Accumulator &bins, const ScopeKernels::ScopeOptions &options) override;
     QImage renderBackground(uint) override;
     bool isHUDDependingOnInput() const override;
     bool isScopeDependingOnInput() const override;
@@ -22,88 +22,125 @@ WaveformGenerator::WaveformGenerator() = default;
 
 WaveformGenerator::~WaveformGenerator() = default;
 
+WaveformGenerator::Bins::Bins(const QSize &waveformSize, ITURec rec, uint accelFactor)
+    : ScopeKernels::Accumulator(accelFactor)
+    , m_size(waveformSize)
+    , m_rec(rec)
+{
+}
+
+bool WaveformGenerator::Bins::sameBins(const ScopeKernels::Accumulator &other) const
+{
+    const auto *bins = dynamic_cast<const Bins *>(&other);
+    return bins != nullptr && bins->m_size == m_size && bins->m_rec == m_rec && bins->m_accelFactor == m_accelFactor;
+}
+
+void WaveformGenerator::Bins::start(const QImage &, const QImage &frame, int bands)
+{
+    const uint ww = uint(m_size.width());
+    const uint wh = uint(m_size.height());
+    m_totalPixels = qint64(frame.width()) * frame.height();
+    // Subtract 1 from sizes because we start counting from 0.
+    // Not doing it would result in attempts to paint outside of the image.
+    m_hPrediv = (wh - 1) / 255.f;
+    m_wPrediv = (ww - 1) / float(frame.width() - 1);
+    // Flat bins, one row per luma level: m_values[band][level * ww + column]
+    m_values.assign(size_t(bands), {});
+    for (auto &values : m_values) {
+        values.assign(size_t(ww) * wh, 0);
+    }
+}
+
+void WaveformGenerator::Bins::addRow(int band, ScopeKernels::Row &row)
+{
+    std::vector<uint> &values = m_values[size_t(band)];
+    const size_t ww = size_t(m_size.width());
+    const int iw = row.width();
+    if (m_accelFactor == 1) {
+        const float *luma = row.luma(m_rec);
+        for (int x = 0; x < iw; ++x) {
+            values[size_t(luma[x] * m_hPrediv) * ww + size_t(x * m_wPrediv)]++;
+        }
+    } else {
+        const QRgb *line = row.pixels();
+        for (int x = ScopeKernels::firstColumn(row.y(), iw, m_accelFactor); x < iw; x += int(m_accelFactor)) {
+            // dY is on [0,255]
+            const float dY = ScopeKernels::pixelLuma(line[x], m_rec);
+            values[size_t(dY * m_hPrediv) * ww + size_t(x * m_wPrediv)]++;
+        }
+    }
+}
+
+void WaveformGenerator::Bins::finish()
+{
+    ScopeKernels::sumBands(m_values);
+    m_values.resize(1);
+}
+
 QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode, bool drawAxis, ITURec rec,
                                             uint accelFactor)
 {
     Q_ASSERT(accelFactor >= 1);
 
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+        return QImage();
+    }
+    Bins bins(waveformSize, rec, accelFactor);
+    ScopeKernels::analyse(image, bins);
+    return drawWaveform(bins, paintMode, drawAxis);
+}
+
+QImage WaveformGenerator::drawWaveform(const Bins &bins, WaveformGenerator::PaintMode paintMode, bool drawAxis)
+{
     // QTime time;
     // time.start();
 
-    QImage wave(waveformSize, QImage::Format_ARGB32);
-
-    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    const QSize &waveformSize = bins.m_size;
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || bins.m_values.empty()) {
         return QImage();
     }
 
+    QImage wave(waveformSize, QImage::Format_ARGB32);
     // Fill with transparent color
     wave.fill(qRgba(0, 0, 0, 0));
 
     const uint ww = uint(waveformSize.width());
     const uint wh = uint(waveformSize.height());
-    const uint iw = uint(image.width());
-    const auto totalPixels = image.width() * image.height();
-
-    std::vector<std::vector<uint>> waveValues(size_t(waveformSize.width()), std::vector<uint>(size_t(waveformSize.height()), 0));
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = float(totalPixels / accelFactor) / (ww * wh);
+    const float pixelDepth = float(bins.m_totalPixels / bins.accelFactor()) / (ww * wh);
     const float gain = 255.f / (8 * pixelDepth);
     // qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
-    // Subtract 1 from sizes because we start counting from 0.
-    // Not doing it would result in attempts to paint outside of the image.
-    const float hPrediv = (wh - 1) / 255.f;
-    const float wPrediv = (ww - 1) / float(iw - 1);
-
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const int x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-
-        float dY, dx, dy;
-
-        if (rec == ITURec::Rec_601) {
-            // CIE 601 Luminance
-            dY = REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel);
-        } else {
-            // CIE 709 Luminance
-            dY = REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
-        }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = x * wPrediv;
-        waveValues[size_t(dx)][size_t(dy)]++;
-    }
-
-    switch (paintMode) {
-    case PaintMode_Green:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
+    const std::vector<uint> &values = bins.m_values.front();
+
+    for (uint j = 0; j < wh; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(wave.scanLine(int(wh - j - 1)));
+        const uint *row = values.data() + size_t(j) * ww;
+        switch (paintMode) {
+        case PaintMode_Green:
+            for (uint i = 0; i < ww; ++i) {
+                if (row[i] == 0) {
+                    line[i] = qRgba(0, 0, 0, 0);
+                    continue;
+                }
                 // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                wave.setPixel(i, waveformSize.height() - j - 1,
-                              qRgba(CHOP255(52 * logf(0.1f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(.25f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(64 * logf(gain * float(waveValues[size_t(i)][size_t(j)])))));
+                line[i] = qRgba(CHOP255(52 * logf(0.1f * gain * float(row[i]))), CHOP255(52 * logf(gain * float(row[i]))),
+                                CHOP255(52 * logf(.25f * gain * float(row[i]))), CHOP255(64 * logf(gain * float(row[i]))));
             }
-        }
-        break;
-    case PaintMode_Yellow:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * float(waveValues[size_t(i)][size_t(j)]))));
+            break;
+        case PaintMode_Yellow:
+            for (uint i = 0; i < ww; ++i) {
+                line[i] = qRgba(255, 242, 0, CHOP255(gain * float(row[i])));
             }
-        }
-        break;
-    default:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2.f * gain * float(waveValues[size_t(i)][size_t(j)]))));
+            break;
+        default:
+            for (uint i = 0; i < ww; ++i) {
+                line[i] = qRgba(255, 255, 255, CHOP255(2.f * gain * float(row[i])));
             }
+            break;
         }
-        break;
     }
 
     if (drawAxis) {
@@ -8,10 +8,11 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include <QObject>
+#include <QSize>
 #include "colorconstants.h"
+#include "scopekernels.h"
 
 class QImage;
-class QSize;
 
 class WaveformGenerator : public QObject
 {
@@ -23,6 +24,28 @@ public:
     WaveformGenerator();
     ~WaveformGenerator() override;
 
+    /** @brief Luma bins of a frame, one row per luma level and one column per scope pixel. */
+    class Bins : public ScopeKernels::Accumulator
+    {
+    public:
+        Bins(const QSize &waveformSize, ITURec rec, uint accelFactor);
+        bool sameBins(const ScopeKernels::Accumulator &other) const override;
+        void start(const QImage &image, const QImage &frame, int bands) override;
+        void addRow(int band, ScopeKernels::Row &row) override;
+        void finish() override;
+
+    private:
+        friend class WaveformGenerator;
+        QSize m_size;
+        ITURec m_rec;
+        qint64 m_totalPixels{0};
+        float m_hPrediv{0};
+        float m_wPrediv{0};
+        std::vector<std::vector<uint>> m_values;
+    };
+
     QImage calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode, bool drawAxis,
                              const ITURec rec, uint accelFactor = 1);
+    /** @brief Draws the waveform from the bins of a frame. */
+    QImage drawWaveform(const Bins &bins, WaveformGenerator::PaintMode paintMode, bool drawAxis);
 };
@@ -11,6 +11,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "audioscopes/spectrogram.h"
 #include "colorscopes/histogram.h"
 #include "colorscopes/rgbparade.h"
+#include "colorscopes/scopeframe.h"
+#include "colorscopes/scopekernels.h"
 #include "colorscopes/vectorscope.h"
 #include "colorscopes/waveform.h"
 #include "core.h"
@@ -38,6 +40,7 @@ ScopeManager::ScopeManager(QObject *parent)
 
     slotUpdateActiveRenderer();
 
+    ScopeKernels::setMaxThreads(KdenliveSettings::scopesthreads());
     createScopes();
 }
 
@@ -126,23 +129,33 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
 #ifdef DEBUG_SM
     qCDebug(KDENLIVE_LOG) << "ScopeManager: Starting to distribute frame.";
 #endif
+    // The frame is shared by all scopes, the first one rendering it fills the bins of all
+    // the idle scopes in a single pass. So register them all before any rendering starts.
+    auto frame = std::make_shared<ScopeFrame>(image);
+    QList<GfxScopeData *> receivers;
     for (auto &m_colorScope : m_colorScopes) {
-        if (!m_colorScope.scope->visibleRegion().isEmpty()) {
-            if (m_colorScope.scope->autoRefreshEnabled()) {
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+        if (!m_colorScope.scope->visibleRegion().isEmpty() && (m_colorScope.scope->autoRefreshEnabled() || m_colorScope.singleFrameRequested)) {
+            receivers << &m_colorScope;
+            if (m_colorScope.scope->isScopeIdle()) {
+                frame->addScope(m_colorScope.scope);
+            }
+        }
+    }
+    for (auto *receiver : qAsConst(receivers)) {
+        if (receiver->scope->autoRefreshEnabled()) {
+            receiver->scope->slotRenderZoneUpdated(frame);
 #ifdef DEBUG_SM
-                qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
+            qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << receiver->scope->widgetName();
 #endif
-            } else if (m_colorScope.singleFrameRequested) {
-                // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
-                // Force the scope to update.
-                m_colorScope.singleFrameRequested = false;
-                m_colorScope.scope->slotRenderZoneUpdated(image);
-                m_colorScope.scope->forceUpdateScope();
+        } else {
+            // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
+            // Force the scope to update.
+            receiver->singleFrameRequested = false;
+            receiver->scope->slotRenderZoneUpdated(frame);
+            receiver->scope->forceUpdateScope();
 #ifdef DEBUG_SM
-                qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << m_colorScopes[i].scope->widgetName();
+            qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << receiver->scope->widgetName();
 #endif
-            }
         }
     }
     // checkActiveColourScopes();
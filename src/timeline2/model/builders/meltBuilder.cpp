@@ -33,6 +33,8 @@
 static QStringList m_errorMessage;
 static QStringList m_notesLog;
 std::unordered_map<QString, QString> binIdCorresp;
+// Bin clips by url, built on the first lookup of a timeline load to recover clips with a broken bin id
+static std::unique_ptr<std::unordered_map<QString, QStringList>> binUrlIndex;
 
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, bool useMappedIds, const QString trackTag, Mlt::Tractor &track,
                             Fun &undo, Fun &redo, bool audioTrack, const QString &originalDecimalPoint);
@@ -89,6 +91,8 @@ bool constructTimelineFromTractor(const std::shared_ptr<TimelineItemModel> &time
     Fun redo = []() { return true; };
     // First, we destruct the previous tracks
     timeline->requestReset(undo, redo);
+    timeline->beginBulkLoad();
+    binUrlIndex.reset();
     m_errorMessage.clear();
     bool useMappedIds = true;
 
@@ -183,7 +187,6 @@ bool constructTimelineFromTractor(const std::shared_ptr<TimelineItemModel> &time
 
     qDebug() << "=== OPENING FILE WITH TRACKS: " << tractor.count();
     for (int i = 0; i < tractor.count() && ok; i++) {
-        qApp->processEvents();
         std::unique_ptr<Mlt::Producer> track(tractor.track(i));
         if (track->property_exists("kdenlive:playlistid")) {
             playlist_name = track->get("kdenlive:playlistid");
@@ -258,7 +261,8 @@ bool constructTimelineFromTractor(const std::shared_ptr<TimelineItemModel> &time
             qWarning() << "Unexpected track type" << track->type();
         }
     }
-    timeline->_resetView();
+    timeline->endBulkLoad();
+    binUrlIndex.reset();
 
     // Loading compositions
     Mlt::Service *prod = tractor.producer();
@@ -361,6 +365,8 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
     Fun redo = []() { return true; };
     // First, we destruct the previous tracks
     timeline->requestReset(undo, redo);
+    timeline->beginBulkLoad();
+    binUrlIndex.reset();
     m_errorMessage.clear();
     QStringList expandedFolders;
     QStringList extraBins;
@@ -513,7 +519,8 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
             qWarning() << "Unexpected track type" << track->type();
         }
     }
-    timeline->_resetView();
+    timeline->endBulkLoad();
+    binUrlIndex.reset();
 
     // Loading compositions
     QScopedPointer<Mlt::Service> service(tractor.producer());
@@ -755,6 +762,18 @@ PlaylistState::ClipState inferState(const std::shared_ptr<Mlt::Producer> &prod,
     }
     return stateFromBool(VidAud);
 }
+
+QStringList binClipsByUrl(const QString &resource)
+{
+    if (resource.isEmpty()) {
+        return QStringList();
+    }
+    if (!binUrlIndex) {
+        binUrlIndex.reset(new std::unordered_map<QString, QStringList>(pCore->projectItemModel()->getClipsByUrl()));
+    }
+    auto match = binUrlIndex->find(ProjectItemModel::urlKey(QFileInfo(resource)));
+    return match == binUrlIndex->end() ? QStringList() : match->second;
+}
 } // namespace
 
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, bool useMappedIds, const QString trackTag, Mlt::Playlist &track,
@@ -825,7 +844,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                     }
                     // Project was somehow corrupted
                     qWarning() << "can't find clip with id: " << clipId << "in bin playlist";
-                    QStringList fixedId = pCore->projectItemModel()->getClipByUrl(QFileInfo(resource));
+                    QStringList fixedId = binClipsByUrl(resource);
                     const QString tcInfo =
                         QString("<a href=\"%1!%2?%3\">%4 %5</a>")
                             .arg(timeline->uuid().toString(), QString::number(position), QString::number(timeline->getTrackPosition(tid) + 1), trackTag,
@@ -853,7 +872,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                 // Trying to recover clip by its resource
                 const QString service = clip->parent().get("mlt_service");
                 const QString resource = service == QLatin1String("timewarp") ? clip->parent().get("warp_resource") : clip->parent().get("resource");
-                const QStringList possibleIds = pCore->projectItemModel()->getClipByUrl(QFileInfo(resource));
+                const QStringList possibleIds = binClipsByUrl(resource);
                 qWarning() << "Incorred clip id, trying to recover " << binId << "/" << clip->get("id") << " = " << resource;
                 if (!possibleIds.isEmpty()) {
                     binId = possibleIds.first();
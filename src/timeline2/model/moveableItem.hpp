@@ -104,6 +104,9 @@ protected:
     virtual void setInOut(int in, int out);
 
 protected:
+    /** @brief Marks the position index of track @param tid as outdated after the item moved or was resized */
+    void invalidateTrackIndex(int tid) const;
+
     std::weak_ptr<TimelineModel> m_parent;
     /** @brief this is the creation id of the item, used for book-keeping */
     int m_id;
@@ -72,19 +72,35 @@ template <typename Service> void MoveableItem<Service>::setPosition(int pos)
 {
     QWriteLocker locker(&m_lock);
     m_position = pos;
+    invalidateTrackIndex(m_currentTrackId);
 }
 
 template <typename Service> void MoveableItem<Service>::setCurrentTrackId(int tid, bool finalMove)
 {
     Q_UNUSED(finalMove);
     QWriteLocker locker(&m_lock);
+    invalidateTrackIndex(m_currentTrackId);
     m_currentTrackId = tid;
+    invalidateTrackIndex(tid);
 }
 
 template <typename Service> void MoveableItem<Service>::setInOut(int in, int out)
 {
     QWriteLocker locker(&m_lock);
     service()->set_in_and_out(in, out);
+    invalidateTrackIndex(m_currentTrackId);
+}
+
+template <typename Service> void MoveableItem<Service>::invalidateTrackIndex(int tid) const
+{
+    if (tid == -1) {
+        return;
+    }
+    if (auto ptr = m_parent.lock()) {
+        if (ptr->isTrack(tid)) {
+            ptr->getTrackById_const(tid)->invalidateIndex(m_id);
+        }
+    }
 }
 
 template <typename Service> bool MoveableItem<Service>::isGrabbed() const
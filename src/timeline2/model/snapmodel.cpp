@@ -4,6 +4,7 @@
 */
 #include "snapmodel.hpp"
 #include <QDebug>
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 
@@ -14,36 +15,127 @@ SnapModel::SnapModel() = default;
 
 void SnapModel::addPoint(int position)
 {
-    if (m_snaps.count(position) == 0) {
-        m_snaps[position] = 1;
-    } else {
-        m_snaps[position]++;
-    }
+    m_pending.emplace_back(position, 1);
 }
 
 void SnapModel::removePoint(int position)
 {
-    Q_ASSERT(m_snaps.count(position) > 0);
-    if (m_snaps[position] == 1) {
-        m_snaps.erase(position);
-    } else {
-        m_snaps[position]--;
+    m_pending.emplace_back(position, -1);
+}
+
+void SnapModel::addPoints(const std::vector<int> &positions)
+{
+    for (int position : positions) {
+        m_pending.emplace_back(position, 1);
     }
 }
 
-int SnapModel::getClosestPoint(int position)
+void SnapModel::removePoints(const std::vector<int> &positions)
 {
-    if (m_snaps.empty()) {
-        return -1;
+    for (int position : positions) {
+        m_pending.emplace_back(position, -1);
+    }
+}
+
+void SnapModel::flush()
+{
+    if (m_pending.empty()) {
+        return;
+    }
+    if (m_pending.size() <= 8) {
+        // Few changes, update the arrays in place
+        for (const auto &change : m_pending) {
+            auto it = std::lower_bound(m_positions.begin(), m_positions.end(), change.first);
+            auto ix = it - m_positions.begin();
+            if (it != m_positions.end() && *it == change.first) {
+                m_counts[size_t(ix)] += change.second;
+                Q_ASSERT(m_counts[size_t(ix)] >= 0);
+                if (m_counts[size_t(ix)] == 0) {
+                    m_positions.erase(it);
+                    m_counts.erase(m_counts.begin() + ix);
+                }
+            } else {
+                Q_ASSERT(change.second > 0);
+                m_positions.insert(it, change.first);
+                m_counts.insert(m_counts.begin() + ix, change.second);
+            }
+        }
+        m_pending.clear();
+        return;
+    }
+    // Merge the sorted changes with the points in a single pass
+    std::sort(m_pending.begin(), m_pending.end());
+    std::vector<int> positions;
+    std::vector<int> counts;
+    positions.reserve(m_positions.size() + m_pending.size());
+    counts.reserve(m_positions.size() + m_pending.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < m_positions.size() || j < m_pending.size()) {
+        int position;
+        if (j == m_pending.size() || (i < m_positions.size() && m_positions[i] <= m_pending[j].first)) {
+            position = m_positions[i];
+        } else {
+            position = m_pending[j].first;
+        }
+        int count = 0;
+        if (i < m_positions.size() && m_positions[i] == position) {
+            count = m_counts[i++];
+        }
+        while (j < m_pending.size() && m_pending[j].first == position) {
+            count += m_pending[j++].second;
+        }
+        Q_ASSERT(count >= 0);
+        if (count > 0) {
+            positions.push_back(position);
+            counts.push_back(count);
+        }
+    }
+    m_positions.swap(positions);
+    m_counts.swap(counts);
+    m_pending.clear();
+}
+
+std::map<int, int> SnapModel::_snaps()
+{
+    flush();
+    std::map<int, int> snaps;
+    for (size_t i = 0; i < m_positions.size(); ++i) {
+        snaps[m_positions[i]] = m_counts[i];
     }
-    auto it = m_snaps.lower_bound(position);
+    return snaps;
+}
+
+bool SnapModel::isIgnored(size_t index) const
+{
+    auto ignored = m_ignore.find(m_positions[index]);
+    return ignored != m_ignore.end() && ignored->second >= m_counts[index];
+}
+
+int SnapModel::getClosestPoint(int position)
+{
+    flush();
+    auto first = std::lower_bound(m_positions.begin(), m_positions.end(), position);
+    // Walk from the binary search result to the closest points that are not ignored
     long long int prev = INT_MIN, next = INT_MAX;
-    if (it != m_snaps.end()) {
-        next = (*it).first;
+    bool found = false;
+    for (auto it = first; it != m_positions.end(); ++it) {
+        if (!isIgnored(size_t(it - m_positions.begin()))) {
+            next = *it;
+            found = true;
+            break;
+        }
     }
-    if (it != m_snaps.begin()) {
+    for (auto it = first; it != m_positions.begin();) {
         --it;
-        prev = (*it).first;
+        if (!isIgnored(size_t(it - m_positions.begin()))) {
+            prev = *it;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        return -1;
     }
     if (std::llabs(position - prev) < std::llabs(position - next)) {
         return int(prev);
@@ -53,44 +145,36 @@ int SnapModel::getClosestPoint(int position)
 
 int SnapModel::getNextPoint(int position)
 {
-    if (m_snaps.empty()) {
-        return position;
-    }
-    auto it = m_snaps.lower_bound(position + 1);
-    long long int next = position;
-    if (it != m_snaps.end()) {
-        next = (*it).first;
+    flush();
+    for (auto it = std::lower_bound(m_positions.begin(), m_positions.end(), position + 1); it != m_positions.end(); ++it) {
+        if (!isIgnored(size_t(it - m_positions.begin()))) {
+            return *it;
+        }
     }
-    return int(next);
+    return position;
 }
 
 int SnapModel::getPreviousPoint(int position)
 {
-    if (m_snaps.empty()) {
-        return 0;
-    }
-    auto it = m_snaps.lower_bound(position);
-    long long int prev = 0;
-    if (it != m_snaps.begin()) {
+    flush();
+    for (auto it = std::lower_bound(m_positions.begin(), m_positions.end(), position); it != m_positions.begin();) {
         --it;
-        prev = (*it).first;
+        if (!isIgnored(size_t(it - m_positions.begin()))) {
+            return *it;
+        }
     }
-    return int(prev);
+    return 0;
 }
 
 void SnapModel::ignore(const std::vector<int> &pts)
 {
-    for (int pt : pts) {
-        removePoint(pt);
-        m_ignore.push_back(pt);
+    for (int position : pts) {
+        m_ignore[position]++;
     }
 }
 
 void SnapModel::unIgnore()
 {
-    for (const auto &pt : m_ignore) {
-        addPoint(pt);
-    }
     m_ignore.clear();
 }
 
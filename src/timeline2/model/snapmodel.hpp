@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <map>
 #include <vector>
 
@@ -27,6 +28,9 @@ public:
 /** @class SnapModel
     @brief This class represents the snap points of the timeline.
     Basically, one can add or remove snap points, and query the closest snap point to a given location
+    The points are stored in a sorted array. Additions and removals are queued and applied together
+    on the next query, so that moving a group of items only rebuilds the array once.
+    Ignored points stay in the array and are skipped by the queries, so dragging items does not modify it.
  */
 class SnapModel : public virtual SnapInterface
 {
@@ -39,6 +43,12 @@ public:
     /** @brief Removes a snappoint from given position */
     void removePoint(int position) override;
 
+    /** @brief Adds a snappoint at each of the given positions */
+    void addPoints(const std::vector<int> &positions);
+
+    /** @brief Removes a snappoint from each of the given positions */
+    void removePoints(const std::vector<int> &positions);
+
     /** @brief Retrieves closest point. Returns -1 if there is no snappoint available */
     int getClosestPoint(int position);
 
@@ -49,7 +59,7 @@ public:
     int getPreviousPoint(int position);
 
     /** @brief Ignores the given positions until unIgnore() is called
-       You can make several call to this before unIgnoring
+       You can make several call to this before unIgnoring, a position is ignored once for each snappoint it holds.
        Note that you cannot remove ignored points.
        @param points list of point to ignore
      */
@@ -70,12 +80,20 @@ public:
     int proposeSize(int in, int out, const std::vector<int> &boundaries, int size, bool right, int maxSnapDist);
 
     // For testing only
-    std::map<int, int> _snaps() { return m_snaps; }
+    std::map<int, int> _snaps();
 
 private:
-    /** This represents the snappoints internally. The keys are the positions and the values are the number of elements at this
-     * position. Note that it is important that the datastructure is ordered. QMap is NOT ordered, and therefore not suitable.
+    /** This represents the snappoints internally. m_positions is sorted, and m_counts holds the number of elements at each position.
      */
-    std::map<int, int> m_snaps;
-    std::vector<int> m_ignore;
+    std::vector<int> m_positions;
+    std::vector<int> m_counts;
+    /** Additions (+1) and removals (-1) not yet applied to the positions */
+    std::vector<std::pair<int, int>> m_pending;
+    /** Number of times each ignored position was ignored */
+    std::map<int, int> m_ignore;
+
+    /** @brief Applies the pending additions and removals */
+    void flush();
+    /** @brief Returns true if all the snappoints at m_positions[@param index] are ignored */
+    bool isIgnored(size_t index) const;
 };
@@ -193,6 +193,7 @@ TimelineModel::~TimelineModel()
         }
         field->unlock();
         m_allTracks.clear();
+        updateTrackLayout();
         if (pCore && pCore->currentDoc() && !pCore->currentDoc()->closing) {
             // If we are not closing the project, unregister this timeline clips from bin
             for (const auto &clip : m_allClips) {
@@ -264,12 +265,7 @@ int TimelineModel::getTrackIndexFromPosition(int pos) const
 {
     Q_ASSERT(pos >= 0 && pos < int(m_allTracks.size()));
     READ_LOCK();
-    auto it = m_allTracks.cbegin();
-    while (pos > 0) {
-        it++;
-        pos--;
-    }
-    return (*it)->getId();
+    return m_trackOrder[size_t(pos)];
 }
 
 int TimelineModel::getClipsCount() const
@@ -457,9 +453,7 @@ int TimelineModel::getTrackPosition(int trackId) const
 {
     READ_LOCK();
     Q_ASSERT(isTrack(trackId));
-    auto it = m_allTracks.cbegin();
-    int pos = int(std::distance(it, static_cast<decltype(it)>(m_iteratorTable.at(trackId))));
-    return pos;
+    return m_trackLayout.at(trackId).position;
 }
 
 int TimelineModel::getTrackMltIndex(int trackId) const
@@ -471,66 +465,71 @@ int TimelineModel::getTrackMltIndex(int trackId) const
 
 int TimelineModel::getTrackSortValue(int trackId, int separated) const
 {
-    if (separated == 1) {
-        // This will be A2, A1, V1, V2
-        return getTrackPosition(trackId) + 1;
-    }
-    if (separated == 2) {
-        // This will be A1, A2, V1, V2
-        // Count audio/video tracks
-        auto it = m_allTracks.cbegin();
-        int aCount = 0;
-        int vCount = 0;
-        int refPos = 0;
-        bool isVideo = true;
-        while (it != m_allTracks.cend()) {
-            if ((*it)->isAudioTrack()) {
-                if ((*it)->getId() == trackId) {
-                    refPos = aCount;
-                    isVideo = false;
-                }
-                aCount++;
-            } else {
-                // video track
-                if ((*it)->getId() == trackId) {
-                    refPos = vCount;
-                }
-                vCount++;
-            }
-            ++it;
-        }
-        return isVideo ? aCount + refPos + 1 : aCount - refPos;
+    READ_LOCK();
+    auto layout = m_trackLayout.find(trackId);
+    if (layout == m_trackLayout.end()) {
+        return 0;
     }
-    // This will be A1, V1, A2, V2
-    auto it = m_allTracks.cend();
+    return layout->second.sortValue[separated == 1 || separated == 2 ? separated : 0];
+}
+
+void TimelineModel::updateTrackLayout()
+{
+    m_trackLayout.clear();
+    m_trackOrder.clear();
+    m_trackOrder.reserve(m_allTracks.size());
     int aCount = 0;
     int vCount = 0;
-    bool isAudio = false;
-    int trackPos = 0;
-    while (it != m_allTracks.begin()) {
-        --it;
-        bool audioTrack = (*it)->isAudioTrack();
-        if (audioTrack) {
-            aCount++;
+    // Index of each track among the tracks of the same type, from the bottom
+    std::vector<int> typeIndex;
+    typeIndex.reserve(m_allTracks.size());
+    // Audio tracks are paired with the video tracks above them, like nested brackets: A2 A1 V1 V2
+    std::vector<int> unpairedAudio;
+    for (const auto &track : m_allTracks) {
+        int tid = track->getId();
+        int position = int(m_trackOrder.size());
+        m_trackOrder.push_back(tid);
+        TrackLayout layout{position, -1, {0, 0, 0}};
+        if (track->isAudioTrack()) {
+            typeIndex.push_back(aCount++);
+            unpairedAudio.push_back(tid);
         } else {
-            vCount++;
-        }
-        if (trackId == (*it)->getId()) {
-            isAudio = audioTrack;
-            trackPos = audioTrack ? aCount : vCount;
-        }
-    }
-    if (isAudio) {
-        if (aCount > vCount) {
-            if (trackPos - 1 > aCount - vCount) {
-                // We have more audio tracks than video tracks
-                return (aCount - vCount + 1) + 2 * (trackPos - (aCount - vCount + 1));
+            typeIndex.push_back(vCount++);
+            if (!unpairedAudio.empty()) {
+                layout.mirrorId = unpairedAudio.back();
+                m_trackLayout[unpairedAudio.back()].mirrorId = tid;
+                unpairedAudio.pop_back();
+            }
+        }
+        m_trackLayout[tid] = layout;
+    }
+    int position = 0;
+    for (const auto &track : m_allTracks) {
+        TrackLayout &layout = m_trackLayout[track->getId()];
+        const bool audio = track->isAudioTrack();
+        const int index = typeIndex[size_t(position)];
+        // Separated: A2, A1, V1, V2
+        layout.sortValue[1] = position + 1;
+        // Separated: A1, A2, V1, V2
+        layout.sortValue[2] = audio ? aCount - index : aCount + index + 1;
+        // Mixed: A1, V1, A2, V2. Position counted from the top among the tracks of the same type
+        const int trackPos = audio ? aCount - index : vCount - index;
+        if (audio) {
+            if (aCount > vCount) {
+                if (trackPos - 1 > aCount - vCount) {
+                    // We have more audio tracks than video tracks
+                    layout.sortValue[0] = (aCount - vCount + 1) + 2 * (trackPos - (aCount - vCount + 1));
+                } else {
+                    layout.sortValue[0] = trackPos;
+                }
+            } else {
+                layout.sortValue[0] = 2 * trackPos;
             }
-            return trackPos;
+        } else {
+            layout.sortValue[0] = 2 * (vCount + 1 - trackPos) + 1;
         }
-        return 2 * trackPos;
+        position++;
     }
-    return 2 * (vCount + 1 - trackPos) + 1;
 }
 
 QList<int> TimelineModel::getLowerTracksId(int trackId, TrackType type) const
@@ -587,24 +586,11 @@ int TimelineModel::getMirrorVideoTrackId(int trackId) const
 {
     READ_LOCK();
     Q_ASSERT(isTrack(trackId));
-    auto it = m_iteratorTable.at(trackId);
-    if (!(*it)->isAudioTrack()) {
+    if (!getTrackById_const(trackId)->isAudioTrack()) {
         // we expected an audio track...
         return -1;
     }
-    int count = 0;
-    while (it != m_allTracks.cend()) {
-        if ((*it)->isAudioTrack()) {
-            count++;
-        } else {
-            count--;
-            if (count == 0) {
-                return (*it)->getId();
-            }
-        }
-        ++it;
-    }
-    return -1;
+    return m_trackLayout.at(trackId).mirrorId;
 }
 
 int TimelineModel::getMirrorTrackId(int trackId) const
@@ -619,28 +605,12 @@ int TimelineModel::getMirrorAudioTrackId(int trackId) const
 {
     READ_LOCK();
     Q_ASSERT(isTrack(trackId));
-    auto it = m_iteratorTable.at(trackId);
-    if ((*it)->isAudioTrack()) {
+    if (getTrackById_const(trackId)->isAudioTrack()) {
         // we expected a video track...
         qWarning() << "requesting mirror audio track for audio track";
         return -1;
     }
-    int count = 0;
-    while (it != m_allTracks.cbegin()) {
-        if (!(*it)->isAudioTrack()) {
-            count++;
-        } else {
-            count--;
-            if (count == 0) {
-                return (*it)->getId();
-            }
-        }
-        --it;
-    }
-    if ((*it)->isAudioTrack() && count == 1) {
-        return (*it)->getId();
-    }
-    return -1;
+    return m_trackLayout.at(trackId).mirrorId;
 }
 
 void TimelineModel::setEditMode(TimelineMode::EditMode mode)
@@ -4810,12 +4780,17 @@ void TimelineModel::registerTrack(std::shared_ptr<TrackModel> track, int pos, bo
     // we now insert in the list
     auto posIt = m_allTracks.begin();
     std::advance(posIt, pos);
-    beginInsertRows(QModelIndex(), pos, pos);
+    if (!m_bulkLoading) {
+        beginInsertRows(QModelIndex(), pos, pos);
+    }
     auto it = m_allTracks.insert(posIt, std::move(track));
     // it now contains the iterator to the inserted element, we store it
     Q_ASSERT(m_iteratorTable.count(id) == 0); // check that id is not used (shouldn't happen)
     m_iteratorTable[id] = it;
-    endInsertRows();
+    updateTrackLayout();
+    if (!m_bulkLoading) {
+        endInsertRows();
+    }
     int cache = int(QThread::idealThreadCount()) + int(m_allTracks.size() + 1) * 2;
     mlt_service_cache_set_size(nullptr, "producer_avformat", qMax(4, cache));
 }
@@ -4844,7 +4819,7 @@ Fun TimelineModel::deregisterTrack_lambda(int id)
         }
         auto it = m_iteratorTable[id];    // iterator to the element
         int index = getTrackPosition(id); // compute index in list
-        if (!m_closing) {
+        if (!m_closing && !m_bulkLoading) {
             // send update to the model
             beginRemoveRows(QModelIndex(), index, index);
         }
@@ -4854,7 +4829,8 @@ Fun TimelineModel::deregisterTrack_lambda(int id)
         m_allTracks.erase(it);
         // clean table
         m_iteratorTable.erase(id);
-        if (!m_closing) {
+        updateTrackLayout();
+        if (!m_closing && !m_bulkLoading) {
             // Finish operation
             endRemoveRows();
             int cache = int(QThread::idealThreadCount()) + int(m_allTracks.size() + 1) * 2;
@@ -5125,6 +5101,20 @@ std::unordered_set<int> TimelineModel::getGroupElements(int clipId)
     return m_groups->getLeaves(groupId);
 }
 
+void TimelineModel::beginBulkLoad()
+{
+    // The rows inserted until endBulkLoad are not notified, so the views must not query the model meanwhile
+    beginResetModel();
+    m_bulkLoading = true;
+}
+
+void TimelineModel::endBulkLoad()
+{
+    m_bulkLoading = false;
+    updateDuration();
+    endResetModel();
+}
+
 bool TimelineModel::requestReset(Fun &undo, Fun &redo)
 {
     std::vector<int> all_ids;
@@ -683,6 +683,12 @@ public:
     /** @brief Removes all the elements on the timeline (tracks and clips)
      */
     bool requestReset(Fun &undo, Fun &redo);
+    /** @brief Starts building the timeline from a project. The model is reset until endBulkLoad, so inserted tracks and clips are not
+       notified to the view, don't refresh the monitor and don't update the timeline duration
+    */
+    void beginBulkLoad();
+    /** @brief Updates the duration and ends the model reset once all the clips of the project are inserted */
+    void endBulkLoad();
     /** @brief Updates the current the pointer to the current undo_stack
        Must be called for example when the doc change
     */
@@ -934,6 +940,9 @@ protected:
      */
     Fun deregisterTrack_lambda(int id);
 
+    /** @brief Recomputes the position, mirror track and sort values of all tracks. Must be called whenever a track is inserted or removed */
+    void updateTrackLayout();
+
     /** @brief Return a lambda that deregisters and destructs the clip with given id.
        Note that the clip must already be deleted from its track and groups.
      */
@@ -1037,6 +1046,18 @@ protected:
     std::unordered_map<int, std::list<std::shared_ptr<TrackModel>>::iterator>
         m_iteratorTable; // this logs the iterator associated which each track id. This allows easy access of a track based on its id.
 
+    /** @brief Values derived from the order of the tracks, computed once by updateTrackLayout so that the track queries don't walk the track list */
+    struct TrackLayout
+    {
+        int position;
+        int mirrorId;
+        /** @brief The values returned by getTrackSortValue for each separated mode */
+        int sortValue[3];
+    };
+    std::unordered_map<int, TrackLayout> m_trackLayout;
+    /** @brief The track ids in the order of the tracks */
+    std::vector<int> m_trackOrder;
+
     std::unordered_map<int, std::shared_ptr<ClipModel>> m_allClips; // the keys are the clip id, and the values are the corresponding pointers
 
     std::unordered_map<int, std::shared_ptr<CompositionModel>>
@@ -1083,6 +1104,8 @@ protected:
     QString m_visibleSequenceName;
     /** @brief True if we are selecting a single item in a group */
     bool m_singleSelectionMode{false};
+    /** @brief True while the timeline is built by beginBulkLoad / endBulkLoad */
+    bool m_bulkLoading{false};
 
     // what follows are some virtual function that corresponds to the QML. They are implemented in TimelineItemModel
 protected:
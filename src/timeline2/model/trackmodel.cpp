@@ -19,6 +19,7 @@
 #include "timelinemodel.hpp"
 #include <QDebug>
 #include <QModelIndex>
+#include <algorithm>
 #include <memory>
 #include <mlt++/MltTransition.h>
 
@@ -191,6 +192,7 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
         if (auto ptr = m_parent.lock()) {
             std::shared_ptr<ClipModel> clip = ptr->getClipPtr(clipId);
             m_allClips[clip->getId()] = clip; // store clip
+            invalidateIndex(clipId);
             // update clip position and track
             clip->setPosition(position);
             if (finalMove) {
@@ -200,7 +202,7 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
             int new_out = new_in + clip->getPlaytime();
             ptr->m_snaps->addPoint(new_in);
             ptr->m_snaps->addPoint(new_out);
-            if (updateView) {
+            if (updateView && !ptr->m_bulkLoading) {
                 int clip_index = getRowfromClip(clipId);
                 ptr->_beginInsertRows(ptr->makeTrackIndexFromID(m_id), clip_index, clip_index);
                 ptr->_endInsertRows();
@@ -262,7 +264,7 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
                 m_playlists[target_playlist].consolidate_blanks();
                 m_playlists[target_playlist].unlock();
                 field->unblock();
-                if (finalMove && !groupMove) {
+                if (finalMove && !groupMove && !ptr->m_bulkLoading) {
                     ptr->updateDuration();
                 }
                 return index != -1 && end_function(target_playlist);
@@ -425,10 +427,12 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
         int target_track = m_allClips[clipId]->getSubPlaylistIndex();
         auto clip_loc = getClipIndexAt(clip_position, target_track);
         if (updateView) {
-            int old_clip_index = getRowfromClip(clipId);
             auto ptr = m_parent.lock();
-            ptr->_beginRemoveRows(ptr->makeTrackIndexFromID(getId()), old_clip_index, old_clip_index);
-            ptr->_endRemoveRows();
+            if (!ptr->m_bulkLoading) {
+                int old_clip_index = getRowfromClip(clipId);
+                ptr->_beginRemoveRows(ptr->makeTrackIndexFromID(getId()), old_clip_index, old_clip_index);
+                ptr->_endRemoveRows();
+            }
         }
         int target_clip = clip_loc.second;
         // lock MLT playlist so that we don't end up with invalid frames in monitor
@@ -443,13 +447,14 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
             m_allClips[clipId]->setCurrentTrackId(-1);
             // m_allClips[clipId]->setSubPlaylistIndex(-1);
             m_allClips.erase(clipId);
+            invalidateIndex(clipId);
             delete prod;
             field->unblock();
             m_playlists[target_track].unlock();
             if (auto ptr = m_parent.lock()) {
                 ptr->m_snaps->removePoint(old_in);
                 ptr->m_snaps->removePoint(old_out);
-                if (finalMove && !ptr->m_closing) {
+                if (finalMove && !ptr->m_closing && !ptr->m_bulkLoading) {
                     if (!audioOnly && !isAudioTrack()) {
                         Q_EMIT ptr->invalidateZone(old_in, old_out);
                     }
@@ -458,7 +463,7 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
                         ptr->updateDuration();
                     }
                 }
-                if (!audioOnly && !isHidden() && !isAudioTrack()) {
+                if (!audioOnly && !isHidden() && !isAudioTrack() && !ptr->m_bulkLoading) {
                     // only refresh monitor if not an audio track and not hidden
                     ptr->checkRefresh(old_in, old_out);
                 }
@@ -670,7 +675,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
     if (!isHidden() && !isAudioTrack()) {
         checkRefresh = true;
     }
-    auto update_snaps = [old_in, old_out, checkRefresh, right, this](int new_in, int new_out) {
+    auto update_snaps = [clipId, old_in, old_out, checkRefresh, right, this](int new_in, int new_out) {
+        // The playlist cut was resized
+        invalidateIndex(clipId);
         if (auto ptr = m_parent.lock()) {
             if (right) {
                 ptr->m_snaps->removePoint(old_out);
@@ -834,31 +841,164 @@ int TrackModel::getId() const
     return m_id;
 }
 
+template <typename F> void TrackModel::SpanIndex::forEach(int in, int out, F func) const
+{
+    // First span that can reach in, and end of the spans starting before out
+    auto first = std::lower_bound(maxEnd.cbegin(), maxEnd.cend(), in) - maxEnd.cbegin();
+    auto last = std::upper_bound(spans.cbegin(), spans.cend(), out, [](int pos, const ItemSpan &span) { return pos < span.start; }) - spans.cbegin();
+    for (auto i = first; i < last; ++i) {
+        const ItemSpan &span = spans[size_t(i)];
+        if (span.end >= in && !func(span)) {
+            return;
+        }
+    }
+}
+
+void TrackModel::invalidateIndex(int itemId) const
+{
+    m_clipIndex.invalidate(itemId);
+    m_compositionIndex.invalidate(itemId);
+}
+
+void TrackModel::SpanIndex::invalidate(int itemId)
+{
+    QMutexLocker lock(&pendingMutex);
+    if (itemId < 0) {
+        outdated = true;
+    } else if (!outdated) {
+        pending.push_back(itemId);
+    }
+}
+
+template <typename Items> void TrackModel::SpanIndex::rebuild(const Items &items)
+{
+    spans.clear();
+    spans.reserve(items.size());
+    starts.clear();
+    for (const auto &item : items) {
+        int pos = item.second->getPosition();
+        spans.push_back({pos, pos + item.second->getPlaytime() - 1, item.first});
+        starts[item.first] = pos;
+    }
+    std::sort(spans.begin(), spans.end(), spanLess);
+    updateMaxEnd(0);
+}
+
+template <typename Items> void TrackModel::SpanIndex::update(const Items &items)
+{
+    std::vector<int> changed;
+    bool full = false;
+    {
+        // Take the changes first, so that a change made during the update is applied by the next one
+        QMutexLocker lock(&pendingMutex);
+        full = outdated;
+        outdated = false;
+        changed.swap(pending);
+    }
+    if (full || changed.size() > maxPendingChanges) {
+        rebuild(items);
+        return;
+    }
+    if (changed.empty()) {
+        return;
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    // Spans before this one are not affected by the changes
+    size_t firstChanged = spans.size();
+    for (int id : changed) {
+        auto start = starts.find(id);
+        if (start != starts.end()) {
+            auto span = std::lower_bound(spans.begin(), spans.end(), ItemSpan{start->second, 0, id}, spanLess);
+            if (span != spans.end() && span->id == id) {
+                firstChanged = qMin(firstChanged, size_t(span - spans.begin()));
+                spans.erase(span);
+            }
+            starts.erase(start);
+        }
+        auto item = items.find(id);
+        if (item != items.end()) {
+            int pos = item->second->getPosition();
+            const ItemSpan added{pos, pos + item->second->getPlaytime() - 1, id};
+            auto span = spans.insert(std::lower_bound(spans.begin(), spans.end(), added, spanLess), added);
+            firstChanged = qMin(firstChanged, size_t(span - spans.begin()));
+            starts[id] = pos;
+        }
+    }
+    updateMaxEnd(firstChanged);
+}
+
+bool TrackModel::SpanIndex::spanLess(const ItemSpan &a, const ItemSpan &b)
+{
+    return a.start < b.start || (a.start == b.start && a.id < b.id);
+}
+
+void TrackModel::SpanIndex::updateMaxEnd(size_t from)
+{
+    maxEnd.resize(spans.size());
+    int end = from > 0 ? maxEnd[from - 1] : INT_MIN;
+    for (size_t i = from; i < spans.size(); ++i) {
+        end = qMax(end, spans[i].end);
+        maxEnd[i] = end;
+    }
+}
+
+const TrackModel::SpanIndex &TrackModel::clipIndex() const
+{
+    m_clipIndex.update(m_allClips);
+    return m_clipIndex;
+}
+
+const TrackModel::SpanIndex &TrackModel::compositionIndex() const
+{
+    m_compositionIndex.update(m_allCompositions);
+    return m_compositionIndex;
+}
+
 int TrackModel::getClipByStartPosition(int position) const
 {
     READ_LOCK();
-    for (auto &clip : m_allClips) {
-        if (clip.second->getPosition() == position) {
-            return clip.second->getId();
+    QMutexLocker lock(&m_indexMutex);
+    int cid = -1;
+    clipIndex().forEach(position, position, [&cid, position](const ItemSpan &span) {
+        if (span.start == position) {
+            cid = span.id;
+            return false;
         }
-    }
-    return -1;
+        return true;
+    });
+    return cid;
 }
 
 int TrackModel::getClipByPosition(int position, int playlist)
 {
     READ_LOCK();
-    QSharedPointer<Mlt::Producer> prod(nullptr);
-    if ((playlist == 0 || playlist == -1) && m_playlists[0].count() > 0) {
-        prod = QSharedPointer<Mlt::Producer>(m_playlists[0].get_clip_at(position));
-    }
-    if (playlist != 0 && (!prod || prod->is_blank()) && m_playlists[1].count() > 0) {
-        prod = QSharedPointer<Mlt::Producer>(m_playlists[1].get_clip_at(position));
+    int cid = -1;
+    int found = 0;
+    if (playlist == -1) {
+        // Outside of mixes, a single clip covers a position and we don't need to look into the playlists
+        QMutexLocker lock(&m_indexMutex);
+        clipIndex().forEach(position, position, [&cid, &found](const ItemSpan &span) {
+            cid = span.id;
+            return ++found < 2;
+        });
     }
-    if (!prod || prod->is_blank()) {
+    if (found == 0 && playlist == -1) {
         return -1;
     }
-    int cid = prod->get_int("_kdenlive_cid");
+    if (found != 1) {
+        QSharedPointer<Mlt::Producer> prod(nullptr);
+        if ((playlist == 0 || playlist == -1) && m_playlists[0].count() > 0) {
+            prod = QSharedPointer<Mlt::Producer>(m_playlists[0].get_clip_at(position));
+        }
+        if (playlist != 0 && (!prod || prod->is_blank()) && m_playlists[1].count() > 0) {
+            prod = QSharedPointer<Mlt::Producer>(m_playlists[1].get_clip_at(position));
+        }
+        if (!prod || prod->is_blank()) {
+            return -1;
+        }
+        cid = prod->get_int("_kdenlive_cid");
+    }
     if (playlist == -1) {
         if (hasStartMix(cid)) {
             if (position < m_allClips[cid]->getPosition() + m_allClips[cid]->getMixCutPosition()) {
@@ -892,16 +1032,14 @@ QSharedPointer<Mlt::Producer> TrackModel::getClipProducer(int clipId)
 int TrackModel::getCompositionByPosition(int position)
 {
     READ_LOCK();
-    for (const auto &comp : m_compoPos) {
-        if (comp.first == position) {
-            return comp.second;
-        } else if (comp.first < position) {
-            if (comp.first + m_allCompositions[comp.second]->getPlaytime() >= position) {
-                return comp.second;
-            }
-        }
-    }
-    return -1;
+    QMutexLocker lock(&m_indexMutex);
+    // A composition is also found on the frame following its end
+    int compoId = -1;
+    compositionIndex().forEach(position - 1, position, [&compoId](const ItemSpan &span) {
+        compoId = span.id;
+        return false;
+    });
+    return compoId;
 }
 
 int TrackModel::getClipByRow(int row) const
@@ -918,17 +1056,12 @@ int TrackModel::getClipByRow(int row) const
 std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
 {
     READ_LOCK();
+    QMutexLocker lock(&m_indexMutex);
     std::unordered_set<int> ids;
-    for (const auto &clp : m_allClips) {
-        int pos = clp.second->getPosition();
-        int length = clp.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
-            ids.insert(clp.first);
-        }
-    }
+    clipIndex().forEach(position, end > -1 ? end - 1 : INT_MAX, [&ids](const ItemSpan &span) {
+        ids.insert(span.id);
+        return true;
+    });
     return ids;
 }
 
@@ -943,18 +1076,12 @@ std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end
 {
     READ_LOCK();
     // TODO: this function doesn't take into accounts the fact that there are two tracks
+    QMutexLocker lock(&m_indexMutex);
     std::unordered_set<int> ids;
-    for (const auto &compo : m_allCompositions) {
-        int pos = compo.second->getPosition();
-        int length = compo.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
-
-            ids.insert(compo.first);
-        }
-    }
+    compositionIndex().forEach(position, end > -1 ? end - 1 : INT_MAX, [&ids](const ItemSpan &span) {
+        ids.insert(span.id);
+        return true;
+    });
     return ids;
 }
 
@@ -1373,7 +1500,8 @@ Fun TrackModel::requestCompositionResize_lambda(int compoId, int in, int out, bo
         out = in + old_out - old_in;
     }
 
-    auto update_snaps = [old_in, old_out, logUndo, this](int new_in, int new_out) {
+    auto update_snaps = [compoId, old_in, old_out, logUndo, this](int new_in, int new_out) {
+        invalidateIndex(compoId);
         if (auto ptr = m_parent.lock()) {
             ptr->m_snaps->removePoint(old_in);
             ptr->m_snaps->removePoint(old_out + 1);
@@ -1483,6 +1611,7 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
         m_allCompositions[compoId]->setCurrentTrackId(-1);
         m_allCompositions.erase(compoId);
         m_compoPos.erase(old_in);
+        invalidateIndex(compoId);
         ptr->m_snaps->removePoint(old_in);
         ptr->m_snaps->removePoint(old_out);
         if (finalMove) {
@@ -1525,6 +1654,7 @@ Fun TrackModel::requestCompositionInsertion_lambda(int compoId, int position, bo
             if (auto ptr = m_parent.lock()) {
                 std::shared_ptr<CompositionModel> composition = ptr->getCompositionPtr(compoId);
                 m_allCompositions[composition->getId()] = composition; // store clip
+                invalidateIndex(compoId);
                 // update clip position and track
                 composition->setCurrentTrackId(getId());
                 int new_in = position;
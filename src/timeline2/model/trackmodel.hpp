@@ -7,6 +7,7 @@
 
 #include "definitions.h"
 #include "undohelper.hpp"
+#include <QMutex>
 #include <QReadWriteLock>
 #include <QSharedPointer>
 #include <memory>
@@ -15,6 +16,7 @@
 #include <mlt++/MltTractor.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 class TimelineModel;
 class ClipModel;
@@ -291,6 +293,10 @@ protected:
 
     /** @brief Returns the composition id on this track starting position requested, or -1 if not found */
     int getCompositionByPosition(int position);
+
+    /** @brief Records that item @param itemId of the track was inserted, removed, moved or resized, its entry in the
+        position index is updated on the next query. Without an id, the whole index is rebuilt */
+    void invalidateIndex(int itemId = -1) const;
     /** @brief Add a track effect */
     bool addEffect(const QString &effectId);
 
@@ -369,6 +375,48 @@ private:
      */
     std::map<int, int> m_compoPos;
 
+    /** @brief The frames covered by an item of the track */
+    struct ItemSpan
+    {
+        int start;
+        int end;
+        int id;
+    };
+    /** @brief Items sorted by position, so that the items at a position or in a range are found with binary searches.
+        maxEnd[i] is the highest end of spans[0..i]: since items can overlap (mixes, compositions), it gives the first span
+        that can reach a position. Changed items are recorded and their spans are moved in place on the next query,
+        the index is only sorted again when it is reset or after many changes.
+     */
+    struct SpanIndex
+    {
+        std::vector<ItemSpan> spans;
+        std::vector<int> maxEnd;
+        /** @brief The start of the span of each indexed item, to find it in spans */
+        std::unordered_map<int, int> starts;
+        // Changes are recorded without locking m_indexMutex, since items invalidate the index while holding their own lock
+        QMutex pendingMutex;
+        std::vector<int> pending;
+        bool outdated{true};
+        /** @brief Calls @param func with each span intersecting [in, out], in position order, until it returns false */
+        template <typename F> void forEach(int in, int out, F func) const;
+        /** @brief Records a change of item @param itemId, or of all items if it is negative */
+        void invalidate(int itemId);
+        /** @brief Applies the recorded changes, m_indexMutex must be locked */
+        template <typename Items> void update(const Items &items);
+        template <typename Items> void rebuild(const Items &items);
+        void updateMaxEnd(size_t from);
+        static bool spanLess(const ItemSpan &a, const ItemSpan &b);
+        // Above this number of changes, sorting all the spans again is cheaper than moving them one by one
+        static constexpr size_t maxPendingChanges = 32;
+    };
+    mutable QMutex m_indexMutex;
+    mutable SpanIndex m_clipIndex;
+    mutable SpanIndex m_compositionIndex;
+    /** @brief Returns the up to date index of the clips, m_indexMutex must be locked */
+    const SpanIndex &clipIndex() const;
+    /** @brief Returns the up to date index of the compositions, m_indexMutex must be locked */
+    const SpanIndex &compositionIndex() const;
+
     /// This is a lock that ensures safety in case of concurrent access
     mutable QReadWriteLock m_lock;
     void reverseCompositionXml(const QString &composition, QDomElement xml);
@@ -14,17 +14,213 @@
 #include "mainwindow.h"
 #include "monitor/monitor.h"
 #include "profiles/profilemodel.hpp"
+#include "render/rendersegments.h"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
 #include "xml/xml.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
-#include <QCollator>
 #include <QCryptographicHash>
+#include <QDateTime>
+#include <QDomDocument>
+#include <QHash>
 #include <QMutexLocker>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mlt++/Mlt.h>
+
+namespace {
+// Unused chunks kept in the undo folder in addition to the rendered ones
+constexpr int extraUnusedChunks = 100;
+
+/** @class ChunkHasher
+    @brief Hashes what the tractor saved in an MLT document renders in a range of frames.
+    It only reads the document, so that the chunks can be named in another thread while the timeline is edited.
+ */
+class ChunkHasher
+{
+public:
+    explicit ChunkHasher(const QDomDocument &doc)
+        : m_fps(RenderSegments::frameRate(doc))
+    {
+        const QStringList serviceTags = {QStringLiteral("producer"), QStringLiteral("chain"), QStringLiteral("playlist"), QStringLiteral("tractor")};
+        for (QDomElement child = doc.documentElement().firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+            if (serviceTags.contains(child.tagName())) {
+                // MLT renders the last service of the document
+                m_root = child.attribute(QStringLiteral("id"));
+                m_services.insert(m_root, child);
+            }
+        }
+    }
+
+    /** @brief Adds to @param hash everything rendered between frames @param start and @param end */
+    void hashRange(QCryptographicHash &hash, int start, int end) const { hashService(hash, m_services.value(m_root), start, end); }
+
+private:
+    double m_fps;
+    QString m_root;
+    QHash<QString, QDomElement> m_services;
+
+    int frames(const QDomElement &element, const QString &name) const { return RenderSegments::timeToFrames(element.attribute(name), m_fps); }
+
+    static QString property(const QDomElement &element, const QString &name)
+    {
+        for (QDomElement child = element.firstChildElement(QStringLiteral("property")); !child.isNull();
+             child = child.nextSiblingElement(QStringLiteral("property"))) {
+            if (child.attribute(QStringLiteral("name")) == name) {
+                return child.text();
+            }
+        }
+        return QString();
+    }
+
+    /** @brief Adds the properties that influence rendering to @param hash, in a stable order.
+        @param withLength false to skip the in, out and length properties of services whose duration follows the timeline duration */
+    static void hashProperties(QCryptographicHash &hash, const QDomElement &element, bool withLength = true)
+    {
+        QVector<QPair<QString, QString>> values;
+        if (withLength) {
+            for (const QString &name : {QStringLiteral("in"), QStringLiteral("out")}) {
+                if (element.hasAttribute(name)) {
+                    values.append({name, element.attribute(name)});
+                }
+            }
+        }
+        for (QDomElement child = element.firstChildElement(QStringLiteral("property")); !child.isNull();
+             child = child.nextSiblingElement(QStringLiteral("property"))) {
+            const QString name = child.attribute(QStringLiteral("name"));
+            // Private MLT properties and Kdenlive metadata don't change the rendered frames
+            if (name.isEmpty() || name.startsWith(QLatin1Char('_')) ||
+                (name.startsWith(QLatin1String("kdenlive:")) && name != QLatin1String("kdenlive:file_hash"))) {
+                continue;
+            }
+            if (!withLength && (name == QLatin1String("in") || name == QLatin1String("out") || name == QLatin1String("length"))) {
+                continue;
+            }
+            values.append({name, child.text()});
+        }
+        std::sort(values.begin(), values.end());
+        for (const auto &value : qAsConst(values)) {
+            hash.addData(value.first.toUtf8());
+            hash.addData("=", 1);
+            hash.addData(value.second.toUtf8());
+            hash.addData("\n", 1);
+        }
+    }
+
+    static void hashNumber(QCryptographicHash &hash, int value)
+    {
+        const QByteArray data = QByteArray::number(value) + ';';
+        hash.addData(data);
+    }
+
+    static void hashChildren(QCryptographicHash &hash, const QDomElement &element, const QString &tagName)
+    {
+        for (QDomElement child = element.firstChildElement(tagName); !child.isNull(); child = child.nextSiblingElement(tagName)) {
+            hashProperties(hash, child);
+        }
+    }
+
+    void hashService(QCryptographicHash &hash, const QDomElement &service, int start, int end) const
+    {
+        const QString tagName = service.tagName();
+        if (tagName == QLatin1String("tractor")) {
+            hashProperties(hash, service, false);
+            QDomElement tracks = service.firstChildElement(QStringLiteral("multitrack"));
+            if (tracks.isNull()) {
+                tracks = service;
+            }
+            int index = 0;
+            for (QDomElement track = tracks.firstChildElement(QStringLiteral("track")); !track.isNull();
+                 track = track.nextSiblingElement(QStringLiteral("track")), ++index) {
+                const QDomElement producer = m_services.value(track.attribute(QStringLiteral("producer")));
+                const QString playlistId = property(producer, QStringLiteral("kdenlive:playlistid"));
+                if (producer.isNull() || playlistId == QLatin1String("timeline_preview") || playlistId == QLatin1String("timeline_overlay")) {
+                    continue;
+                }
+                hashNumber(hash, index);
+                hash.addData(track.attribute(QStringLiteral("hide")).toUtf8());
+                if (producer.tagName() == QLatin1String("tractor") || producer.tagName() == QLatin1String("playlist")) {
+                    hashService(hash, producer, start, end);
+                } else {
+                    // A producer used as track, like the black track, lasts as long as the timeline
+                    hashNumber(hash, qMax(start, frames(producer, QStringLiteral("in"))));
+                    hashNumber(hash, qMin(end, frames(producer, QStringLiteral("out"))));
+                    hashProperties(hash, producer, false);
+                    hashChildren(hash, producer, QStringLiteral("filter"));
+                }
+            }
+            for (QDomElement transition = service.firstChildElement(QStringLiteral("transition")); !transition.isNull();
+                 transition = transition.nextSiblingElement(QStringLiteral("transition"))) {
+                const int in = frames(transition, QStringLiteral("in"));
+                const int out = frames(transition, QStringLiteral("out"));
+                // Transitions without out point are always active
+                if (out <= 0 || (in <= end && out >= start)) {
+                    hashProperties(hash, transition, property(transition, QStringLiteral("always_active")).toInt() == 0);
+                }
+            }
+        } else if (tagName == QLatin1String("playlist")) {
+            hashProperties(hash, service, false);
+            int position = 0;
+            for (QDomElement child = service.firstChildElement(); !child.isNull() && position <= end; child = child.nextSiblingElement()) {
+                if (child.tagName() == QLatin1String("blank")) {
+                    // Blanks render nothing, how they are split does not matter
+                    position += frames(child, QStringLiteral("length"));
+                    continue;
+                }
+                if (child.tagName() != QLatin1String("entry")) {
+                    continue;
+                }
+                const int in = frames(child, QStringLiteral("in"));
+                const int length = frames(child, QStringLiteral("out")) - in + 1;
+                if (position + length > start) {
+                    hashNumber(hash, position);
+                    hashNumber(hash, length);
+                    hashNumber(hash, in);
+                    hashProperties(hash, child, false);
+                    hashChildren(hash, child, QStringLiteral("filter"));
+                    // The frames of the source used in the chunk
+                    const QDomElement producer = m_services.value(child.attribute(QStringLiteral("producer")));
+                    hashService(hash, producer, in + qMax(0, start - position), in + qMin(length - 1, end - position));
+                }
+                position += length;
+            }
+        } else if (tagName == QLatin1String("chain")) {
+            hashProperties(hash, service);
+            hashChildren(hash, service, QStringLiteral("link"));
+        } else if (!service.isNull()) {
+            hashProperties(hash, service);
+        }
+        hashChildren(hash, service, QStringLiteral("filter"));
+    }
+};
+
+/** @brief Returns the file name of each of the @param chunks of @param chunkSize frames for the content of the MLT document @param scene.
+    @param settings are the rendering settings that are not saved in the document */
+QMap<int, QString> chunkFileNames(const QString &scene, const QList<int> &chunks, int chunkSize, const QByteArray &settings, const QString &extension)
+{
+    QMap<int, QString> fileNames;
+    QFile file(scene);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file)) {
+        return fileNames;
+    }
+    const ChunkHasher hasher(doc);
+    for (int frame : chunks) {
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        hash.addData(settings);
+        hasher.hashRange(hash, frame, frame + chunkSize - 1);
+        fileNames.insert(frame, QStringLiteral("%1-%2.%3").arg(frame).arg(QString::fromLatin1(hash.result().toHex())).arg(extension));
+    }
+    return fileNames;
+}
+} // namespace
 
 PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *parent)
     : QObject(parent)
@@ -36,6 +232,9 @@ PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *paren
     , m_warnOnCrash(true)
     , m_previewTrackIndex(-1)
     , m_initialized(false)
+    , m_hashing(false)
+    , m_hashAborted(false)
+    , m_contentVersion(0)
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
@@ -56,6 +255,7 @@ PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *paren
 
 PreviewManager::~PreviewManager()
 {
+    m_previewThread.waitForFinished();
     if (m_initialized) {
         abortRendering();
         if (m_undoDir.dirName() == QLatin1String("undo")) {
@@ -114,9 +314,17 @@ bool PreviewManager::initialize()
         pCore->displayMessage(i18n("Something is wrong with cache folders"), ErrorMessage);
         return false;
     }
+    // Older versions kept the chunks invalidated by each command in a folder named after its undo index
+    const QStringList undoFolders = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &folder : undoFolders) {
+        bool isIndex = false;
+        folder.toInt(&isIndex);
+        if (isIndex) {
+            QDir(m_undoDir.absoluteFilePath(folder)).removeRecursively();
+        }
+    }
 
     connect(this, &PreviewManager::cleanupOldPreviews, this, &PreviewManager::doCleanupOldPreviews);
-    connect(doc, &KdenliveDoc::removeInvalidUndo, this, &PreviewManager::slotRemoveInvalidUndo, Qt::DirectConnection);
     m_previewTimer.setSingleShot(true);
     m_previewTimer.setInterval(3000);
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
@@ -170,9 +378,11 @@ void PreviewManager::loadChunks(QVariantList previewChunks, QVariantList dirtyCh
         }
         int position = playlist.clip_start(i);
         if (previewChunks.contains(QString::number(position))) {
-            if (existingChuncks.contains(QString("%1.%2").arg(position).arg(m_extension))) {
-                clip.reset(playlist.get_clip(i));
+            clip.reset(playlist.get_clip(i));
+            const QString fileName = QFileInfo(QString::fromUtf8(clip->parent().get("resource"))).fileName();
+            if (existingChuncks.contains(fileName)) {
                 m_renderedChunks << position;
+                m_chunkFiles.insert(position, fileName);
                 m_previewTrack->insert_at(position, clip.get(), 1);
             } else {
                 dirtyChunks << position;
@@ -204,6 +414,7 @@ void PreviewManager::deletePreviewTrack()
     m_previewTrack = nullptr;
     m_dirtyChunks.clear();
     m_renderedChunks.clear();
+    m_chunkFiles.clear();
     Q_EMIT dirtyChunksChanged();
     Q_EMIT renderedChunksChanged();
     m_tractor->unlock();
@@ -324,83 +535,70 @@ void PreviewManager::invalidatePreviews()
         m_previewTimer.stop();
         timer = true;
     }
-    KdenliveDoc *doc = pCore->currentDoc();
-    int stackIx = doc->commandStack()->index();
-    int stackMax = doc->commandStack()->count();
-    if (stackIx == stackMax && !m_undoDir.exists(QString::number(stackIx - 1))) {
-        // We just added a new command in stack, archive existing chunks
-        int ix = stackIx - 1;
-        m_undoDir.mkdir(QString::number(ix));
-        bool foundPreviews = false;
-        for (const auto &i : m_dirtyChunks) {
-            QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(ix).arg(current))) {
-                foundPreviews = true;
-            }
-        }
-        if (!foundPreviews) {
-            // No preview files found, remove undo folder
-            m_undoDir.rmdir(QString::number(ix));
-        } else {
-            // new chunks archived, cleanup old ones
-            Q_EMIT cleanupOldPreviews();
+    pCore->currentDoc()->setModified(true);
+    if (timer) {
+        m_previewTimer.start();
+    }
+}
+
+void PreviewManager::releaseChunk(int frame)
+{
+    const QString fileName = m_chunkFiles.take(frame);
+    if (fileName.isEmpty() || !m_cacheDir.exists(fileName)) {
+        return;
+    }
+    if (!fileName.contains(QLatin1Char('-'))) {
+        // Chunk from an older version, without content hash
+        m_cacheDir.remove(fileName);
+        return;
+    }
+    m_undoDir.remove(fileName);
+    if (m_cacheDir.rename(fileName, QStringLiteral("undo/%1").arg(fileName))) {
+        // The cleanup removes the chunks that were unused for the longest time first
+        QFile file(m_undoDir.absoluteFilePath(fileName));
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
         }
     } else {
-        // Restore existing chunks, delete others
-        // Check if we just undo the last stack action, then backup, otherwise delete
-        bool lastUndo = false;
-        if (stackIx + 1 == stackMax) {
-            if (!m_undoDir.exists(QString::number(stackMax))) {
-                lastUndo = true;
-                bool foundPreviews = false;
-                m_undoDir.mkdir(QString::number(stackMax));
-                for (const auto &i : m_dirtyChunks) {
-                    QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-                    if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(stackMax).arg(current))) {
-                        foundPreviews = true;
-                    }
-                }
-                if (!foundPreviews) {
-                    m_undoDir.rmdir(QString::number(stackMax));
-                }
-            }
-        }
-        bool moveFile = true;
-        QDir tmpDir = m_undoDir;
-        if (!tmpDir.cd(QString::number(stackIx))) {
-            moveFile = false;
-        }
-        QVariantList foundChunks;
-        for (const auto &i : m_dirtyChunks) {
-            QString cacheFileName = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
-            }
-            if (moveFile) {
-                if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
-                    foundChunks << i;
-                } else {
-                    qDebug() << "// ERROR PROCESSE CHUNK: " << i << ", " << cacheFileName;
-                }
-            }
+        m_cacheDir.remove(fileName);
+    }
+}
+
+QVariantList PreviewManager::restoreChunks(const QMap<int, QString> &fileNames)
+{
+    QVariantList foundChunks;
+    if (m_previewTrack == nullptr) {
+        return foundChunks;
+    }
+    m_dirtyMutex.lock();
+    for (const auto &i : qAsConst(m_dirtyChunks)) {
+        const QString fileName = fileNames.value(i.toInt());
+        if (fileName.isEmpty()) {
+            continue;
         }
-        if (!foundChunks.isEmpty()) {
-            std::sort(foundChunks.begin(), foundChunks.end(), chunkSort);
-            m_dirtyMutex.lock();
-            for (auto &ck : foundChunks) {
-                m_dirtyChunks.removeAll(ck);
-                m_renderedChunks << ck;
+        if (m_undoDir.exists(fileName)) {
+            m_cacheDir.remove(fileName);
+            if (!m_cacheDir.rename(QStringLiteral("undo/%1").arg(fileName), fileName)) {
+                continue;
             }
-            m_dirtyMutex.unlock();
-            Q_EMIT dirtyChunksChanged();
-            Q_EMIT renderedChunksChanged();
-            reloadChunks(foundChunks);
+        } else if (!m_cacheDir.exists(fileName)) {
+            continue;
         }
+        m_chunkFiles.insert(i.toInt(), fileName);
+        foundChunks << i;
     }
-    doc->setModified(true);
-    if (timer) {
-        m_previewTimer.start();
+    for (const auto &ck : qAsConst(foundChunks)) {
+        m_dirtyChunks.removeAll(ck);
+        m_renderedChunks << ck;
     }
+    m_dirtyMutex.unlock();
+    if (!foundChunks.isEmpty()) {
+        std::sort(foundChunks.begin(), foundChunks.end(), chunkSort);
+        Q_EMIT dirtyChunksChanged();
+        Q_EMIT renderedChunksChanged();
+        reloadChunks(foundChunks);
+    }
+    return foundChunks;
 }
 
 void PreviewManager::doCleanupOldPreviews()
@@ -408,32 +606,24 @@ void PreviewManager::doCleanupOldPreviews()
     if (m_undoDir.dirName() != QLatin1String("undo")) {
         return;
     }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-
-    // Use QCollator to do a natural sorting so that 10 is after 2
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(dirs.begin(), dirs.end(), [&collator](const QString &file1, const QString &file2) { return collator.compare(file1, file2) < 0; });
-    bool ok;
-    while (dirs.count() > 5) {
-        QDir tmp = m_undoDir;
-        QString dirName = dirs.takeFirst();
-        dirName.toInt(&ok);
-        if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
-        }
+    // Keep enough unused chunks to switch back to another version of the preview zone
+    const int maxUnused = m_renderedChunks.count() + extraUnusedChunks;
+    const QFileInfoList files = m_undoDir.entryInfoList(QDir::Files, QDir::Time);
+    for (int i = maxUnused; i < files.count(); ++i) {
+        m_undoDir.remove(files.at(i).fileName());
     }
 }
 
 void PreviewManager::clearPreviewRange(bool resetZones)
 {
+    m_contentVersion++;
     m_previewGatherTimer.stop();
     abortRendering();
     m_tractor->lock();
     bool hasPreview = m_previewTrack != nullptr;
     QMutexLocker lock(&m_dirtyMutex);
     for (const auto &ix : qAsConst(m_renderedChunks)) {
-        m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+        m_cacheDir.remove(m_chunkFiles.take(ix.toInt()));
         if (!m_dirtyChunks.contains(ix)) {
             m_dirtyChunks << ix;
         }
@@ -466,6 +656,7 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     int startChunk = zone.x() / chunkSize;
     int endChunk = int(rintl(zone.y() / chunkSize));
     QList<int> toRemove;
+    m_contentVersion++;
     QMutexLocker lock(&m_dirtyMutex);
     for (int i = startChunk; i <= endChunk; i++) {
         int frame = i * chunkSize;
@@ -495,15 +686,14 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         m_tractor->lock();
         bool hasPreview = m_previewTrack != nullptr;
         for (int ix : qAsConst(toRemove)) {
-            m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix).arg(m_extension));
-            if (!hasPreview) {
-                continue;
-            }
-            int trackIx = m_previewTrack->get_clip_index_at(ix);
-            if (!m_previewTrack->is_blank(trackIx)) {
-                Mlt::Producer *prod = m_previewTrack->replace_with_blank(trackIx);
-                delete prod;
+            if (hasPreview) {
+                int trackIx = m_previewTrack->get_clip_index_at(ix);
+                if (!m_previewTrack->is_blank(trackIx)) {
+                    Mlt::Producer *prod = m_previewTrack->replace_with_blank(trackIx);
+                    delete prod;
+                }
             }
+            releaseChunk(ix);
         }
         if (hasPreview) {
             m_previewTrack->consolidate_blanks();
@@ -511,6 +701,9 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         Q_EMIT renderedChunksChanged();
         Q_EMIT dirtyChunksChanged();
         m_tractor->unlock();
+        if (!toRemove.isEmpty()) {
+            Q_EMIT cleanupOldPreviews();
+        }
         if (isRendering || KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
@@ -519,6 +712,10 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
 
 void PreviewManager::abortRendering()
 {
+    if (m_hashing) {
+        // Don't render once the chunks are named
+        m_hashAborted = true;
+    }
     if (m_previewProcess.state() == QProcess::NotRunning) {
         return;
     }
@@ -542,6 +739,11 @@ bool PreviewManager::hasDefinedRange() const
 void PreviewManager::startPreviewRender()
 {
     QMutexLocker lock(&m_previewMutex);
+    if (m_hashing) {
+        // The render starts once the chunks are named
+        m_hashAborted = false;
+        return;
+    }
     if (!m_dirtyChunks.isEmpty()) {
         // Abort any rendering
         abortRendering();
@@ -562,10 +764,55 @@ void PreviewManager::startPreviewRender()
             pCore->currentDoc()->getTimeline(m_uuid)->sceneList(m_cacheDir.absolutePath(), sceneList);
         }
         m_previewTimer.stop();
-        doPreviewRender(sceneList);
+        // Name the chunks after their content in the saved scene, in another thread so that the timeline is not locked meanwhile
+        QList<int> chunks;
+        m_dirtyMutex.lock();
+        for (const auto &i : qAsConst(m_dirtyChunks)) {
+            chunks << i.toInt();
+        }
+        m_dirtyMutex.unlock();
+        const int chunkSize = KdenliveSettings::timelinechunks();
+        QByteArray settings = pCore->getCurrentProfilePath().toUtf8() + ';';
+        settings.append(m_consumerParams.join(QLatin1Char(' ')).toUtf8() + ';');
+        settings.append(QByteArray::number(chunkSize) + ';');
+        settings.append(!KdenliveSettings::proxypreview() && pCore->currentDoc()->useProxy() ? "1;" : "0;");
+        const QString extension = m_extension;
+        const int version = m_contentVersion;
+        m_hashing = true;
+        m_previewThread = QtConcurrent::run([this, sceneList, chunks, chunkSize, settings, extension, version]() {
+            const QMap<int, QString> fileNames = chunkFileNames(sceneList, chunks, chunkSize, settings, extension);
+            QMetaObject::invokeMethod(
+                this, [this, sceneList, fileNames, version]() { chunksNamed(sceneList, fileNames, version); }, Qt::QueuedConnection);
+        });
     }
 }
 
+void PreviewManager::chunksNamed(const QString &scene, const QMap<int, QString> &fileNames, int version)
+{
+    m_hashing = false;
+    if (m_hashAborted) {
+        m_hashAborted = false;
+        QFile::remove(scene);
+        return;
+    }
+    if (version != m_contentVersion) {
+        // The timeline or the preview zone changed while naming the chunks
+        QFile::remove(scene);
+        if (!m_previewTimer.isActive()) {
+            startPreviewRender();
+        }
+        return;
+    }
+    // An undo or an edit restoring a previous state can reuse the chunks rendered for that state
+    restoreChunks(fileNames);
+    if (m_dirtyChunks.isEmpty()) {
+        QFile::remove(scene);
+        return;
+    }
+    m_renderFiles = fileNames;
+    doPreviewRender(scene);
+}
+
 void PreviewManager::receivedStderr()
 {
     QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
@@ -573,10 +820,17 @@ void PreviewManager::receivedStderr()
         if (result.startsWith(QLatin1String("START:"))) {
             if (m_previewProcess.state() == QProcess::Running) {
                 workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
+                m_workingChunks << workingPreview;
                 Q_EMIT workingPreviewChanged();
             }
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            // Several workers render in parallel, show the chunk of another worker when one finishes
+            m_workingChunks.removeAll(chunk);
+            if (workingPreview == chunk && !m_workingChunks.isEmpty()) {
+                workingPreview = m_workingChunks.first();
+                Q_EMIT workingPreviewChanged();
+            }
             m_processedChunks++;
             QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
             Q_EMIT previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
@@ -598,8 +852,11 @@ void PreviewManager::doPreviewRender(const QString &scene)
     const QStringList dirtyChunks = getCompressedList(m_dirtyChunks);
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
+    m_workingChunks.clear();
     int chunkSize = KdenliveSettings::timelinechunks();
     QStringList args{QStringLiteral("preview-chunks"),
+                     QStringLiteral("--workers=%1").arg(previewWorkers()),
+                     QStringLiteral("--playhead=%1").arg(pCore->getMonitorPosition()),
                      scene,
                      m_cacheDir.absolutePath(),
                      dirtyChunks.join(QLatin1Char(',')),
@@ -614,14 +871,24 @@ void PreviewManager::doPreviewRender(const QString &scene)
     }
 }
 
+int PreviewManager::previewWorkers()
+{
+    if (KdenliveSettings::previewworkers() > 0) {
+        return KdenliveSettings::previewworkers();
+    }
+    // Each worker encodes with several threads and holds its own copy of the project
+    return qBound(1, QThread::idealThreadCount() / 4, 8);
+}
+
 void PreviewManager::processEnded(int exitCode, QProcess::ExitStatus status)
 {
     const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
     QFile::remove(sceneList);
     if (pCore->window() && (status == QProcess::QProcess::CrashExit || exitCode != 0)) {
         Q_EMIT previewRender(0, m_errorLog, -1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+        // Remove the incomplete chunks of all workers
+        for (int chunk : qAsConst(m_workingChunks)) {
+            const QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
@@ -630,6 +897,7 @@ void PreviewManager::processEnded(int exitCode, QProcess::ExitStatus status)
         // Normal exit and exit code 0: everything okay
         pCore->currentDoc()->previewProgress(1000);
     }
+    m_workingChunks.clear();
     workingPreview = -1;
     m_warnOnCrash = true;
     Q_EMIT workingPreviewChanged();
@@ -646,25 +914,6 @@ void PreviewManager::slotProcessDirtyChunks()
     }
 }
 
-void PreviewManager::slotRemoveInvalidUndo(int ix)
-{
-    QMutexLocker lock(&m_previewMutex);
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
-        // Make sure we delete correct folder
-        return;
-    }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    bool ok;
-    for (const QString &dir : qAsConst(dirs)) {
-        if (dir.toInt(&ok) >= ix && ok) {
-            QDir tmp = m_undoDir;
-            if (tmp.cd(dir)) {
-                tmp.removeRecursively();
-            }
-        }
-    }
-}
-
 void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
     if (m_previewTrack == nullptr) {
@@ -683,7 +932,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
         std::sort(m_renderedChunks.begin(), m_renderedChunks.end(), chunkSort);
         if (start <= m_renderedChunks.last().toInt() && end >= m_renderedChunks.first().toInt()) {
             alreadyRendered = true;
-        } else if (workingPreview >= start && workingPreview <= end) {
+        } else if (std::any_of(m_workingChunks.cbegin(), m_workingChunks.cend(), [start, end](int chunk) { return chunk >= start && chunk <= end; })) {
             alreadyRendered = true;
         }
     }
@@ -708,6 +957,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
                 }
                 Mlt::Producer *prod = m_previewTrack->replace_with_blank(ix);
                 delete prod;
+                releaseChunk(i);
                 QVariant val(i);
                 m_renderedChunks.removeAll(val);
                 if (!m_dirtyChunks.contains(val)) {
@@ -722,6 +972,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
             m_previewTrack->consolidate_blanks();
             Q_EMIT renderedChunksChanged();
             Q_EMIT dirtyChunksChanged();
+            Q_EMIT cleanupOldPreviews();
         }
     } else if (wasInDirtyZone) {
         // Abort rendering, playlist needs to be recreated
@@ -732,6 +983,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
         // Invalidated zone outside our rendered zones
         return;
     }
+    m_contentVersion++;
     m_previewGatherTimer.start();
 }
 
@@ -743,7 +995,7 @@ void PreviewManager::reloadChunks(const QVariantList &chunks)
     m_tractor->lock();
     for (const auto &ix : chunks) {
         if (m_previewTrack->is_blank_at(ix.toInt())) {
-            QString fileName = m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+            QString fileName = m_cacheDir.absoluteFilePath(m_chunkFiles.value(ix.toInt()));
             fileName.prepend(QStringLiteral("avformat:"));
             Mlt::Producer prod(pCore->getProjectProfile(), fileName.toUtf8().constData());
             if (prod.is_valid()) {
@@ -781,12 +1033,22 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
         return;
     }
     if (m_previewTrack->is_blank_at(frame)) {
-        Mlt::Producer prod(pCore->getProjectProfile(), QString("avformat:%1").arg(file).toUtf8().constData());
+        // The renderer names the chunks after their position, rename them after their content
+        QString chunkFile = file;
+        const QString fileName = m_renderFiles.take(frame);
+        if (!fileName.isEmpty()) {
+            m_cacheDir.remove(fileName);
+            if (m_cacheDir.rename(QFileInfo(file).fileName(), fileName)) {
+                chunkFile = m_cacheDir.absoluteFilePath(fileName);
+            }
+        }
+        Mlt::Producer prod(pCore->getProjectProfile(), QString("avformat:%1").arg(chunkFile).toUtf8().constData());
         if (prod.is_valid() && prod.get_length() == KdenliveSettings::timelinechunks()) {
             m_dirtyMutex.lock();
             m_dirtyChunks.removeAll(QVariant(frame));
             m_dirtyMutex.unlock();
             m_renderedChunks << frame;
+            m_chunkFiles.insert(frame, QFileInfo(chunkFile).fileName());
             Q_EMIT renderedChunksChanged();
             prod.set("mlt_service", "avformat-novalidate");
             m_tractor->lock();
@@ -796,8 +1058,8 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
             pCore->currentDoc()->previewProgress(progress);
             pCore->currentDoc()->setModified(true);
         } else {
-            qCDebug(KDENLIVE_LOG) << "* * * INVALID PROD: " << file;
-            corruptedChunk(frame, file);
+            qCDebug(KDENLIVE_LOG) << "* * * INVALID PROD: " << chunkFile;
+            corruptedChunk(frame, chunkFile);
         }
     } else {
         qCDebug(KDENLIVE_LOG) << "* * * NON EMPTY PROD: " << frame;
@@ -908,5 +1170,5 @@ int PreviewManager::addedTracks() const
 
 bool PreviewManager::isRunning() const
 {
-    return workingPreview >= 0 || m_previewProcess.state() != QProcess::NotRunning;
+    return m_hashing || workingPreview >= 0 || m_previewProcess.state() != QProcess::NotRunning;
 }
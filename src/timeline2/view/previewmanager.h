@@ -10,6 +10,7 @@
 
 #include <QDir>
 #include <QFuture>
+#include <QMap>
 #include <QMutex>
 #include <QProcess>
 #include <QTimer>
@@ -30,6 +31,9 @@ class Producer;
     This allow us to get a preview with a smooth playback of our project.
     Only the preview zone is rendered. Once defined, a preview zone shows as a red line below
     the timeline ruler. As chunks are rendered, the zone turns to green.
+    Chunk files are named after their position and a hash of the timeline content in their range,
+    computed from the saved scene in another thread when a render starts. Invalidated chunks are moved
+    to the undo folder, and reused when a render starts after an edit or an undo restored the same content.
  */
 class PreviewManager : public QObject
 {
@@ -70,6 +74,8 @@ public:
     void removeOverlayTrack();
     /** @brief The current preview chunk being processed, -1 if none */
     int workingPreview;
+    /** @brief Number of chunks rendered at the same time */
+    static int previewWorkers();
     /** @brief Returns the list of existing chunks */
     QPair<QStringList, QStringList> previewChunks();
     bool hasOverlayTrack() const;
@@ -101,12 +107,24 @@ private:
     /** @brief: Since some timeline operations generate several invalidate calls, use a timer to get them all. */
     QTimer m_previewGatherTimer;
     bool m_initialized;
+    /** @brief: True while the chunks to render are named in m_previewThread */
+    bool m_hashing;
+    /** @brief: True if the render was aborted while naming its chunks */
+    bool m_hashAborted;
+    /** @brief: Incremented when the timeline content or the preview zone change, to discard outdated chunk names */
+    int m_contentVersion;
     QList<int> m_waitingThumbs;
     QFuture<void> m_previewThread;
     /** @brief: The count of chunks to process - to calculate job progress */
     int m_chunksToRender;
     /** @brief: The count of already processed chunks - to calculate job progress */
     int m_processedChunks;
+    /** @brief: The chunks currently rendered by the preview workers */
+    QList<int> m_workingChunks;
+    /** @brief: The file name of each rendered chunk */
+    QMap<int, QString> m_chunkFiles;
+    /** @brief: The file name of each chunk of the running render, computed before the render starts */
+    QMap<int, QString> m_renderFiles;
     /** @brief: The render process output, useful in case of failure */
     QString m_errorLog;
     /** @brief: After an undo/redo, if we have preview history, use it. */
@@ -115,6 +133,13 @@ private:
     void corruptedChunk(int workingPreview, const QString &fileName);
     /** @brief: Get a compressed list of chunks, like: "0-500,525,575". */
     const QStringList getCompressedList(const QVariantList items) const;
+    /** @brief: A rendered chunk was removed from the preview track, keep its file in the undo folder for later reuse. */
+    void releaseChunk(int frame);
+    /** @brief: Reuse the existing files named @param fileNames of the dirty chunks, returns the reused chunks. */
+    QVariantList restoreChunks(const QMap<int, QString> &fileNames);
+    /** @brief: The dirty chunks were named after their content in @param scene, reuse the existing ones and render the others.
+        @param version is the content version when the scene was saved */
+    void chunksNamed(const QString &scene, const QMap<int, QString> &fileNames, int version);
 
     /** @brief Compare two chunks for usage by std::sort
      * @returns true if @param c1 is less than @param c2
@@ -122,12 +147,10 @@ private:
     static bool chunkSort(const QVariant &c1, const QVariant &c2) { return c1.toInt() < c2.toInt(); };
 
 private Q_SLOTS:
-    /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
+    /** @brief: To avoid filling the hard drive, remove the least recently used chunks from the undo folder. */
     void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
     void doPreviewRender(const QString &scene); // std::shared_ptr<Mlt::Producer> sourceProd);
-    /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
-    void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
     /** @brief: Process preview rendering output. */
@@ -5,10 +5,12 @@
     SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
+#include "audiomixer/iecscale.h"
 #include "bin/projectitemmodel.h"
 #include "capture/mediacapture.h"
 #include "core.h"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioPeaks.h"
 #include <QElapsedTimer>
 #include <QPainter>
 #include <QPainterPath>
@@ -110,6 +112,7 @@ public:
                 } else {
                     // Clip changed, reset levels
                     m_audioLevels.clear();
+                    m_peaks.reset();
                 }
             }
         });
@@ -132,6 +135,9 @@ public:
             }
             m_audioMax = KdenliveSettings::normalizechannels() ? pCore->projectItemModel()->getAudioMaxLevel(m_binId, m_stream) : 0;
         }
+        if (!m_peaks && m_stream >= 0) {
+            m_peaks = pCore->projectItemModel()->getAudioPeaksByBinID(m_binId, m_stream);
+        }
 
         if (m_outPoint == m_inPoint) {
             return;
@@ -140,6 +146,10 @@ public:
         if (m_opaquePaint) {
             painter->fillRect(bgRect, m_bgColor);
         }
+        if (m_peaks && m_scale > 2 && paintPeaks(painter)) {
+            // Zoomed in, sub-frame waveform was drawn
+            return;
+        }
         QPen pen(painter->pen());
         double increment = qMax(1., m_scale / m_channels);           // qMax(1., 1. / qAbs(indicesPrPixel));
         qreal indicesPrPixel = m_channels / m_scale * qAbs(m_speed); // qreal(m_outPoint - m_inPoint) / width() * m_precisionFactor;
@@ -274,6 +284,105 @@ public:
         }
     }
 
+    /** @brief Draw the waveform from the multi-resolution peaks, used when there is more than one pixel per frame.
+     *  Returns false if the peaks cannot be used for this clip. */
+    bool paintPeaks(QPainter *painter)
+    {
+        const int channels = m_peaks->channels();
+        if (channels != m_channels || m_speed <= 0) {
+            return false;
+        }
+        const double samplesPerFrame = m_peaks->frequency() / pCore->getCurrentFps();
+        const double samplesPerPixel = samplesPerFrame * m_speed / m_scale;
+        const int level = m_peaks->levelForResolution(samplesPerPixel);
+        const AudioPeaks::Peak *data = m_peaks->level(level);
+        const qint64 blocks = m_peaks->blockCount(level);
+        const double blockSize = m_peaks->blockSize(level);
+        if (data == nullptr || blocks == 0) {
+            return false;
+        }
+        const double startSample = double(m_inPoint / m_channels) * samplesPerFrame;
+        const double scaleFactor = m_audioMax > 1 ? m_audioMax : 255;
+        // Use the same IEC scale as the per frame levels so that both zoom modes look alike
+        auto toLevel = [scaleFactor](int amplitude) {
+            if (amplitude <= 0) {
+                return 0.;
+            }
+            double level = 256 * qMin(IEC_Scale(20 * log10(amplitude / 32768.)) * 0.9, 1.0);
+            return qMin(level, scaleFactor) / scaleFactor;
+        };
+        const bool merged = !KdenliveSettings::displayallchannels();
+        const int drawnChannels = merged ? 1 : channels;
+        const double channelHeight = height() / drawnChannels;
+        const int w = int(width());
+        // Upper and lower envelope for each drawn channel
+        QVector<QPolygonF> upper(drawnChannels);
+        QVector<QPolygonF> lower(drawnChannels);
+        for (int x = 0; x <= w; x++) {
+            double s0 = startSample + x * samplesPerPixel;
+            qint64 b0 = qint64(s0 / blockSize);
+            qint64 b1 = qMax(b0, qint64(ceil((s0 + samplesPerPixel) / blockSize)) - 1);
+            if (b0 >= blocks) {
+                break;
+            }
+            b1 = qMin(b1, blocks - 1);
+            int mergedPeak = 0;
+            for (int c = 0; c < channels; c++) {
+                int mn = 0;
+                int mx = 0;
+                for (qint64 b = b0; b <= b1; b++) {
+                    const AudioPeaks::Peak &p = data[b * channels + c];
+                    mn = qMin(mn, int(p.min));
+                    mx = qMax(mx, int(p.max));
+                }
+                if (merged) {
+                    mergedPeak = qMax(mergedPeak, qMax(mx, -mn));
+                    continue;
+                }
+                double y = c * channelHeight + channelHeight / 2;
+                upper[c] << QPointF(x, y - toLevel(mx) * channelHeight / 2);
+                lower[c] << QPointF(x, y + toLevel(-mn) * channelHeight / 2);
+            }
+            if (merged) {
+                upper[0] << QPointF(x, height() - toLevel(mergedPeak) * height());
+                lower[0] << QPointF(x, height());
+            }
+        }
+        painter->setPen(Qt::NoPen);
+        for (int c = 0; c < drawnChannels; c++) {
+            if (upper.at(c).isEmpty()) {
+                continue;
+            }
+            const QColor color = c % 2 == 0 ? m_color : m_color2;
+            if (!merged) {
+                double y = c * channelHeight + channelHeight / 2;
+                if (c % 2 == 0) {
+                    // Add dark background on the first channel of each pair (even indexes)
+                    painter->setOpacity(0.2);
+                    painter->fillRect(QRectF(0, c * channelHeight, width(), channelHeight), Qt::black);
+                }
+                painter->setOpacity(0.5);
+                painter->setPen(color);
+                painter->drawLine(QLineF(0., y, width(), y));
+                painter->setPen(Qt::NoPen);
+                painter->setOpacity(1);
+            }
+            QPolygonF shape = upper.at(c);
+            for (int i = lower.at(c).size() - 1; i >= 0; i--) {
+                shape << lower.at(c).at(i);
+            }
+            painter->setBrush(color);
+            painter->drawPolygon(shape);
+            if (!merged && m_firstChunk && channels > 1 && channels < 7) {
+                const QStringList chanelNames{"L", "R", "C", "LFE", "BL", "BR"};
+                painter->setPen(color);
+                painter->drawText(2, int((c + 1) * channelHeight), chanelNames[c]);
+                painter->setPen(Qt::NoPen);
+            }
+        }
+        return true;
+    }
+
 Q_SIGNALS:
     void levelsChanged();
     void propertyChanged();
@@ -283,6 +392,7 @@ Q_SIGNALS:
 
 private:
     QVector<uint8_t> m_audioLevels;
+    std::shared_ptr<AudioPeaks> m_peaks;
     int m_inPoint;
     int m_outPoint;
     QString m_binId;
@@ -14,17 +14,160 @@
 
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QThread>
+#include <algorithm>
 #include <mlt++/MltFilter.h>
 #include <mlt++/MltProfile.h>
 
+std::unique_ptr<ThumbnailProducerPool> ThumbnailProducerPool::instance;
+std::once_flag ThumbnailProducerPool::m_onceFlag;
+
+namespace {
+// Producers opened at the same time for a clip
+constexpr int producersPerClip = 2;
+// Idle producers kept open for all clips
+constexpr size_t maxIdleProducers = 12;
+// Idle producers are closed after this delay in milliseconds
+constexpr qint64 idleTimeout = 30000;
+
+/** @class ThumbnailResponse
+    @brief Extracts a thumbnail in the thread pool. The request is skipped if QML cancels it before, which happens
+    when the thumbnail is scrolled out of view.
+ */
+class ThumbnailResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    explicit ThumbnailResponse(const QString &id)
+        : m_id(id)
+    {
+        // The engine deletes the response once finished was emitted
+        setAutoDelete(false);
+    }
+    QQuickTextureFactory *textureFactory() const override { return QQuickTextureFactory::textureFactoryForImage(m_image); }
+    void cancel() override { m_canceled = true; }
+    void run() override
+    {
+        if (!m_canceled) {
+            m_image = ThumbnailProvider::requestImage(m_id, m_canceled);
+        }
+        Q_EMIT finished();
+    }
+
+private:
+    QString m_id;
+    QImage m_image;
+    std::atomic<bool> m_canceled{false};
+};
+} // namespace
+
+ThumbnailProducerPool::ThumbnailProducerPool()
+{
+    m_clock.start();
+    m_threads.setMaxThreadCount(qBound(2, QThread::idealThreadCount() / 2, 4));
+}
+
+std::unique_ptr<ThumbnailProducerPool> &ThumbnailProducerPool::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new ThumbnailProducerPool()); });
+    return instance;
+}
+
+QThreadPool *ThumbnailProducerPool::threadPool()
+{
+    return &m_threads;
+}
+
+bool ThumbnailProducerPool::acquire(const QString &binId, int generation, int frame, const std::atomic<bool> &canceled,
+                                    std::unique_ptr<Mlt::Producer> &producer)
+{
+    QMutexLocker lock(&m_mutex);
+    evict(binId, generation);
+    while (true) {
+        if (canceled) {
+            return false;
+        }
+        // Prefer the producer that decoded the closest frame before the requested one, it can continue without seeking far
+        int best = -1;
+        for (int i = 0; i < int(m_idle.size()); ++i) {
+            const Entry &entry = m_idle.at(size_t(i));
+            if (entry.binId != binId || entry.generation != generation) {
+                continue;
+            }
+            if (best < 0) {
+                best = i;
+                continue;
+            }
+            const int bestFrame = m_idle.at(size_t(best)).lastFrame;
+            const bool before = entry.lastFrame <= frame;
+            const bool bestBefore = bestFrame <= frame;
+            if ((before && !bestBefore) || (before == bestBefore && qAbs(frame - entry.lastFrame) < qAbs(frame - bestFrame))) {
+                best = i;
+            }
+        }
+        if (best >= 0) {
+            producer = std::move(m_idle[size_t(best)].producer);
+            m_idle.erase(m_idle.begin() + best);
+            m_busy[binId]++;
+            return true;
+        }
+        if (m_busy[binId] < producersPerClip) {
+            m_busy[binId]++;
+            return true;
+        }
+        m_released.wait(&m_mutex, 100);
+    }
+}
+
+void ThumbnailProducerPool::release(const QString &binId, int generation, int frame, std::unique_ptr<Mlt::Producer> producer)
+{
+    QMutexLocker lock(&m_mutex);
+    if (--m_busy[binId] <= 0) {
+        m_busy.erase(binId);
+    }
+    if (producer && producer->is_valid()) {
+        m_idle.push_back({binId, generation, frame, m_clock.elapsed(), std::move(producer)});
+    }
+    evict();
+    m_released.wakeAll();
+}
+
+void ThumbnailProducerPool::evict(const QString &binId, int generation)
+{
+    const qint64 now = m_clock.elapsed();
+    m_idle.erase(std::remove_if(m_idle.begin(), m_idle.end(),
+                                [now, &binId, generation](const Entry &entry) {
+                                    return now - entry.lastUsed > idleTimeout || (entry.binId == binId && entry.generation != generation);
+                                }),
+                 m_idle.end());
+    while (m_idle.size() > maxIdleProducers) {
+        auto oldest = std::min_element(m_idle.begin(), m_idle.end(), [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+        m_idle.erase(oldest);
+    }
+}
+
+void ThumbnailProducerPool::clear()
+{
+    m_threads.waitForDone();
+    QMutexLocker lock(&m_mutex);
+    m_idle.clear();
+}
+
 ThumbnailProvider::ThumbnailProvider()
-    : QQuickImageProvider(QQmlImageProviderBase::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading)
+    : QQuickAsyncImageProvider()
 {
 }
 
 ThumbnailProvider::~ThumbnailProvider() = default;
 
-QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    Q_UNUSED(requestedSize)
+    auto *response = new ThumbnailResponse(id);
+    ThumbnailProducerPool::get()->threadPool()->start(response);
+    return response;
+}
+
+QImage ThumbnailProvider::requestImage(const QString &id, const std::atomic<bool> &canceled)
 {
     QImage result;
     // id is binID/#frameNumber
@@ -41,24 +184,28 @@ QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSi
             }
             result = ThumbnailCache::get()->getThumbnail(binClip->hashForThumbs(), binId, frameNumber);
             if (!result.isNull()) {
-
-                *size = result.size();
                 return result;
             }
-            std::unique_ptr<Mlt::Producer> prod = binClip->getThumbProducer();
-            if (prod && prod->is_valid()) {
-                result = makeThumbnail(std::move(prod), frameNumber, requestedSize);
+            const int generation = binClip->thumbProducerGeneration();
+            std::unique_ptr<Mlt::Producer> prod;
+            if (!ThumbnailProducerPool::get()->acquire(binId, generation, frameNumber, canceled, prod)) {
+                return result;
+            }
+            if (!prod) {
+                prod = binClip->getThumbProducer();
+            }
+            if (prod && prod->is_valid() && !canceled) {
+                result = makeThumbnail(prod.get(), frameNumber);
                 ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
             }
+            ThumbnailProducerPool::get()->release(binId, generation, frameNumber, std::move(prod));
         }
     }
-    if (size) *size = result.size();
     return result;
 }
 
-QImage ThumbnailProvider::makeThumbnail(std::unique_ptr<Mlt::Producer> producer, int frameNumber, const QSize &requestedSize)
+QImage ThumbnailProvider::makeThumbnail(Mlt::Producer *producer, int frameNumber)
 {
-    Q_UNUSED(requestedSize)
     producer->seek(frameNumber);
     std::unique_ptr<Mlt::Frame> frame(producer->get_frame());
     if (frame == nullptr || !frame->is_valid()) {
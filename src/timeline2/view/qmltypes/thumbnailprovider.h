@@ -9,19 +9,77 @@
 
 #include <KImageCache>
 #include <QCache>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QQuickImageProvider>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
 #include <memory>
 #include <mlt++/MltProducer.h>
 #include <mlt++/MltProfile.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
-class ThumbnailProvider : public QQuickImageProvider
+/** @class ThumbnailProducerPool
+    @brief Keeps the producers used to extract timeline thumbnails open between requests.
+    Opening a producer initializes the demuxer and decoder, which costs much more than decoding a frame.
+    Each clip uses a bounded number of producers, further requests for the clip wait for one of them and
+    get the producer whose last decoded frame is closest before the requested one.
+    Producers are identified by the bin id and the thumbnail producer generation of their clip. Generations are unique in
+    the application, so that producers are never shared by clips of different projects that use the same bin id.
+    Idle producers are closed after a while, when the thumbnail producer of their clip is reset, or when the project is closed.
+ */
+class ThumbnailProducerPool
+{
+public:
+    static std::unique_ptr<ThumbnailProducerPool> &get();
+    /** @brief Reserves a producer of clip @param binId to extract @param frame.
+        @param producer receives an idle producer, or stays empty if the caller must create a new one.
+        @returns false if @param canceled was set while waiting for a producer, nothing was reserved in that case */
+    bool acquire(const QString &binId, int generation, int frame, const std::atomic<bool> &canceled, std::unique_ptr<Mlt::Producer> &producer);
+    /** @brief Gives back a producer reserved with acquire after extracting @param frame, @param producer can be empty */
+    void release(const QString &binId, int generation, int frame, std::unique_ptr<Mlt::Producer> producer);
+    /** @brief The threads extracting thumbnails */
+    QThreadPool *threadPool();
+    /** @brief Waits for the running extractions and closes all the producers. Must be called before closing MLT */
+    void clear();
+
+private:
+    ThumbnailProducerPool();
+    static std::unique_ptr<ThumbnailProducerPool> instance;
+    static std::once_flag m_onceFlag;
+    struct Entry
+    {
+        QString binId;
+        int generation;
+        int lastFrame;
+        qint64 lastUsed;
+        std::unique_ptr<Mlt::Producer> producer;
+    };
+    QMutex m_mutex;
+    QWaitCondition m_released;
+    std::vector<Entry> m_idle;
+    /** @brief Number of reserved producers per clip */
+    std::unordered_map<QString, int> m_busy;
+    QElapsedTimer m_clock;
+    QThreadPool m_threads;
+    /** @brief Close the producers that were not used recently, and the idle producers of @param binId that
+        don't have @param generation. m_mutex must be locked */
+    void evict(const QString &binId = QString(), int generation = -1);
+};
+
+class ThumbnailProvider : public QQuickAsyncImageProvider
 {
 public:
     explicit ThumbnailProvider();
     ~ThumbnailProvider() override;
-    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+    /** @brief Returns the thumbnail for @param id (binId/uuid/#frame), or a null image if @param canceled is set before it is extracted */
+    static QImage requestImage(const QString &id, const std::atomic<bool> &canceled);
 
 private:
     Mlt::Profile m_profile;
-    QImage makeThumbnail(std::unique_ptr<Mlt::Producer> producer, int frameNumber, const QSize &requestedSize);
+    static QImage makeThumbnail(Mlt::Producer *producer, int frameNumber);
 };
@@ -3300,13 +3300,15 @@ void TimelineController::setAudioRef(int clipId)
     m_audioRef = clipId;
     std::unique_ptr<AudioEnvelope> envelope(new AudioEnvelope(getClipBinId(clipId), clipId));
     m_audioCorrelator.reset(new AudioCorrelation(std::move(envelope)));
-    connect(m_audioCorrelator.get(), &AudioCorrelation::gotAudioAlignData, this, [&](int cid, int shift) {
+    connect(m_audioCorrelator.get(), &AudioCorrelation::gotAudioAlignData, this, [&](int cid, int shift, double confidence) {
         // Ensure the clip was not deleted while processing calculations
         if (m_model->isClip(cid)) {
             int pos = m_model->getClipPosition(m_audioRef) + shift - m_model->getClipIn(m_audioRef);
             bool result = m_model->requestClipMove(cid, m_model->getClipTrackId(cid), pos, true, true, true);
             if (!result) {
                 pCore->displayMessage(i18n("Cannot move clip to frame %1.", (pos + shift)), ErrorMessage, 500);
+            } else if (confidence < 0.3) {
+                pCore->displayMessage(i18n("The audio of the clip does not match the reference well, please check the alignment"), InformationMessage, 500);
             }
         } else {
             // Clip was deleted, discard audio reference
@@ -10,6 +10,83 @@
 #include <QDebug>
 #include <QTime>
 #include <utility>
+
+UndoJournal::UndoJournal(bool reversed)
+    : m_operations(std::make_shared<std::vector<Fun>>())
+    , m_reversed(reversed)
+{
+}
+
+void UndoJournal::push(Fun &lambda, Fun operation, bool reversed)
+{
+    auto *journal = lambda.target<UndoJournal>();
+    if (journal == nullptr || journal->m_reversed != reversed) {
+        UndoJournal newJournal(reversed);
+        if (lambda) {
+            newJournal.m_operations->push_back(std::move(lambda));
+        }
+        newJournal.m_operations->push_back(std::move(operation));
+        lambda = std::move(newJournal);
+        return;
+    }
+    if (journal->m_operations.use_count() > 1) {
+        // Another copy of the function uses these operations, don't modify it
+        journal->m_operations = std::make_shared<std::vector<Fun>>(*journal->m_operations);
+    }
+    journal->m_operations->push_back(std::move(operation));
+}
+
+void UndoJournal::append(Fun &lambda, Fun operation)
+{
+    push(lambda, std::move(operation), false);
+}
+
+void UndoJournal::prepend(Fun &lambda, Fun operation)
+{
+    push(lambda, std::move(operation), true);
+}
+
+int UndoJournal::operationCount(const Fun &lambda)
+{
+    const auto *journal = lambda.target<UndoJournal>();
+    if (journal == nullptr) {
+        return lambda ? 1 : 0;
+    }
+    int count = 0;
+    for (const Fun &operation : *journal->m_operations) {
+        count += operationCount(operation);
+    }
+    return count;
+}
+
+size_t UndoJournal::memoryCost(const Fun &lambda)
+{
+    const auto *journal = lambda.target<UndoJournal>();
+    if (journal == nullptr) {
+        return sizeof(Fun);
+    }
+    size_t cost = sizeof(Fun) + sizeof(std::vector<Fun>) + (journal->m_operations->capacity() - journal->m_operations->size()) * sizeof(Fun);
+    for (const Fun &operation : *journal->m_operations) {
+        cost += memoryCost(operation);
+    }
+    return cost;
+}
+
+bool UndoJournal::operator()() const
+{
+    bool result = true;
+    if (m_reversed) {
+        for (auto it = m_operations->crbegin(); it != m_operations->crend(); ++it) {
+            result = (*it)() && result;
+        }
+    } else {
+        for (const Fun &operation : *m_operations) {
+            result = operation() && result;
+        }
+    }
+    return result;
+}
+
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
@@ -41,3 +118,13 @@ void FunctionalUndoCommand::redo()
         Q_ASSERT(res);
     }
 }
+
+int FunctionalUndoCommand::operationCount() const
+{
+    return UndoJournal::operationCount(m_undo) + UndoJournal::operationCount(m_redo);
+}
+
+size_t FunctionalUndoCommand::memoryCost() const
+{
+    return UndoJournal::memoryCost(m_undo) + UndoJournal::memoryCost(m_redo);
+}
@@ -6,9 +6,41 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <vector>
 
 using Fun = std::function<bool(void)>;
 
+/** @brief A list of undo or redo operations executed one after the other.
+  UPDATE_UNDO_REDO used to wrap the previous undo and redo functions in a new closure for each operation,
+  so that an edit on N items produced a chain of N nested closures, copied as a whole and executed recursively.
+  Instead, a Fun holding a journal gets new operations appended to its list.
+  The redo journal executes its operations in insertion order, the undo journal in reverse order.
+  All the operations are executed even if one fails, the journal then returns false.
+  Copies of a journal share their operations until one of them is modified.
+ */
+class UndoJournal
+{
+public:
+    /** @brief Adds @param operation to @param lambda so that it is executed after it */
+    static void append(Fun &lambda, Fun operation);
+    /** @brief Adds @param operation to @param lambda so that it is executed before it */
+    static void prepend(Fun &lambda, Fun operation);
+    /** @brief Returns the number of operations executed by @param lambda, counting the ones of the nested journals */
+    static int operationCount(const Fun &lambda);
+    /** @brief Returns an estimation of the memory used by @param lambda, excluding the data captured by the operations */
+    static size_t memoryCost(const Fun &lambda);
+
+    bool operator()() const;
+
+private:
+    explicit UndoJournal(bool reversed);
+    std::shared_ptr<std::vector<Fun>> m_operations;
+    /** @brief If true, the operations are executed from the last one to the first one */
+    bool m_reversed;
+    static void push(Fun &lambda, Fun operation, bool reversed);
+};
+
 /** @brief this macro executes an operation after a given lambda
  */
 #define PUSH_LAMBDA(operation, lambda)                                                                                                                         \
@@ -38,6 +70,10 @@ public:
     FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
+    /** @brief The number of operations executed to undo or redo this command */
+    int operationCount() const;
+    /** @brief An estimation of the memory used by the undo and redo functions of this command, see UndoJournal::memoryCost */
+    size_t memoryCost() const;
 
 private:
     Fun m_undo, m_redo;
@@ -0,0 +1,234 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "mediahashindex.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+std::unique_ptr<MediaHashIndex> MediaHashIndex::instance;
+std::once_flag MediaHashIndex::m_onceFlag;
+
+namespace {
+// Increase when the layout of the file changes, index files with another version are discarded
+constexpr quint32 indexVersion = 1;
+constexpr quint32 indexMagic = 0x4b444d48; // KDMH
+// Rewrite the index file when less than half of its records are current
+constexpr int compactRatio = 2;
+constexpr QDataStream::Version streamVersion = QDataStream::Qt_5_15;
+} // namespace
+
+MediaHashIndex::MediaHashIndex(const QString &fileName)
+{
+    if (fileName.isEmpty()) {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        dir.mkpath(QStringLiteral("."));
+        m_file.setFileName(dir.absoluteFilePath(QStringLiteral("mediahashes")));
+    } else {
+        m_file.setFileName(fileName);
+    }
+    load();
+}
+
+MediaHashIndex::~MediaHashIndex()
+{
+    m_file.close();
+}
+
+std::unique_ptr<MediaHashIndex> &MediaHashIndex::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new MediaHashIndex()); });
+    return instance;
+}
+
+// static
+QPair<QByteArray, qint64> MediaHashIndex::computeHash(const QString &path)
+{
+    QFile file(path);
+    QByteArray fileHash;
+    qint64 fSize = 0;
+    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
+        /*
+         * 1 MB = 1 second per 450 files (or faster)
+         * 10 MB = 9 seconds per 450 files (or faster)
+         */
+        QByteArray fileData;
+        fSize = file.size();
+        if (fSize > 2000000) {
+            fileData = file.read(1000000);
+            if (file.seek(file.size() - 1000000)) {
+                fileData.append(file.readAll());
+            }
+        } else {
+            fileData = file.readAll();
+        }
+        file.close();
+        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+    }
+    return {fileHash, fSize};
+}
+
+// static
+MediaHashIndex::FileStamp MediaHashIndex::stamp(const QString &path)
+{
+    FileStamp result;
+    QFileInfo info(path);
+    if (!info.isFile()) {
+        return result;
+    }
+    result.size = info.size();
+    result.modified = info.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        result.inode = quint64(st.st_ino);
+    }
+#endif
+    return result;
+}
+
+bool MediaHashIndex::lookup(const QString &path, const FileStamp &fileStamp, QPair<QByteArray, qint64> &result) const
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end() || !(it->second.stamp == fileStamp)) {
+        return false;
+    }
+    result = {it->second.hash, fileStamp.size};
+    return true;
+}
+
+QPair<QByteArray, qint64> MediaHashIndex::hash(const QString &path)
+{
+    const QString filePath = QFileInfo(path).absoluteFilePath();
+    const FileStamp fileStamp = stamp(filePath);
+    if (fileStamp.size < 0) {
+        return {QByteArray(), 0};
+    }
+    QPair<QByteArray, qint64> result;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (lookup(filePath, fileStamp, result)) {
+            return result;
+        }
+    }
+    result = computeHash(filePath);
+    // Only remember the hash if the file was not modified while we were reading it
+    if (!result.first.isEmpty() && stamp(filePath) == fileStamp) {
+        store(filePath, fileStamp, result.first);
+    }
+    return result;
+}
+
+QMap<QString, QPair<QByteArray, qint64>> MediaHashIndex::hashFiles(const QStringList &paths)
+{
+    QMap<QString, QPair<QByteArray, qint64>> results;
+    QStringList missing;
+    for (const QString &path : paths) {
+        const QString filePath = QFileInfo(path).absoluteFilePath();
+        const FileStamp fileStamp = stamp(filePath);
+        if (fileStamp.size < 0) {
+            results.insert(path, {QByteArray(), 0});
+            continue;
+        }
+        QPair<QByteArray, qint64> result;
+        QMutexLocker lock(&m_mutex);
+        if (lookup(filePath, fileStamp, result)) {
+            results.insert(path, result);
+        } else {
+            missing << path;
+        }
+    }
+    missing.removeDuplicates();
+    if (missing.isEmpty()) {
+        return results;
+    }
+    const QList<QPair<QByteArray, qint64>> hashes = QtConcurrent::blockingMapped(missing, [this](const QString &path) { return hash(path); });
+    for (int i = 0; i < missing.count(); ++i) {
+        results.insert(missing.at(i), hashes.at(i));
+    }
+    return results;
+}
+
+void MediaHashIndex::store(const QString &path, const FileStamp &fileStamp, const QByteArray &hash)
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries[path] = {fileStamp, hash};
+    if (!m_file.isOpen()) {
+        return;
+    }
+    QDataStream stream(&m_file);
+    stream.setVersion(streamVersion);
+    stream << path << fileStamp.size << fileStamp.modified << fileStamp.inode << hash;
+    m_file.flush();
+    m_records++;
+    if (m_records > compactRatio * int(m_entries.size()) + 64) {
+        compact();
+    }
+}
+
+void MediaHashIndex::load()
+{
+    if (m_file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&m_file);
+        stream.setVersion(streamVersion);
+        quint32 magic = 0;
+        quint32 version = 0;
+        stream >> magic >> version;
+        if (magic == indexMagic && version == indexVersion) {
+            while (!stream.atEnd()) {
+                QString path;
+                Entry entry;
+                stream >> path >> entry.stamp.size >> entry.stamp.modified >> entry.stamp.inode >> entry.hash;
+                if (stream.status() != QDataStream::Ok) {
+                    // Truncated record, written when the application was interrupted
+                    break;
+                }
+                m_entries[path] = entry;
+                m_records++;
+            }
+        } else if (magic != 0) {
+            qDebug() << "// Discarding media hash index with unknown version" << version;
+        }
+        m_file.close();
+    }
+    // Always rewrite the file on startup, to drop outdated and truncated records
+    compact();
+}
+
+void MediaHashIndex::compact()
+{
+    // Entries of deleted files are kept, checking all the files could block on unreachable network storage
+    m_file.close();
+    QSaveFile writer(m_file.fileName());
+    if (writer.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&writer);
+        stream.setVersion(streamVersion);
+        stream << indexMagic << indexVersion;
+        for (const auto &entry : m_entries) {
+            stream << entry.first << entry.second.stamp.size << entry.second.stamp.modified << entry.second.stamp.inode << entry.second.hash;
+        }
+        if (!writer.commit()) {
+            qDebug() << "// Cannot write media hash index" << m_file.fileName();
+        }
+    }
+    m_records = int(m_entries.size());
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "// Cannot open media hash index" << m_file.fileName();
+    }
+}
@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/** @class MediaHashIndex
+    @brief Remembers the hash of the media files, so that unchanged files are not read again.
+    The hash of a file (see computeHash) requires reading its first and last megabyte, which is slow
+    on network storage and was repeated whenever a project was opened or a clip was loaded or relinked.
+    The index stores the hash of each file path together with the size, modification time and inode
+    of the file when it was hashed, and the file is only read again if one of them changed.
+    The index is kept in the cache folder, new entries are appended to the index file and the file
+    is rewritten when it contains too many outdated entries.
+ */
+class MediaHashIndex
+{
+public:
+    static std::unique_ptr<MediaHashIndex> &get();
+    ~MediaHashIndex();
+
+    /** @brief Returns the hash and size of the file at @param path, reading the file only if it changed since it was last hashed.
+        Returns an empty hash if the file cannot be read */
+    QPair<QByteArray, qint64> hash(const QString &path);
+    /** @brief Returns the hash and size of all the files in @param paths, the files missing from the index are hashed in parallel */
+    QMap<QString, QPair<QByteArray, qint64>> hashFiles(const QStringList &paths);
+    /** @brief Reads the file at @param path and returns the MD5 of its first and last megabyte and its size */
+    static QPair<QByteArray, qint64> computeHash(const QString &path);
+
+private:
+    /** @brief Opens the index stored in @param fileName, or in the cache folder if it is empty */
+    explicit MediaHashIndex(const QString &fileName = QString());
+    /** @brief The state of a file when it was hashed */
+    struct FileStamp
+    {
+        qint64 size{-1};
+        qint64 modified{0};
+        quint64 inode{0};
+        bool operator==(const FileStamp &other) const { return size == other.size && modified == other.modified && inode == other.inode; }
+    };
+    struct Entry
+    {
+        FileStamp stamp;
+        QByteArray hash;
+    };
+    static std::unique_ptr<MediaHashIndex> instance;
+    static std::once_flag m_onceFlag;
+    QMutex m_mutex;
+    std::unordered_map<QString, Entry> m_entries;
+    QFile m_file;
+    /** @brief Number of records in the index file, including the outdated ones */
+    int m_records{0};
+
+    static FileStamp stamp(const QString &path);
+    /** @brief Returns true and fills @param result if @param path has an up to date entry. m_mutex must be locked */
+    bool lookup(const QString &path, const FileStamp &fileStamp, QPair<QByteArray, qint64> &result) const;
+    /** @brief Stores the hash of a file and appends it to the index file */
+    void store(const QString &path, const FileStamp &fileStamp, const QByteArray &hash);
+    void load();
+    /** @brief Rewrites the index file with only the current entries. m_mutex must be locked */
+    void compact();
+};
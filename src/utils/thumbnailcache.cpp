@@ -9,9 +9,13 @@
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "project/projectmanager.h"
+#include "thumbnailpack.hpp"
 #include <QDir>
 #include <QMutexLocker>
-#include <list>
+#include <QReadWriteLock>
+#include <array>
+#include <atomic>
+#include <limits>
 
 std::unique_ptr<ThumbnailCache> ThumbnailCache::instance;
 std::once_flag ThumbnailCache::m_onceFlag;
@@ -19,85 +23,175 @@ std::once_flag ThumbnailCache::m_onceFlag;
 class ThumbnailCache::Cache_t
 {
 public:
-    Cache_t(int maxCost)
-        : m_maxCost(maxCost)
+    Cache_t(qint64 maxBytes)
+        : m_maxBytes(maxBytes)
+        , m_shardBytes(maxBytes / ShardCount)
     {
     }
 
-    bool contains(const QString &key) const { return m_cache.count(key) > 0; }
+    bool contains(const QString &key) const
+    {
+        const Shard &shard = shardFor(key);
+        QReadLocker lock(&shard.lock);
+        return shard.entries.count(key) > 0;
+    }
 
     void remove(const QString &key)
     {
-        if (!contains(key)) {
+        Shard &shard = shardFor(key);
+        QWriteLocker lock(&shard.lock);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
             return;
         }
-        auto it = m_cache.at(key);
-        m_currentCost -= (*it).second.second;
-        // Need to erase reference to iterator before erasing what it points to.
-        // Fixes BUG 463764.
-        m_cache.erase(key);
-        m_data.erase(it);
+        shard.bytes -= it->second.cost;
+        m_bytes -= it->second.cost;
+        shard.entries.erase(it);
     }
 
-    void insert(const QString &key, const QImage &img, int cost)
+    /** @brief Stores @param img for @param key, returns true if it replaced an image already stored for this key */
+    bool insert(const QString &key, const QImage &img, qint64 cost)
     {
-        if (cost > m_maxCost) {
-            return;
+        Shard &shard = shardFor(key);
+        QWriteLocker lock(&shard.lock);
+        auto it = shard.entries.find(key);
+        bool replaced = it != shard.entries.end();
+        if (replaced) {
+            shard.bytes -= it->second.cost;
+            m_bytes -= it->second.cost;
+            shard.entries.erase(it);
         }
-        m_data.push_front({key, {img, cost}});
-        auto it = m_data.begin();
-        m_cache[key] = it;
-        m_currentCost += cost;
-        while (m_currentCost > m_maxCost) {
-            remove(m_data.back().first);
+        if (cost > m_shardBytes) {
+            return replaced;
         }
+        shard.entries.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(img, cost, ++m_clock));
+        shard.bytes += cost;
+        m_bytes += cost;
+        evict(shard);
+        return replaced;
     }
 
+    /** @brief Returns the image stored for @param key, or a null image if it is not in the cache */
     QImage get(const QString &key)
     {
-        if (!contains(key)) {
+        const Shard &shard = shardFor(key);
+        QReadLocker lock(&shard.lock);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            ++m_misses;
             return QImage();
         }
-        // when a get operation occurs, we put the corresponding list item in front to remember last access
-        std::pair<QString, std::pair<QImage, int>> data;
-        auto it = m_cache.at(key);
-        std::swap(data, (*it));                                         // take data out without copy
-        QImage result = data.second.first;                              // a copy occurs here
-        m_data.erase(it);                                               // delete old iterator
-        m_cache[key] = m_data.emplace(m_data.begin(), std::move(data)); // reinsert without copy and store iterator
-        return result;
+        // Hits only share the lock of the shard, recency is tracked with a stamp instead of reordering a list
+        it->second.lastUse.store(++m_clock, std::memory_order_relaxed);
+        ++m_hits;
+        return it->second.image;
     }
+
     void clear()
     {
-        m_data.clear();
-        m_cache.clear();
-        m_currentCost = 0;
+        for (Shard &shard : m_shards) {
+            QWriteLocker lock(&shard.lock);
+            m_bytes -= shard.bytes;
+            shard.entries.clear();
+            shard.bytes = 0;
+        }
     }
+
     bool checkIntegrity() const
     {
-        if (m_data.size() != m_cache.size()) {
-            // Cache is corrupted
-            return false;
-        }
-        for (const auto &d : m_data) {
-            if (!contains(d.first)) {
+        qint64 total = 0;
+        for (const Shard &shard : m_shards) {
+            QReadLocker lock(&shard.lock);
+            qint64 bytes = 0;
+            for (const auto &entry : shard.entries) {
+                if (&shardFor(entry.first) != &shard) {
+                    return false;
+                }
+                bytes += entry.second.cost;
+            }
+            if (bytes != shard.bytes || bytes > m_shardBytes) {
+                // Cache is corrupted
                 return false;
             }
+            total += bytes;
         }
-        return true;
+        return total == m_bytes.load() && total <= m_maxBytes;
+    }
+
+    ThumbnailCache::Statistics statistics() const
+    {
+        ThumbnailCache::Statistics stats;
+        stats.hits = m_hits.load();
+        stats.misses = m_misses.load();
+        stats.evictions = m_evictions.load();
+        for (const Shard &shard : m_shards) {
+            QReadLocker lock(&shard.lock);
+            stats.entries += int(shard.entries.size());
+            stats.bytes += shard.bytes;
+        }
+        return stats;
     }
 
 protected:
-    int m_maxCost;
-    int m_currentCost{0};
-
-    // The data is stored as (key,(image, cost)) in a std::list that serves as a
-    // FIFO queue. If m_maxCost is exceeded, elements are removed from the
-    // end of the list until the sum of the costs in the list is less than m_maxCost.
-    std::list<std::pair<QString, std::pair<QImage, int>>> m_data;
-    // m_cache keeps a mapping from the key to an iterator that represents the
-    // item's location in m_data, like a pointer.
-    std::unordered_map<QString, decltype(m_data.begin())> m_cache;
+    static constexpr int ShardCount = 16;
+
+    struct Entry
+    {
+        Entry(const QImage &img, qint64 imgCost, quint64 use)
+            : image(img)
+            , cost(imgCost)
+            , lastUse(use)
+        {
+        }
+        QImage image;
+        qint64 cost;
+        mutable std::atomic<quint64> lastUse;
+    };
+
+    // Each shard gets an equal share of the memory budget
+    struct Shard
+    {
+        mutable QReadWriteLock lock;
+        std::unordered_map<QString, Entry> entries;
+        qint64 bytes{0};
+    };
+
+    const Shard &shardFor(const QString &key) const { return m_shards[shardIndex(key)]; }
+    Shard &shardFor(const QString &key) { return m_shards[shardIndex(key)]; }
+    static uint shardIndex(const QString &key) { return uint(qHash(key) % ShardCount); }
+
+    /** @brief Drops the least recently used entries of @param shard until it fits in its share of the budget.
+        The write lock of the shard must be held */
+    void evict(Shard &shard)
+    {
+        while (shard.bytes > m_shardBytes) {
+            auto oldest = shard.entries.end();
+            quint64 oldestUse = std::numeric_limits<quint64>::max();
+            for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+                const quint64 use = it->second.lastUse.load(std::memory_order_relaxed);
+                if (use < oldestUse) {
+                    oldestUse = use;
+                    oldest = it;
+                }
+            }
+            if (oldest == shard.entries.end()) {
+                return;
+            }
+            shard.bytes -= oldest->second.cost;
+            m_bytes -= oldest->second.cost;
+            shard.entries.erase(oldest);
+            ++m_evictions;
+        }
+    }
+
+    const qint64 m_maxBytes;
+    const qint64 m_shardBytes;
+    std::atomic<qint64> m_bytes{0};
+    std::array<Shard, ShardCount> m_shards;
+    mutable std::atomic<quint64> m_clock{0};
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_evictions{0};
 };
 
 ThumbnailCache::ThumbnailCache()
@@ -113,7 +207,6 @@ std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
 
 bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     auto key = pos < 0 ? getAudioKey(binId, &ok).constFirst() : getKey(binId, pos, &ok);
     if (ok && m_volatileCache->contains(key)) {
@@ -122,24 +215,28 @@ bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOn
     if (!ok || volatileOnly) {
         return false;
     }
-    locker.unlock();
-    QDir thumbFolder = getDir(pos < 0, &ok);
-    return ok && thumbFolder.exists(key);
+    if (pos < 0) {
+        QDir thumbFolder = getDir(true, &ok);
+        return ok && thumbFolder.exists(key);
+    }
+    auto pack = getPack(getHash(binId, &ok));
+    return pack && pack->contains(pos);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     auto key = getAudioKey(binId, &ok).constFirst();
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
-    }
-    if (!ok || volatileOnly) {
+    if (!ok) {
         return QImage();
     }
+    QImage img = m_volatileCache->get(key);
+    if (!img.isNull() || volatileOnly) {
+        return img;
+    }
     QDir thumbFolder = getDir(true, &ok);
     if (ok && thumbFolder.exists(key)) {
+        QMutexLocker locker(&m_mutex);
         if (std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), -1) != m_storedOnDisk[binId].end()) {
             m_storedOnDisk[binId].push_back(-1);
         }
@@ -167,52 +264,32 @@ const QList<QUrl> ThumbnailCache::getAudioThumbPath(const QString &binId) const
 
 QImage ThumbnailCache::getThumbnail(QString hash, const QString &binId, int pos, bool volatileOnly) const
 {
+    Q_UNUSED(binId)
     if (hash.isEmpty()) {
         return QImage();
     }
-    hash.append(QString("#%1.jpg").arg(pos));
-    QMutexLocker locker(&m_mutex);
-    if (m_volatileCache->contains(hash)) {
-        return m_volatileCache->get(hash);
-    }
-    if (volatileOnly) {
-        return QImage();
-    }
-    bool ok = false;
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(hash)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(hash));
+    const QString key = hash + QString("#%1.jpg").arg(pos);
+    QImage img = m_volatileCache->get(key);
+    if (!img.isNull() || volatileOnly) {
+        return img;
     }
-    locker.unlock();
-    return QImage();
+    auto pack = getPack(hash);
+    return pack ? pack->image(pos) : QImage();
 }
 
 QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     auto key = getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
-    }
-    if (!ok || volatileOnly) {
+    if (!ok) {
         return QImage();
     }
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(key));
+    QImage img = m_volatileCache->get(key);
+    if (!img.isNull() || volatileOnly) {
+        return img;
     }
-    return QImage();
+    auto pack = getPack(getHash(binId, &ok));
+    return pack ? pack->image(pos) : QImage();
 }
 
 void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent)
@@ -220,30 +297,20 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     if (pCore->projectItemModel()->closing) {
         return;
     }
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     const QString key = getKey(binId, pos, &ok);
     if (!ok) {
         return;
     }
-    // if volatile cache also contains this entry, update it
-    if (m_volatileCache->contains(key)) {
-        m_volatileCache->remove(key);
-    } else {
+    // if volatile cache also contains this entry, it is replaced
+    if (!m_volatileCache->insert(key, img, img.sizeInBytes())) {
+        QMutexLocker locker(&m_mutex);
         m_storedVolatile[binId].push_back(pos);
     }
-    m_volatileCache->insert(key, img, (int)img.sizeInBytes());
     if (persistent) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-                m_storedOnDisk[binId].push_back(pos);
-            }
-            locker.unlock();
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << thumbFolder.absoluteFilePath(key);
-            }
+        auto pack = getPack(getHash(binId, &ok));
+        if (pack && !pack->append(pos, img)) {
+            qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB for clip: " << binId << " at " << pos;
         }
     }
 }
@@ -253,32 +320,32 @@ bool ThumbnailCache::checkIntegrity() const
     return m_volatileCache->checkIntegrity();
 }
 
+ThumbnailCache::Statistics ThumbnailCache::statistics() const
+{
+    return m_volatileCache->statistics();
+}
+
 void ThumbnailCache::saveCachedThumbs(const std::unordered_map<QString, std::vector<int>> &keys)
 {
-    bool ok;
-    QDir thumbFolder = getDir(false, &ok);
-    if (!ok) {
-        return;
-    }
-    QMutexLocker locker(&m_mutex);
     for (auto &key : keys) {
         bool ok;
+        const QString hash = getHash(key.first, &ok);
+        auto pack = getPack(hash);
+        if (!pack) {
+            continue;
+        }
         for (const auto &pos : key.second) {
-            if (m_storedOnDisk.find(key.first) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[key.first].begin(), m_storedOnDisk[key.first].end(), pos) == m_storedOnDisk[key.first].end()) {
-                const QString thumbKey = getKey(key.first, pos, &ok);
-                if (!ok) {
-                    continue;
-                }
-                if (!thumbFolder.exists(thumbKey) && m_volatileCache->contains(thumbKey)) {
-                    QImage img = m_volatileCache->get(thumbKey);
-                    if (!img.save(thumbFolder.absoluteFilePath(thumbKey))) {
-                        qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                        break;
-                    } else {
-                        m_storedOnDisk[key.first].push_back(pos);
-                    }
-                }
+            if (pack->contains(pos)) {
+                continue;
+            }
+            const QString thumbKey = hash + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+            QImage img = m_volatileCache->get(thumbKey);
+            if (img.isNull()) {
+                continue;
+            }
+            if (!pack->append(pos, img)) {
+                qDebug() << "// Error writing thumbnails for clip " << key.first;
+                break;
             }
         }
     }
@@ -297,30 +364,14 @@ void ThumbnailCache::invalidateThumbsForClip(const QString &binId)
         }
         m_storedVolatile.erase(binId);
     }
-    bool ok = false;
-    // Video thumbs
-    QStringList files;
-    if (m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
-        // Remove persistent cache
-        for (const auto &pos : m_storedOnDisk.at(binId)) {
-            if (pos >= 0) {
-                auto key = getKey(binId, pos, &ok);
-                if (ok) {
-                    files << key;
-                }
-            }
-        }
-        m_storedOnDisk.erase(binId);
-    }
+    m_storedOnDisk.erase(binId);
     // Release mutex before deleting files
     locker.unlock();
-    if (!files.isEmpty()) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            while (!files.isEmpty()) {
-                thumbFolder.remove(files.takeFirst());
-            }
-        }
+    // Remove persistent cache
+    bool ok = false;
+    auto pack = getPack(getHash(binId, &ok));
+    if (pack) {
+        pack->remove();
     }
 }
 
@@ -330,10 +381,36 @@ void ThumbnailCache::clearCache()
     m_volatileCache->clear();
     m_storedVolatile.clear();
     m_storedOnDisk.clear();
+    locker.unlock();
+    QMutexLocker packsLocker(&m_packsMutex);
+    m_packs.clear();
+}
+
+std::shared_ptr<ThumbnailPack> ThumbnailCache::getPack(const QString &hash) const
+{
+    if (hash.isEmpty()) {
+        return nullptr;
+    }
+    bool ok = false;
+    QDir thumbFolder = getDir(false, &ok);
+    if (!ok) {
+        return nullptr;
+    }
+    const QString path = thumbFolder.absoluteFilePath(hash + ThumbnailPack::extension());
+    QMutexLocker locker(&m_packsMutex);
+    auto it = m_packs.find(path);
+    if (it != m_packs.end()) {
+        return it->second;
+    }
+    auto pack = std::make_shared<ThumbnailPack>(path);
+    // Thumbnails of projects created with older versions were stored in one file per frame
+    pack->importFiles(thumbFolder, hash);
+    m_packs[path] = pack;
+    return pack;
 }
 
 // static
-QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+QString ThumbnailCache::getHash(const QString &binId, bool *ok)
 {
     if (binId.isEmpty()) {
         *ok = false;
@@ -344,7 +421,17 @@ QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
     if (!*ok) {
         return QString();
     }
-    return binClip->hashForThumbs() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+    return binClip->hashForThumbs();
+}
+
+// static
+QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+{
+    const QString hash = getHash(binId, ok);
+    if (!*ok) {
+        return QString();
+    }
+    return hash + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
 }
 
 // static
@@ -15,10 +15,16 @@
 #include <unordered_map>
 #include <vector>
 
+class ThumbnailPack;
+
 /** @class ThumbnailCache
     @brief This class class is an interface to the caches that store thumbnails.
     In Kdenlive, we use two such caches, a persistent that is stored on disk to allow thumbnails to be reused when reopening.
-    The other one is a volatile LRU cache that lives in memory.
+    The persistent video thumbnails of a clip are stored in a single pack file, see ThumbnailPack.
+    The other one is a volatile LRU cache that lives in memory, limited by the size in bytes of the stored images.
+    It is split in shards by key, each with its own lock, so that concurrent lookups of thumbnails from the timeline
+    and the cache jobs do not wait on each other: lookups only share the lock of their shard. Each shard gets an equal
+    share of the memory budget and drops its own least recently used images when it is full.
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
     KImageCache is not suitable since it lacks a way to remove objects from the cache.
@@ -67,6 +73,17 @@ public:
     /** @brief Ensure the cache is not corrupted */
     bool checkIntegrity() const;
 
+    struct Statistics
+    {
+        quint64 hits{0};
+        quint64 misses{0};
+        quint64 evictions{0};
+        int entries{0};
+        qint64 bytes{0};
+    };
+    /** @brief Returns the counters of the volatile cache, to monitor its efficiency */
+    Statistics statistics() const;
+
 protected:
     // Constructor is protected because class is a Singleton
     ThumbnailCache();
@@ -74,6 +91,11 @@ protected:
     // Return the key associated to a thumbnail
     static QString getKey(const QString &binId, int pos, bool *ok);
     static QStringList getAudioKey(const QString &binId, bool *ok);
+    // Return the hash identifying the thumbnails of a clip
+    static QString getHash(const QString &binId, bool *ok);
+
+    /** @brief Returns the pack storing the persistent thumbnails with hash @param hash, opening it on first use */
+    std::shared_ptr<ThumbnailPack> getPack(const QString &hash) const;
 
     // Return the dir where the persistent cache lives
     static const QDir getDir(bool audio, bool *ok);
@@ -83,10 +105,15 @@ protected:
 
     class Cache_t;
     std::unique_ptr<Cache_t> m_volatileCache;
+    // Protects the maps below, the volatile cache has its own locks
     mutable QMutex m_mutex;
 
     // the following maps keeps track of the positions that we store for each clip in volatile caches.
     // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
     std::unordered_map<QString, std::vector<int>> m_storedVolatile;
     mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+
+    // The opened thumbnail packs, by file path
+    mutable QMutex m_packsMutex;
+    mutable std::unordered_map<QString, std::shared_ptr<ThumbnailPack>> m_packs;
 };
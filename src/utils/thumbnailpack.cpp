@@ -0,0 +1,283 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "thumbnailpack.hpp"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <cstring>
+
+namespace {
+// Increase when the layout of the file changes, packs with another version are discarded
+constexpr quint32 packVersion = 1;
+constexpr char packMagic[4] = {'K', 'D', 'T', 'H'};
+
+struct PackHeader
+{
+    char magic[4];
+    quint32 version;
+};
+
+struct RecordHeader
+{
+    qint32 position;
+    quint32 length;
+};
+
+QByteArray encode(const QImage &img)
+{
+    QByteArray payload;
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::WriteOnly);
+    img.save(&buffer, "JPG");
+    return payload;
+}
+
+QByteArray packHeader()
+{
+    PackHeader header;
+    memcpy(header.magic, packMagic, 4);
+    header.version = packVersion;
+    return QByteArray(reinterpret_cast<const char *>(&header), sizeof(PackHeader));
+}
+} // namespace
+
+ThumbnailPack::ThumbnailPack(const QString &path)
+    : m_path(path)
+{
+    m_file.setFileName(path);
+    m_writer.setFileName(path);
+    load();
+}
+
+ThumbnailPack::~ThumbnailPack()
+{
+    unmap();
+}
+
+// static
+const QString ThumbnailPack::extension()
+{
+    return QStringLiteral(".thumbs");
+}
+
+bool ThumbnailPack::map() const
+{
+    unmap();
+    if (m_size <= 0 || !m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_data = m_file.map(0, m_size);
+    if (m_data == nullptr) {
+        m_file.close();
+        return false;
+    }
+    m_mapped = m_size;
+    return true;
+}
+
+void ThumbnailPack::unmap() const
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_mapped = 0;
+    m_file.close();
+}
+
+void ThumbnailPack::load()
+{
+    m_index.clear();
+    m_size = QFileInfo(m_path).size();
+    if (m_size < qint64(sizeof(PackHeader)) || !map()) {
+        m_size = 0;
+        return;
+    }
+    if (memcmp(m_data, packMagic, 4) != 0 || reinterpret_cast<const PackHeader *>(m_data)->version != packVersion) {
+        qDebug() << "Discarding thumbnail pack with unknown format" << m_path;
+        unmap();
+        m_size = 0;
+        QFile::remove(m_path);
+        return;
+    }
+    qint64 offset = sizeof(PackHeader);
+    qint64 used = 0;
+    while (offset + qint64(sizeof(RecordHeader)) <= m_mapped) {
+        RecordHeader record;
+        memcpy(&record, m_data + offset, sizeof(RecordHeader));
+        const qint64 payload = offset + qint64(sizeof(RecordHeader));
+        if (payload + record.length > m_mapped) {
+            // Truncated record, the application was probably interrupted while writing it
+            break;
+        }
+        auto previous = m_index.find(record.position);
+        if (previous != m_index.end()) {
+            used -= previous->second.length;
+        }
+        m_index[record.position] = {payload, record.length};
+        used += record.length;
+        offset = payload + record.length;
+    }
+    if (offset < m_mapped) {
+        // Drop the truncated record, so that no stale data is left after the records appended later
+        unmap();
+        m_size = offset;
+        if (!QFile::resize(m_path, m_size)) {
+            qDebug() << "Cannot truncate thumbnail pack" << m_path;
+        }
+        if (!map()) {
+            m_index.clear();
+            m_size = 0;
+            return;
+        }
+    }
+    if (used < (m_size - qint64(sizeof(PackHeader))) / 2) {
+        compact();
+    }
+}
+
+void ThumbnailPack::compact()
+{
+    if (m_mapped < m_size && !map()) {
+        return;
+    }
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot compact thumbnail pack" << m_path;
+        return;
+    }
+    file.write(packHeader());
+    std::unordered_map<int, Record> index;
+    qint64 offset = sizeof(PackHeader);
+    for (const auto &entry : m_index) {
+        const RecordHeader record{entry.first, entry.second.length};
+        file.write(reinterpret_cast<const char *>(&record), sizeof(RecordHeader));
+        file.write(reinterpret_cast<const char *>(m_data + entry.second.offset), entry.second.length);
+        offset += qint64(sizeof(RecordHeader));
+        index[entry.first] = {offset, entry.second.length};
+        offset += entry.second.length;
+    }
+    // The file is replaced on commit, release the current mapping first
+    unmap();
+    if (!file.commit()) {
+        // Keep using the index of the current file, it was left untouched
+        qDebug() << "Cannot compact thumbnail pack" << m_path;
+        map();
+        return;
+    }
+    m_index = std::move(index);
+    m_size = offset;
+}
+
+bool ThumbnailPack::contains(int pos) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_index.find(pos) != m_index.end();
+}
+
+QImage ThumbnailPack::image(int pos) const
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_index.find(pos);
+    if (it == m_index.end()) {
+        return QImage();
+    }
+    const Record &record = it->second;
+    if (record.offset + record.length > m_mapped && !map()) {
+        return QImage();
+    }
+    // Copy the payload so that the image is decoded without holding the lock
+    const QByteArray payload(reinterpret_cast<const char *>(m_data + record.offset), int(record.length));
+    lock.unlock();
+    return QImage::fromData(payload, "JPG");
+}
+
+std::vector<int> ThumbnailPack::positions() const
+{
+    QMutexLocker lock(&m_mutex);
+    std::vector<int> result;
+    result.reserve(m_index.size());
+    for (const auto &entry : m_index) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+bool ThumbnailPack::append(int pos, const QImage &img)
+{
+    const QByteArray payload = encode(img);
+    if (payload.isEmpty()) {
+        return false;
+    }
+    QMutexLocker lock(&m_mutex);
+    return appendRecord(pos, payload);
+}
+
+bool ThumbnailPack::appendRecord(int pos, const QByteArray &payload)
+{
+    if (!m_writer.isOpen() && !m_writer.open(QIODevice::ReadWrite)) {
+        qDebug() << "Cannot write thumbnail pack" << m_path;
+        return false;
+    }
+    if (m_size == 0) {
+        m_writer.resize(0);
+        m_writer.write(packHeader());
+        m_size = sizeof(PackHeader);
+    }
+    m_writer.seek(m_size);
+    const RecordHeader record{pos, quint32(payload.size())};
+    if (m_writer.write(reinterpret_cast<const char *>(&record), sizeof(RecordHeader)) != qint64(sizeof(RecordHeader)) ||
+        m_writer.write(payload) != payload.size() || !m_writer.flush()) {
+        qDebug() << "Error writing thumbnail pack" << m_path;
+        // Drop the partial record
+        m_writer.resize(m_size);
+        return false;
+    }
+    m_index[pos] = {m_size + qint64(sizeof(RecordHeader)), record.length};
+    m_size += qint64(sizeof(RecordHeader)) + payload.size();
+    return true;
+}
+
+void ThumbnailPack::importFiles(const QDir &dir, const QString &hash)
+{
+    const QStringList files = dir.entryList({hash + QStringLiteral("#*.jpg")}, QDir::Files);
+    if (files.isEmpty()) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    const int start = hash.size() + 1;
+    for (const QString &file : files) {
+        bool ok = false;
+        int pos = file.mid(start, file.size() - start - 4).toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        QFile thumb(dir.absoluteFilePath(file));
+        if (m_index.find(pos) == m_index.end() && thumb.open(QIODevice::ReadOnly)) {
+            const QByteArray payload = thumb.readAll();
+            thumb.close();
+            if (payload.isEmpty() || !appendRecord(pos, payload)) {
+                continue;
+            }
+        }
+        thumb.remove();
+    }
+}
+
+void ThumbnailPack::remove()
+{
+    QMutexLocker lock(&m_mutex);
+    unmap();
+    m_writer.close();
+    m_index.clear();
+    m_size = 0;
+    QFile::remove(m_path);
+}
@@ -0,0 +1,74 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    This file is part of kdenlive. See www.kdenlive.org.
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <unordered_map>
+#include <vector>
+
+/** @class ThumbnailPack
+    @brief The persistent video thumbnails of a clip, stored in a single file.
+    The file starts with a small header followed by records appended one after the other,
+    each made of the frame position, the payload length and the JPEG data.
+    When the pack is opened, the record headers are read once from the memory mapped file
+    to build an index of positions, so that looking up or reading a thumbnail does not require
+    any filesystem access. Writes only append new records at the end of the file; a record
+    for an already stored position replaces the previous one, whose space is reclaimed when
+    the pack is opened if more than half of the file is unused.
+ */
+class ThumbnailPack
+{
+public:
+    /** @brief Opens (without creating it) the pack stored in @param path */
+    explicit ThumbnailPack(const QString &path);
+    ~ThumbnailPack();
+
+    /** @brief The extension of the pack files in the thumbnails folder */
+    static const QString extension();
+
+    bool contains(int pos) const;
+    /** @brief Returns the stored thumbnail for @param pos, or a null image */
+    QImage image(int pos) const;
+    /** @brief Returns the positions of all the stored thumbnails */
+    std::vector<int> positions() const;
+    /** @brief Appends the thumbnail @param img for frame @param pos to the pack, creating the file if needed */
+    bool append(int pos, const QImage &img);
+    /** @brief Moves thumbnails stored as individual files by older versions (named "hash#pos.jpg" in @param dir) into the pack */
+    void importFiles(const QDir &dir, const QString &hash);
+    /** @brief Deletes the pack file and all its thumbnails */
+    void remove();
+
+private:
+    struct Record
+    {
+        qint64 offset;
+        quint32 length;
+    };
+    QString m_path;
+    mutable QMutex m_mutex;
+    // Read only memory mapping of the file, remapped when records were appended beyond it
+    mutable QFile m_file;
+    mutable uchar *m_data{nullptr};
+    mutable qint64 m_mapped{0};
+    // Size of the valid part of the file, new records are written there
+    qint64 m_size{0};
+    std::unordered_map<int, Record> m_index;
+    QFile m_writer;
+
+    /** @brief Reads the index from the file, truncating the file if its last record is incomplete. */
+    void load();
+    /** @brief Rewrites the file with only the latest record of each position. If the file cannot be written, the current one stays in use. */
+    void compact();
+    bool map() const;
+    void unmap() const;
+    bool appendRecord(int pos, const QByteArray &payload);
+};
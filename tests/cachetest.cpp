@@ -15,7 +15,13 @@
 
 #include "core.h"
 #include "definitions.h"
+#include "utils/mediahashindex.hpp"
 #include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailpack.hpp"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTemporaryDir>
 
 TEST_CASE("Cache insert-remove", "[Cache]")
 {
@@ -50,6 +56,29 @@ TEST_CASE("Cache insert-remove", "[Cache]")
         ThumbnailCache::get()->storeThumbnail(binId, 0, img, false);
         REQUIRE(ThumbnailCache::get()->checkIntegrity());
     }
+    SECTION("Memory budget and counters")
+    {
+        // 40 kB per image, the budget of each of the 16 shards holds 15 of them
+        QImage img(100, 100, QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::red);
+        const ThumbnailCache::Statistics before = ThumbnailCache::get()->statistics();
+        // The thumbnails of a clip are spread over all the shards, older ones get dropped once their shard is full
+        for (int pos = 0; pos < 1000; ++pos) {
+            ThumbnailCache::get()->storeThumbnail(binId, pos, img, false);
+        }
+        REQUIRE(ThumbnailCache::get()->checkIntegrity());
+        ThumbnailCache::Statistics stats = ThumbnailCache::get()->statistics();
+        REQUIRE(stats.evictions > before.evictions);
+        REQUIRE(stats.bytes <= 10000000);
+        REQUIRE(stats.bytes >= 9000000);
+        for (int pos = 995; pos < 1000; ++pos) {
+            REQUIRE(ThumbnailCache::get()->getThumbnail(binId, pos, true) == img);
+        }
+        REQUIRE(ThumbnailCache::get()->getThumbnail(binId, 0, true).isNull());
+        stats = ThumbnailCache::get()->statistics();
+        REQUIRE(stats.hits > before.hits);
+        REQUIRE(stats.misses > before.misses);
+    }
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
 
@@ -94,3 +123,144 @@ TEST_CASE("getAudioKey() should dereference `ok` param", "ThumbnailCache") {
     }
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
+
+TEST_CASE("Thumbnail pack file", "[Cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("clip") + ThumbnailPack::extension());
+    QImage red(64, 36, QImage::Format_RGB32);
+    red.fill(Qt::red);
+    QImage blue(64, 36, QImage::Format_RGB32);
+    blue.fill(Qt::blue);
+
+    SECTION("Stored thumbnails are found after reopening")
+    {
+        {
+            ThumbnailPack pack(path);
+            REQUIRE_FALSE(pack.contains(0));
+            REQUIRE(pack.append(0, red));
+            REQUIRE(pack.append(25, blue));
+            REQUIRE(pack.contains(25));
+            REQUIRE(pack.image(0).pixelColor(10, 10).red() > 200);
+        }
+        ThumbnailPack pack(path);
+        REQUIRE(pack.positions().size() == 2);
+        REQUIRE(pack.image(0).size() == red.size());
+        REQUIRE(pack.image(25).pixelColor(10, 10).blue() > 200);
+        REQUIRE(pack.image(12).isNull());
+    }
+
+    SECTION("The last record of a position wins and a truncated record is dropped")
+    {
+        {
+            ThumbnailPack pack(path);
+            REQUIRE(pack.append(0, red));
+            REQUIRE(pack.append(0, blue));
+            REQUIRE(pack.append(10, red));
+        }
+        QFile file(path);
+        const qint64 tornSize = file.size() - 10;
+        REQUIRE(file.resize(tornSize));
+        ThumbnailPack pack(path);
+        // The incomplete record is removed from the file
+        REQUIRE(QFileInfo(path).size() < tornSize);
+        REQUIRE(pack.contains(0));
+        REQUIRE_FALSE(pack.contains(10));
+        REQUIRE(pack.image(0).pixelColor(10, 10).blue() > 200);
+        REQUIRE(pack.append(10, red));
+        REQUIRE(pack.image(10).pixelColor(10, 10).red() > 200);
+    }
+
+    SECTION("A pack that cannot be compacted stays usable")
+    {
+        ThumbnailPack pack(path);
+        REQUIRE(pack.append(0, red));
+        // Replaced records make most of the file unused
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(pack.append(0, blue));
+        }
+        // The compacted file cannot be created in a missing folder
+        pack.m_path = dir.filePath(QStringLiteral("missing/clip") + ThumbnailPack::extension());
+        pack.compact();
+        pack.m_path = path;
+        REQUIRE(pack.positions().size() == 1);
+        REQUIRE(pack.image(0).pixelColor(10, 10).blue() > 200);
+        REQUIRE(pack.append(5, red));
+        REQUIRE(pack.image(5).pixelColor(10, 10).red() > 200);
+        REQUIRE(QFileInfo::exists(path));
+    }
+
+    SECTION("Thumbnails stored in individual files are imported")
+    {
+        REQUIRE(red.save(dir.filePath(QStringLiteral("clip#5.jpg"))));
+        ThumbnailPack pack(path);
+        pack.importFiles(QDir(dir.path()), QStringLiteral("clip"));
+        REQUIRE(pack.contains(5));
+        REQUIRE_FALSE(QFile::exists(dir.filePath(QStringLiteral("clip#5.jpg"))));
+        pack.remove();
+        REQUIRE_FALSE(pack.contains(5));
+        REQUIRE_FALSE(QFile::exists(path));
+    }
+}
+
+TEST_CASE("Media hash index", "[Cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    auto writeFile = [](const QString &path, const QByteArray &data) {
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(data);
+        file.close();
+    };
+    const QString path = dir.filePath(QStringLiteral("media.dat"));
+    const QByteArray first(1000, 'a');
+    const QByteArray second(1000, 'b');
+    writeFile(path, first);
+    const QByteArray firstHash = QCryptographicHash::hash(first, QCryptographicHash::Md5);
+    const QByteArray secondHash = QCryptographicHash::hash(second, QCryptographicHash::Md5);
+    // Keep the index in the temporary folder instead of the user cache
+    const QString indexFile = dir.filePath(QStringLiteral("mediahashes"));
+    MediaHashIndex index(indexFile);
+
+    SECTION("Unchanged files are not read again")
+    {
+        REQUIRE(index.hash(path) == qMakePair(firstHash, qint64(1000)));
+        // Replace the content but keep the size and modification time, the stored hash is returned
+        QDateTime modified = QFileInfo(path).lastModified();
+        writeFile(path, second);
+        {
+            QFile file(path);
+            REQUIRE(file.open(QIODevice::ReadWrite));
+            REQUIRE(file.setFileTime(modified, QFileDevice::FileModificationTime));
+        }
+        REQUIRE(index.hash(path).first == firstHash);
+        // A new modification time invalidates the entry
+        {
+            QFile file(path);
+            REQUIRE(file.open(QIODevice::ReadWrite));
+            REQUIRE(file.setFileTime(modified.addSecs(10), QFileDevice::FileModificationTime));
+        }
+        REQUIRE(index.hash(path).first == secondHash);
+        // A new size invalidates the entry
+        writeFile(path, first + first);
+        REQUIRE(index.hash(path).second == 2000);
+        // The hashes are stored for the next session
+        MediaHashIndex reloaded(indexFile);
+        REQUIRE(reloaded.m_entries.count(path) == 1);
+    }
+
+    SECTION("Batch hashing")
+    {
+        const QString other = dir.filePath(QStringLiteral("other.dat"));
+        writeFile(other, second);
+        const QString missing = dir.filePath(QStringLiteral("missing.dat"));
+        const QMap<QString, QPair<QByteArray, qint64>> hashes = index.hashFiles({path, other, missing, path});
+        REQUIRE(hashes.count() == 3);
+        REQUIRE(hashes.value(path).first == firstHash);
+        REQUIRE(hashes.value(other).first == secondHash);
+        REQUIRE(hashes.value(missing).first.isEmpty());
+        REQUIRE(hashes.value(path) == MediaHashIndex::computeHash(path));
+    }
+}
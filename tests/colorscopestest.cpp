@@ -9,6 +9,7 @@
 #include "scopes/colorscopes/waveformgenerator.h"
 #include "scopes/colorscopes/rgbparadegenerator.h"
 #include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/scopekernels.h"
 
 // test for a bug where pixels were assumed to be RGB which was not true on
 // Windows, resulting in red and blue switched. BUG: 453149
@@ -80,3 +81,90 @@ TEST_CASE("Colorscope RGB/BGR handling")
         CHECK(rgbScope == bgrScope);
     }
 }
+
+TEST_CASE("Colorscope kernels")
+{
+    // an image with many different colors, large enough to be split in several bands
+    QImage inputImage(1023, 777, QImage::Format_RGB32);
+    for (int y = 0; y < inputImage.height(); ++y) {
+        for (int x = 0; x < inputImage.width(); ++x) {
+            inputImage.setPixel(x, y, qRgb(x % 256, y % 256, (x * y) % 256));
+        }
+    }
+
+    SECTION("Vectorized luma matches the per pixel luma")
+    {
+        const auto *line = reinterpret_cast<const QRgb *>(inputImage.constScanLine(10));
+        std::vector<float> luma(size_t(inputImage.width()));
+        for (ITURec rec : {ITURec::Rec_601, ITURec::Rec_709}) {
+            ScopeKernels::luma(line, inputImage.width(), rec, luma.data());
+            for (int x = 0; x < inputImage.width(); ++x) {
+                CHECK(luma[size_t(x)] == ScopeKernels::pixelLuma(line[x], rec));
+            }
+        }
+    }
+
+    SECTION("Scopes do not depend on the number of threads")
+    {
+        QSize scopeSize{300, 256};
+        VectorscopeGenerator vectorscope{};
+        WaveformGenerator waveform{};
+        RGBParadeGenerator rgb{};
+        HistogramGenerator hist{};
+        const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentR |
+                                    HistogramGenerator::Components::ComponentG | HistogramGenerator::Components::ComponentB |
+                                    HistogramGenerator::Components::ComponentSum;
+        auto compute = [&]() {
+            return QList<QImage>{vectorscope.calculateVectorscope(scopeSize, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                                                  VectorscopeGenerator::ColorSpace::ColorSpace_YUV, false, 1),
+                                 vectorscope.calculateVectorscope(scopeSize, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                                                  VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, 3),
+                                 waveform.calculateWaveform(scopeSize, inputImage, WaveformGenerator::PaintMode::PaintMode_Yellow, false, ITURec::Rec_709, 1),
+                                 waveform.calculateWaveform(scopeSize, inputImage, WaveformGenerator::PaintMode::PaintMode_Yellow, false, ITURec::Rec_601, 3),
+                                 rgb.calculateRGBParade(scopeSize, inputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, true, true, 1),
+                                 hist.calculateHistogram(scopeSize, inputImage, ALL_COMPONENTS, ITURec::Rec_709, false, false, 1),
+                                 hist.calculateHistogram(scopeSize, inputImage, ALL_COMPONENTS, ITURec::Rec_601, true, true, 2)};
+        };
+        ScopeKernels::setMaxThreads(1);
+        const QList<QImage> singleThread = compute();
+        ScopeKernels::setMaxThreads(4);
+        const QList<QImage> multiThread = compute();
+        ScopeKernels::setMaxThreads(0);
+        REQUIRE(singleThread.size() == multiThread.size());
+        for (int i = 0; i < singleThread.size(); ++i) {
+            CHECK(singleThread.at(i) == multiThread.at(i));
+        }
+    }
+
+    SECTION("A single pass fills the bins of all scopes")
+    {
+        QSize scopeSize{300, 256};
+        const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentR |
+                                    HistogramGenerator::Components::ComponentG | HistogramGenerator::Components::ComponentB |
+                                    HistogramGenerator::Components::ComponentSum;
+        VectorscopeGenerator vectorscope{};
+        WaveformGenerator waveform{};
+        RGBParadeGenerator rgb{};
+        HistogramGenerator hist{};
+        VectorscopeGenerator::Bins vectorscopeBins(scopeSize, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                                   VectorscopeGenerator::ColorSpace::ColorSpace_YUV, 2);
+        WaveformGenerator::Bins waveformBins(scopeSize, ITURec::Rec_709, 1);
+        RGBParadeGenerator::Bins paradeBins(scopeSize, 3);
+        HistogramGenerator::Bins histogramBins(ALL_COMPONENTS, ITURec::Rec_709, 1);
+        ScopeKernels::analyse(inputImage, ScopeKernels::toRgb32(inputImage), {&vectorscopeBins, &waveformBins, &paradeBins, &histogramBins});
+
+        CHECK(vectorscope.drawVectorscope(vectorscopeBins, VectorscopeGenerator::PaintMode::PaintMode_Green2) ==
+              vectorscope.calculateVectorscope(scopeSize, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YUV, false, 2));
+        CHECK(waveform.drawWaveform(waveformBins, WaveformGenerator::PaintMode::PaintMode_Yellow, true) ==
+              waveform.calculateWaveform(scopeSize, inputImage, WaveformGenerator::PaintMode::PaintMode_Yellow, true, ITURec::Rec_709, 1));
+        CHECK(rgb.drawRGBParade(paradeBins, RGBParadeGenerator::PaintMode::PaintMode_RGB, true, false) ==
+              rgb.calculateRGBParade(scopeSize, inputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, true, false, 3));
+        CHECK(hist.drawHistogram(histogramBins, scopeSize, ALL_COMPONENTS, false, true) ==
+              hist.calculateHistogram(scopeSize, inputImage, ALL_COMPONENTS, ITURec::Rec_709, false, true, 1));
+        // The bins are only reusable with the same settings
+        CHECK(waveformBins.sameBins(WaveformGenerator::Bins(scopeSize, ITURec::Rec_709, 1)));
+        CHECK_FALSE(waveformBins.sameBins(WaveformGenerator::Bins(scopeSize, ITURec::Rec_601, 1)));
+        CHECK_FALSE(waveformBins.sameBins(paradeBins));
+    }
+}
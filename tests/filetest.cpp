@@ -6,11 +6,14 @@
 #include "test_utils.hpp"
 // test specific headers
 #include "bin/binplaylist.hpp"
+#include "bin/filewatcher.hpp"
 #include "doc/kdenlivedoc.h"
 #include "timeline2/model/builders/meltBuilder.hpp"
 #include "xml/xml.hpp"
 
+#include <QTemporaryDir>
 #include <QTemporaryFile>
+#include <QThread>
 #include <QUndoGroup>
 
 using namespace fakeit;
@@ -418,6 +421,10 @@ TEST_CASE("Opening Mix", "[OPENMIX]")
         REQUIRE(timeline->getTrackById_const(mixtrackId)->mixCount() == 2);
         int mixtrackId2 = timeline->getTrackIndexFromPosition(3);
         REQUIRE(timeline->getTrackById_const(mixtrackId2)->mixCount() == 1);
+        // Clips were inserted without notifying the view, it must see all of them after loading
+        REQUIRE(timeline->rowCount(timeline->makeTrackIndexFromID(mixtrackId)) == timeline->getTrackClipsCount(mixtrackId));
+        REQUIRE(timeline->rowCount(timeline->makeTrackIndexFromID(mixtrackId2)) == timeline->getTrackClipsCount(mixtrackId2));
+        REQUIRE(timeline->duration() > 0);
 
         QDomDocument *newDoc = &openedDoc->m_document;
         auto producers = newDoc->elementsByTagName(QStringLiteral("producer"));
@@ -472,3 +479,154 @@ TEST_CASE("Opening File With Keyframes", "[OPENKFRS]")
         pCore->projectManager()->closeCurrentDocument(false, false);
     }
 }
+
+// Ids of the loaded bin clips, filled by the timeline builder
+extern std::unordered_map<QString, QString> binIdCorresp;
+
+TEST_CASE("Bulk timeline construction", "[BULK]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    pCore->projectManager()->m_project = &document;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    pCore->projectManager()->updateTimeline(false, QString(), QString(), documentDate, 0);
+    auto timeline = document.getTimeline(document.uuid());
+    pCore->projectManager()->testSetActiveDocument(&document, timeline);
+
+    // The color is the resource of the producer, it identifies the bin clip
+    const std::string color("#3a5f7c1d");
+    QString binId = createProducer(pCore->getProjectProfile(), color, binModel, 20, false);
+    Mlt::Profile &profile = pCore->getProjectProfile();
+    // A timeline clip referencing a bin id that was not loaded
+    Mlt::Producer source(profile, "color", color.c_str());
+    source.set("length", 20);
+    source.set("out", 19);
+    source.set("kdenlive:id", "999");
+    Mlt::Playlist playlist(profile);
+    playlist.append(source, 0, 9);
+    Mlt::Tractor tractor(profile);
+    tractor.set_track(playlist, 0);
+    binIdCorresp = {{QStringLiteral("1"), binId}};
+
+    SECTION("Url keys")
+    {
+        auto clip = binModel->getClipByBinID(binId);
+        const std::unordered_map<QString, QStringList> clips = binModel->getClipsByUrl();
+        auto match = clips.find(ProjectItemModel::urlKey(QFileInfo(clip->clipUrl())));
+        REQUIRE(match != clips.end());
+        REQUIRE(match->second.contains(binId));
+        // Missing files are identified by their absolute path, existing ones by their canonical path
+        const QFileInfo missing(QStringLiteral("missing.mp4"));
+        REQUIRE(ProjectItemModel::urlKey(missing) == missing.absoluteFilePath());
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        const QString target = dir.filePath(QStringLiteral("media.mp4"));
+        QFile file(target);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.close();
+        const QString link = dir.filePath(QStringLiteral("link.mp4"));
+        REQUIRE(QFile::link(target, link));
+        REQUIRE(ProjectItemModel::urlKey(QFileInfo(link)) == ProjectItemModel::urlKey(QFileInfo(target)));
+    }
+
+    SECTION("A clip with a broken bin id is recovered from its url")
+    {
+        REQUIRE(constructTimelineFromTractor(timeline, nullptr, tractor, QString()));
+        REQUIRE(timeline->getTracksCount() == 1);
+        int tid = timeline->getTrackIndexFromPosition(0);
+        REQUIRE(timeline->getTrackClipsCount(tid) == 1);
+        REQUIRE(timeline->getClipBinId(timeline->getClipByPosition(tid, 0)) == binId);
+        REQUIRE(timeline->rowCount(timeline->makeTrackIndexFromID(tid)) == 1);
+        REQUIRE(timeline->checkConsistency());
+    }
+
+    SECTION("A failed load is rolled back")
+    {
+        // A double track whose content is not a playlist cannot be loaded
+        Mlt::Producer other(profile, "color", "red");
+        Mlt::Tractor invalidTrack(profile);
+        invalidTrack.set_track(other, 0);
+        tractor.set_track(invalidTrack, 1);
+        const int tracksCount = timeline->getTracksCount();
+        int removedClipRows = 0;
+        QMetaObject::Connection connection =
+            QObject::connect(timeline.get(), &QAbstractItemModel::rowsRemoved, [&removedClipRows](const QModelIndex &parent, int, int) {
+                if (parent.isValid()) {
+                    removedClipRows++;
+                }
+            });
+        REQUIRE_FALSE(constructTimelineFromTractor(timeline, nullptr, tractor, QString()));
+        QObject::disconnect(connection);
+        // The view was reset with the loaded clip, so the rollback must notify its removal
+        REQUIRE(removedClipRows > 0);
+        REQUIRE(timeline->getTracksCount() == tracksCount);
+        REQUIRE(timeline->checkConsistency());
+    }
+    binIdCorresp.clear();
+    pCore->projectManager()->closeCurrentDocument(false, false);
+}
+
+TEST_CASE("File watcher above its watch budget", "[WATCH]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    // Files in separate folders are watched one by one
+    QStringList paths;
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(QDir(dir.path()).mkdir(QString::number(i)));
+        paths << dir.filePath(QStringLiteral("%1/clip.txt").arg(i));
+        QFile file(paths.last());
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("clip");
+    }
+    FileWatcher watcher;
+    watcher.m_watchBudget = 2;
+    QStringList waiting;
+    QObject::connect(&watcher, &FileWatcher::binClipWaiting, [&waiting](const QString &binId) { waiting << binId; });
+    for (int i = 0; i < 3; ++i) {
+        watcher.addFile(QString::number(i + 1), paths.at(i));
+    }
+    watcher.slotProcessQueue();
+    REQUIRE(watcher.m_watchedFiles.size() == 2);
+    REQUIRE(watcher.m_polledUrls.size() == 1);
+    const QString polled = watcher.m_polledUrls.begin()->first;
+    const QString polledId = QString::number(paths.indexOf(polled) + 1);
+    // The files are only queried in the background thread
+    REQUIRE_FALSE(watcher.m_polledUrls.at(polled).known);
+    const auto poll = [&watcher]() {
+        watcher.slotPollUrls();
+        watcher.m_pollWatcher.waitForFinished();
+        // Deliver the finished signal of the poll
+        QCoreApplication::processEvents();
+    };
+
+    SECTION("Polled files report their changes")
+    {
+        poll();
+        REQUIRE(watcher.m_polledUrls.at(polled).known);
+        // The first poll only reads the state of the file
+        REQUIRE(waiting.isEmpty());
+        // Leave time for the change time to differ
+        QThread::msleep(100);
+        QFile file(polled);
+        REQUIRE(file.open(QIODevice::Append));
+        file.write("modified");
+        file.close();
+        poll();
+        CHECK(waiting == QStringList({polledId}));
+        // The clip is reloaded by a later poll, once the file is not written anymore
+        CHECK(watcher.m_modifiedUrls.count(polled) == 1);
+    }
+
+    SECTION("Polled files are watched when a watch is released")
+    {
+        watcher.removeFile(polledId == QLatin1String("1") ? QStringLiteral("2") : QStringLiteral("1"));
+        CHECK(watcher.m_polledUrls.empty());
+        CHECK(watcher.m_watchedFiles.size() == 2);
+        CHECK(watcher.m_watchedFiles.count(polled) == 1);
+        CHECK_FALSE(watcher.m_pollTimer.isActive());
+    }
+    watcher.m_pollWatcher.waitForFinished();
+}
@@ -268,6 +268,27 @@ TEST_CASE("Keyframe model", "[KeyframeModel]")
         undoStack->undo();
         state1(6.1);
     }
+
+    SECTION("Interpolated values follow keyframe edits")
+    {
+        REQUIRE(model->addKeyframe(GenTime(2.), KeyframeType::Linear, 0.8));
+        REQUIRE(model->getPosAtIndex(0) == GenTime(0.));
+        REQUIRE(model->getPosAtIndex(1) == GenTime(2.));
+        REQUIRE(model->getPosAtIndex(2) == GenTime());
+        QVector<QVariant> values = model->getInterpolatedValues(0, 60);
+        REQUIRE(values.size() == 61);
+        for (int frame = 0; frame <= 60; ++frame) {
+            REQUIRE(values.at(frame) == model->getInterpolatedValue(frame));
+        }
+        REQUIRE(qFuzzyCompare(model->getInterpolatedValue(60).toDouble(), 0.8));
+
+        // The parsed animation must not be reused after an edit
+        REQUIRE(model->updateKeyframe(GenTime(2.), QVariant(0.2)));
+        REQUIRE(qFuzzyCompare(model->getInterpolatedValue(60).toDouble(), 0.2));
+        REQUIRE(qFuzzyCompare(model->getInterpolatedValues(55, 60).last().toDouble(), 0.2));
+        undoStack->undo();
+        REQUIRE(qFuzzyCompare(model->getInterpolatedValue(60).toDouble(), 0.8));
+    }
     clip.reset();
     timeline.reset();
     pCore->projectManager()->closeCurrentDocument(false, false);
@@ -7,7 +7,10 @@
 #include "test_utils.hpp"
 // test specific headers
 #include "doc/kdenlivedoc.h"
+#include <QElapsedTimer>
 #include <QUndoGroup>
+#include <atomic>
+#include <thread>
 
 using namespace fakeit;
 std::default_random_engine g(42);
@@ -2239,3 +2242,66 @@ TEST_CASE("New KdenliveDoc activeTrack", "KdenliveDoc")
         pCore->projectManager()->closeCurrentDocument(false, false);
     }
 }
+
+TEST_CASE("Timeline getters benchmark", "[.][ClipModel][benchmark]")
+{
+    // Not run by default, use the [benchmark] tag to run it
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    pCore->projectManager()->m_project = &document;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    pCore->projectManager()->updateTimeline(false, QString(), QString(), documentDate, 0);
+    auto timeline = document.getTimeline(document.uuid());
+    pCore->projectManager()->m_activeTimelineModel = timeline;
+    pCore->projectManager()->testSetActiveDocument(&document, timeline);
+
+    QString binId = createProducer(pCore->getProjectProfile(), "red", binModel, 20, false);
+    int tid = timeline->getTrackIndexFromPosition(1);
+    std::vector<int> clips;
+    for (int i = 0; i < 200; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, 20 * i, cid));
+        clips.push_back(cid);
+    }
+
+    // Calls the getters used by the timeline delegates and returns the number of calls per millisecond
+    auto measure = [&timeline, &clips]() {
+        const int rounds = 200;
+        qint64 total = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int round = 0; round < rounds; ++round) {
+            for (int cid : clips) {
+                total += timeline->getClipPosition(cid) + timeline->getClipTrackId(cid) + timeline->getItemTrackId(cid);
+            }
+        }
+        REQUIRE(total > 0);
+        return double(rounds * clips.size() * 3) / qMax(qint64(1), timer.elapsed());
+    };
+    qDebug() << "Getter calls per ms without contention:" << measure();
+
+    // Background tasks reading the model at the same time
+    std::atomic<bool> running{true};
+    std::atomic<qint64> backgroundCalls{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&timeline, &clips, &running, &backgroundCalls]() {
+            while (running) {
+                for (int cid : clips) {
+                    if (timeline->getClipPosition(cid) >= 0 && timeline->getItemPlaytime(cid) > 0) {
+                        backgroundCalls++;
+                    }
+                }
+            }
+        });
+    }
+    qDebug() << "Getter calls per ms with 4 background readers:" << measure();
+    running = false;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    REQUIRE(backgroundCalls > 0);
+    pCore->projectManager()->closeCurrentDocument(false, false);
+}
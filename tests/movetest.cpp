@@ -108,5 +108,35 @@ TEST_CASE("Cut undo/redo", "[MoveClips]")
         undoStack->redo();
         undoStack->undo();
     }
+    SECTION("Position lookups follow moves and resizes")
+    {
+        auto track = timeline->getTrackById_const(tid3);
+        REQUIRE(timeline->getClipByPosition(tid3, 100) == cid5);
+        REQUIRE(timeline->getClipByPosition(tid3, 199) == cid5);
+        REQUIRE(timeline->getClipByPosition(tid3, 200) == -1);
+        REQUIRE(track->getClipByStartPosition(100) == cid5);
+        REQUIRE(track->getClipsInRange(0, 100).empty());
+        REQUIRE(track->getClipsInRange(150, 160) == std::unordered_set<int>{cid5});
+
+        // Move the clip, the previous position must not be found anymore
+        REQUIRE(timeline->requestClipMove(cid5, tid3, 300));
+        REQUIRE(timeline->getClipByPosition(tid3, 150) == -1);
+        REQUIRE(timeline->getClipByPosition(tid3, 350) == cid5);
+        REQUIRE(track->getClipByStartPosition(100) == -1);
+        REQUIRE(track->getClipByStartPosition(300) == cid5);
+        REQUIRE(track->getClipsInRange(0, 300).empty());
+
+        // Resize it
+        REQUIRE(timeline->requestItemResize(cid5, 50, true) == 50);
+        REQUIRE(timeline->getClipByPosition(tid3, 349) == cid5);
+        REQUIRE(timeline->getClipByPosition(tid3, 350) == -1);
+        REQUIRE(track->getClipsInRange(350, -1).empty());
+
+        undoStack->undo();
+        undoStack->undo();
+        REQUIRE(timeline->getClipByPosition(tid3, 150) == cid5);
+        REQUIRE(timeline->getClipByPosition(tid3, 350) == -1);
+        REQUIRE(track->getClipsInRange(0, -1) == std::unordered_set<int>{cid5});
+    }
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
@@ -5,10 +5,15 @@
 #include "test_utils.hpp"
 // test specific headers
 #include "doc/kdenlivedoc.h"
+#include "render/renderqueue.h"
 #include "render/renderrequest.h"
+#include "render/rendersegments.h"
 #include "renderpresets/renderpresetmodel.hpp"
 #include "renderpresets/renderpresetrepository.hpp"
 
+#include <QDomDocument>
+#include <QTemporaryFile>
+
 TEST_CASE("Basic tests of the render preset model", "[RenderPresets]")
 {
 
@@ -293,3 +298,128 @@ TEST_CASE("Tests of the render functions to use guides for sections", "[RenderRe
         CHECK(sections.at(2).out == out);
     }
 }
+
+TEST_CASE("Render queue admission and persistence", "[RenderQueue]")
+{
+    auto makeJob = [](const QString &output, int threads, int memory) {
+        RenderQueue::Job job;
+        job.output = output;
+        job.args = QStringList{QStringLiteral("delivery"), QStringLiteral("melt"), output + QStringLiteral(".mlt")};
+        job.threads = threads;
+        job.memory = memory;
+        return job;
+    };
+    RenderQueue queue;
+    REQUIRE(queue.append(makeJob(QStringLiteral("a.mp4"), 4, 1000)));
+    REQUIRE(queue.append(makeJob(QStringLiteral("b.mp4"), 4, 1000)));
+    REQUIRE(queue.append(makeJob(QStringLiteral("c.mp4"), 8, 1000)));
+    REQUIRE(queue.append(makeJob(QStringLiteral("d.mp4"), 2, 1000)));
+    // A job writing the same file is refused while the first one is pending
+    CHECK_FALSE(queue.append(makeJob(QStringLiteral("a.mp4"), 1, 0)));
+
+    RenderQueue::Limits limits;
+    limits.threads = 8;
+
+    SECTION("Threads")
+    {
+        CHECK(queue.admissible(limits) == QStringList({QStringLiteral("a.mp4"), QStringLiteral("b.mp4")}));
+        queue.setStatus(QStringLiteral("a.mp4"), RenderQueue::Running);
+        queue.setStatus(QStringLiteral("b.mp4"), RenderQueue::Running);
+        // The large job is not overtaken by the small one behind it
+        CHECK(queue.admissible(limits).isEmpty());
+        queue.setStatus(QStringLiteral("a.mp4"), RenderQueue::Finished);
+        CHECK(queue.admissible(limits).isEmpty());
+        queue.setStatus(QStringLiteral("b.mp4"), RenderQueue::Failed);
+        CHECK(queue.admissible(limits) == QStringList({QStringLiteral("c.mp4")}));
+    }
+
+    SECTION("Job count and memory")
+    {
+        limits.threads = 64;
+        limits.jobs = 3;
+        CHECK(queue.admissible(limits).count() == 3);
+        limits.memory = 2500;
+        CHECK(queue.admissible(limits).count() == 2);
+        // A job larger than the limits still runs alone
+        limits.memory = 100;
+        CHECK(queue.admissible(limits) == QStringList({QStringLiteral("a.mp4")}));
+    }
+
+    SECTION("Jobs of default presets share a large machine")
+    {
+        // Presets usually leave the encoder thread count to FFmpeg
+        QTemporaryFile playlist;
+        REQUIRE(playlist.open());
+        playlist.write("<mlt><profile width=\"1920\" height=\"1080\"/><consumer mlt_service=\"avformat\" real_time=\"-1\" threads=\"0\"/></mlt>");
+        playlist.close();
+        const QStringList args = {QStringLiteral("delivery"), QStringLiteral("melt"), playlist.fileName()};
+        const RenderQueue::Job first = RenderQueue::createJob(QStringLiteral("e.mp4"), args, 32);
+        const RenderQueue::Job second = RenderQueue::createJob(QStringLiteral("f.mp4"), args, 32);
+        CHECK(first.threads == 16);
+        // The job is run with the thread count it was admitted for
+        CHECK(first.args.contains(QStringLiteral("--threads=16")));
+        RenderQueue shared;
+        REQUIRE(shared.append(first));
+        REQUIRE(shared.append(second));
+        limits.threads = 32;
+        CHECK(shared.admissible(limits) == QStringList({QStringLiteral("e.mp4"), QStringLiteral("f.mp4")}));
+    }
+
+    SECTION("Save and load")
+    {
+        QTemporaryFile file;
+        REQUIRE(file.open());
+        RenderQueue saved(file.fileName());
+        saved.append(makeJob(QStringLiteral("a.mp4"), 4, 1000));
+        saved.append(makeJob(QStringLiteral("b.mp4"), 2, 500));
+        saved.setStatus(QStringLiteral("a.mp4"), RenderQueue::Finished);
+        REQUIRE(saved.save());
+        RenderQueue loaded(file.fileName());
+        REQUIRE(loaded.load());
+        REQUIRE(loaded.jobs().size() == 2);
+        CHECK(loaded.jobs().at(0).status == RenderQueue::Finished);
+        CHECK(loaded.jobs().at(1).output == QStringLiteral("b.mp4"));
+        CHECK(loaded.jobs().at(1).args == saved.jobs().at(1).args);
+        CHECK(loaded.jobs().at(1).threads == 2);
+        CHECK(loaded.jobs().at(1).memory == 500);
+        loaded.removeCompleted();
+        CHECK(loaded.count(RenderQueue::Waiting) == 1);
+    }
+}
+
+TEST_CASE("Split of a render in segments", "[RenderSegments]")
+{
+    CHECK(RenderSegments::timeToFrames(QStringLiteral("120"), 25.) == 120);
+    CHECK(RenderSegments::timeToFrames(QStringLiteral("00:00:02.000"), 25.) == 50);
+    CHECK(RenderSegments::timeToFrames(QStringLiteral("00:00:01:05"), 25.) == 30);
+
+    // The bin and the sequence that is not rendered have cuts at 100 and 333
+    QDomDocument doc;
+    REQUIRE(doc.setContent(QStringLiteral("<mlt><profile frame_rate_num=\"25\" frame_rate_den=\"1\"/>"
+                                          "<producer id=\"clip\"/>"
+                                          "<playlist id=\"main_bin\"><entry producer=\"clip\" in=\"0\" out=\"99\"/></playlist>"
+                                          "<playlist id=\"other\"><entry producer=\"clip\" in=\"0\" out=\"332\"/></playlist>"
+                                          "<tractor id=\"sequence\"><track producer=\"other\"/></tractor>"
+                                          "<playlist id=\"playlist0\"><entry producer=\"clip\" in=\"0\" out=\"399\"/><blank length=\"00:00:04.000\"/>"
+                                          "<entry producer=\"clip\" in=\"0\" out=\"599\"/></playlist>"
+                                          "<playlist id=\"playlist1\"/>"
+                                          "<tractor id=\"track0\"><track producer=\"playlist0\"/><track producer=\"playlist1\"/></tractor>"
+                                          "<playlist id=\"playlist2\"><entry producer=\"clip\" in=\"00:00:00.000\" out=\"00:00:27.960\"/></playlist>"
+                                          "<tractor id=\"main\"><track producer=\"track0\"/><track producer=\"playlist2\"/></tractor>"
+                                          "<consumer mlt_service=\"avformat\"/></mlt>")));
+    const std::set<int> cuts = RenderSegments::cutPoints(doc);
+    CHECK(cuts == std::set<int>({400, 500, 700, 1100}));
+
+    SECTION("Boundaries move to close cuts only")
+    {
+        // 250 is too far from the cuts, 500 is a cut and 750 moves to 700
+        CHECK(RenderSegments::split(0, 999, 4, cuts) == QList<int>({0, 250, 500, 700}));
+        CHECK(RenderSegments::split(0, 999, 2, {}) == QList<int>({0, 500}));
+    }
+
+    SECTION("Short ranges are not split")
+    {
+        CHECK(RenderSegments::split(0, 299, 4, cuts) == QList<int>({0}));
+        CHECK(RenderSegments::split(0, 749, 4, cuts).count() == 3);
+    }
+}
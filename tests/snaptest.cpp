@@ -7,6 +7,9 @@
 // test specific headers
 #include "timeline2/model/snapmodel.hpp"
 
+#include <QElapsedTimer>
+#include <random>
+
 TEST_CASE("Snap points model test", "[SnapModel]")
 {
     SnapModel snap;
@@ -128,3 +131,126 @@ TEST_CASE("Snap points model test", "[SnapModel]")
         REQUIRE(snap.getClosestPoint(999) == 15);
     }
 }
+
+TEST_CASE("Snap points batched updates", "[SnapModel]")
+{
+    SnapModel snap;
+    std::map<int, int> reference;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 500);
+    auto closest = [&reference](int position) {
+        if (reference.empty()) {
+            return -1;
+        }
+        auto it = reference.lower_bound(position);
+        long long int prev = INT_MIN, next = INT_MAX;
+        if (it != reference.end()) {
+            next = it->first;
+        }
+        if (it != reference.begin()) {
+            prev = std::prev(it)->first;
+        }
+        return int(std::llabs(position - prev) < std::llabs(position - next) ? prev : next);
+    };
+
+    SECTION("Group updates give the same points as single updates")
+    {
+        for (int round = 0; round < 50; ++round) {
+            // Move a group of points: remove some existing points and add new ones in a single batch
+            std::vector<int> removed;
+            for (auto &p : reference) {
+                if (dist(gen) % 3 == 0) {
+                    for (int i = 0; i < p.second; ++i) {
+                        removed.push_back(p.first);
+                    }
+                }
+            }
+            std::vector<int> added;
+            int count = dist(gen) % 40;
+            for (int i = 0; i < count; ++i) {
+                added.push_back(dist(gen));
+            }
+            snap.removePoints(removed);
+            snap.addPoints(added);
+            for (int p : removed) {
+                if (--reference[p] == 0) {
+                    reference.erase(p);
+                }
+            }
+            for (int p : added) {
+                reference[p]++;
+            }
+            for (int i = 0; i < 10; ++i) {
+                int pos = dist(gen);
+                REQUIRE(snap.getClosestPoint(pos) == closest(pos));
+            }
+            REQUIRE(snap._snaps() == reference);
+        }
+    }
+
+    SECTION("Ignoring a group of points")
+    {
+        std::vector<int> points;
+        for (int i = 0; i < 100; ++i) {
+            points.push_back(i * 10);
+        }
+        snap.addPoints(points);
+        std::vector<int> group(points.begin() + 10, points.begin() + 60);
+        snap.ignore(group);
+        REQUIRE(snap.getClosestPoint(300) == 90);
+        REQUIRE(snap.getNextPoint(100) == 600);
+        REQUIRE(snap.getPreviousPoint(550) == 90);
+        snap.unIgnore();
+        REQUIRE(snap.getClosestPoint(300) == 300);
+        REQUIRE(snap._snaps().size() == 100);
+    }
+}
+
+TEST_CASE("Snap points benchmark", "[.][SnapModel][benchmark]")
+{
+    // Not run by default, use the [benchmark] tag to run it
+    const int pointsCount = 20000;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 10 * pointsCount);
+    SnapModel snap;
+    std::vector<int> points;
+    for (int i = 0; i < pointsCount; ++i) {
+        points.push_back(dist(gen));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int p : points) {
+        snap.addPoint(p);
+    }
+    REQUIRE(snap.getClosestPoint(0) >= 0);
+    qint64 elapsed = timer.nsecsElapsed();
+    qDebug() << "Adding" << pointsCount << "points:" << elapsed / 1000 << "us";
+
+    // Drag a group of 1000 points over 200 mouse moves
+    std::vector<int> group(points.begin(), points.begin() + 1000);
+    timer.restart();
+    int total = 0;
+    for (int move = 0; move < 200; ++move) {
+        snap.ignore(group);
+        for (int i = 0; i < 20; ++i) {
+            total += snap.getClosestPoint(group.at(size_t(i)) + move);
+        }
+        snap.unIgnore();
+    }
+    elapsed = timer.nsecsElapsed();
+    qDebug() << "Dragging a group of 1000 points, 200 moves:" << elapsed / 1000 << "us" << total;
+
+    // Move the group by one frame 200 times
+    timer.restart();
+    for (int move = 0; move < 200; ++move) {
+        snap.removePoints(group);
+        for (int &p : group) {
+            p++;
+        }
+        snap.addPoints(group);
+        total += snap.getClosestPoint(move);
+    }
+    elapsed = timer.nsecsElapsed();
+    qDebug() << "Moving a group of 1000 points, 200 moves:" << elapsed / 1000 << "us" << total;
+    REQUIRE(snap._snaps().size() <= size_t(pointsCount));
+}
@@ -216,6 +216,44 @@ TEST_CASE("Read subtitle file", "[Subtitles]")
         REQUIRE(subtitleModel->rowCount() == 0);
     }
 
+    SECTION("Find subtitles by position and range")
+    {
+        int subId = TimelineModel::getNextId();
+        int subId2 = TimelineModel::getNextId();
+        int subId3 = TimelineModel::getNextId();
+        double fps = pCore->getCurrentFps();
+        // A long subtitle overlapping the next one
+        REQUIRE(subtitleModel->addSubtitle(subId, GenTime(50, fps), GenTime(200, fps), QStringLiteral("Long"), false, false));
+        REQUIRE(subtitleModel->addSubtitle(subId2, GenTime(60, fps), GenTime(90, fps), QStringLiteral("Short"), false, false));
+        REQUIRE(subtitleModel->addSubtitle(subId3, GenTime(300, fps), GenTime(340, fps), QStringLiteral("Last"), false, false));
+        REQUIRE(subtitleModel->getIdForStartPos(GenTime(60, fps)) == subId2);
+        REQUIRE(subtitleModel->getSubtitleIdByPosition(300) == subId3);
+        REQUIRE(subtitleModel->getItemsInRange(100, 150) == std::unordered_set<int>{subId});
+        REQUIRE(subtitleModel->getItemsInRange(70, 80) == std::unordered_set<int>({subId, subId2}));
+        REQUIRE(subtitleModel->getItemsInRange(210, -1) == std::unordered_set<int>{subId3});
+        REQUIRE(subtitleModel->getItemsInRange(350, -1).empty());
+        REQUIRE(subtitleModel->getNextSub(subId) == subId2);
+        REQUIRE(subtitleModel->getPreviousSub(subId3) == subId2);
+        REQUIRE(subtitleModel->getPreviousSub(subId) == -1);
+        REQUIRE(subtitleModel->getNextSub(subId3) == -1);
+
+        // Move and resize, the lookups must follow
+        REQUIRE(subtitleModel->moveSubtitle(subId2, GenTime(400, fps), false, false));
+        REQUIRE(subtitleModel->getIdForStartPos(GenTime(60, fps)) == -1);
+        REQUIRE(subtitleModel->getIdForStartPos(GenTime(400, fps)) == subId2);
+        REQUIRE(subtitleModel->getItemsInRange(70, 80) == std::unordered_set<int>{subId});
+        REQUIRE(subtitleModel->getItemsInRange(410, 420) == std::unordered_set<int>{subId2});
+        REQUIRE(subtitleModel->requestResize(subId, 20, true));
+        REQUIRE(subtitleModel->getItemsInRange(100, 150).empty());
+        REQUIRE(subtitleModel->getSubtitleIdAtPosition(60) == subId);
+        REQUIRE(subtitleModel->requestResize(subId3, 10, false));
+        REQUIRE(subtitleModel->getIdForStartPos(GenTime(330, fps)) == subId3);
+        REQUIRE(subtitleModel->getSubtitleIdAtPosition(310) == -1);
+        subtitleModel->removeAllSubtitles();
+        REQUIRE(subtitleModel->rowCount() == 0);
+        REQUIRE(subtitleModel->getIdForStartPos(GenTime(330, fps)) == -1);
+    }
+
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
@@ -110,6 +110,20 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     }
     // 2 chunks should remain
     REQUIRE(list.size() == 2);
+
+    // Undoing the insertion restores the timeline content, the chunk rendered before is reused
+    undoStack->undo();
+    REQUIRE(timeline->getClipsCount() == 0);
+    timeline->previewManager()->invalidatePreviews();
+    timeline->previewManager()->startPreviewRender();
+    while (timeline->previewManager()->isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        qApp->processEvents();
+    }
+    list = dir.entryInfoList(QDir::Files, QDir::Time);
+    REQUIRE(list.size() == 3);
+    REQUIRE(timeline->previewManager()->m_dirtyChunks.isEmpty());
+    REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 3);
     timeline->resetPreviewManager();
     // Ensure preview project folder is deleted on close
     REQUIRE(dir.exists() == false);
@@ -6,7 +6,10 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 // test specific headers
+#include "lib/audio/audioCorrelation.h"
+#include "undohelper.hpp"
 #include "utils/qstringutils.h"
+#include <random>
 
 TEST_CASE("Testing for different utils", "[Utils]")
 {
@@ -30,3 +33,121 @@ TEST_CASE("Testing for different utils", "[Utils]")
         REQUIRE(names.removeDuplicates() == 0);
     }
 }
+
+TEST_CASE("Undo journal", "[Utils]")
+{
+    std::vector<int> calls;
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    for (int i = 0; i < 1000; i++) {
+        Fun operation = [&calls, i]() {
+            calls.push_back(i);
+            return true;
+        };
+        Fun reverse = [&calls, i]() {
+            calls.push_back(-i);
+            return true;
+        };
+        UndoJournal::prepend(undo, reverse);
+        UndoJournal::append(redo, operation);
+    }
+
+    SECTION("Operations are executed in order on redo and in reverse order on undo")
+    {
+        REQUIRE(UndoJournal::operationCount(undo) == 1001);
+        REQUIRE(UndoJournal::operationCount(redo) == 1001);
+        REQUIRE(undo());
+        REQUIRE(calls.size() == 1000);
+        REQUIRE(calls.front() == -999);
+        REQUIRE(calls.back() == 0);
+        calls.clear();
+        REQUIRE(redo());
+        REQUIRE(calls.front() == 0);
+        REQUIRE(calls.back() == 999);
+    }
+
+    SECTION("Copies are not modified by later operations")
+    {
+        Fun copy = redo;
+        UndoJournal::append(redo, [&calls]() {
+            calls.push_back(5000);
+            return true;
+        });
+        REQUIRE(UndoJournal::operationCount(copy) == 1001);
+        REQUIRE(UndoJournal::operationCount(redo) == 1002);
+        REQUIRE(copy());
+        REQUIRE(calls.back() == 999);
+        calls.clear();
+        REQUIRE(redo());
+        REQUIRE(calls.back() == 5000);
+    }
+
+    SECTION("All operations are executed even if one fails")
+    {
+        UndoJournal::append(redo, []() { return false; });
+        UndoJournal::append(redo, [&calls]() {
+            calls.push_back(5000);
+            return true;
+        });
+        REQUIRE_FALSE(redo());
+        REQUIRE(calls.size() == 1001);
+        REQUIRE(calls.back() == 5000);
+    }
+
+    SECTION("Memory accounting")
+    {
+        FunctionalUndoCommand command(undo, redo, QStringLiteral("test"));
+        REQUIRE(command.operationCount() == 2002);
+        REQUIRE(command.memoryCost() >= 2002 * sizeof(Fun));
+    }
+}
+
+TEST_CASE("Audio alignment", "[Utils]")
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0., 1000000.);
+    auto makeEnvelope = [&](size_t size) {
+        std::vector<qint64> envelope(size);
+        for (qint64 &value : envelope) {
+            value = qint64(noise(generator));
+        }
+        return envelope;
+    };
+    // The child is an excerpt of the reference starting at frame shift, with some added noise
+    auto makeChild = [&](const std::vector<qint64> &reference, size_t size, qint64 shift) {
+        std::vector<qint64> child(size);
+        for (size_t i = 0; i < size; ++i) {
+            child[i] = reference[size_t(qint64(i) + shift)] + qint64(noise(generator) * 0.3);
+        }
+        return child;
+    };
+
+    SECTION("Short reference")
+    {
+        AudioCorrelation::Reference reference(makeEnvelope(3000));
+        REQUIRE(reference.coarseEnvelope.empty());
+        for (qint64 shift : {0, 417, 1999}) {
+            const AudioCorrelation::Alignment alignment = AudioCorrelation::align(reference, makeChild(reference.envelope, 1000, shift));
+            REQUIRE(qint64(alignment.info->maxIndex()) - 1000 == shift);
+            REQUIRE(alignment.confidence > 0.9);
+        }
+    }
+
+    SECTION("Long reference is aligned from the low resolution match")
+    {
+        AudioCorrelation::Reference reference(makeEnvelope(40000));
+        REQUIRE_FALSE(reference.coarseEnvelope.empty());
+        for (qint64 shift : {0, 123, 20003, 38000}) {
+            const AudioCorrelation::Alignment alignment = AudioCorrelation::align(reference, makeChild(reference.envelope, 2000, shift));
+            REQUIRE(qint64(alignment.info->maxIndex()) - 2000 == shift);
+            REQUIRE(alignment.confidence > 0.9);
+        }
+    }
+
+    SECTION("Unrelated audio has a low confidence")
+    {
+        AudioCorrelation::Reference reference(makeEnvelope(3000));
+        const AudioCorrelation::Alignment alignment = AudioCorrelation::align(reference, makeEnvelope(1000));
+        REQUIRE(alignment.confidence < 0.3);
+    }
+}